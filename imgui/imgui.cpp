@@ -831,6 +831,9 @@ CODE
 #else
 #include <stdint.h>     // intptr_t
 #endif
+#if defined(_MSC_VER)
+#include <intrin.h>     // _InterlockedExchangeAdd
+#endif
 
 // [Windows] On non-Visual Studio compilers, we default to IMGUI_DISABLE_WIN32_DEFAULT_IME_FUNCTIONS unless explicitly enabled
 #if defined(_WIN32) && !defined(_MSC_VER) && !defined(IMGUI_ENABLE_WIN32_DEFAULT_IME_FUNCTIONS) && !defined(IMGUI_DISABLE_WIN32_DEFAULT_IME_FUNCTIONS)
@@ -3648,11 +3651,23 @@ float ImGui::CalcWrapWidthForPos(const ImVec2& pos, float wrap_pos_x)
     return ImMax(wrap_pos_x - pos.x, 1.0f);
 }
 
+// ImDrawList instances may be built on other threads than the one running the frame (each with its own copy of
+// ImDrawListSharedData), their allocations come through here too. The allocator functions have to be thread-safe
+// for that (the default malloc/free are), and the allocation counter is updated atomically.
+static inline void ImAtomicAddInt(int* p, int v)
+{
+#if defined(_MSC_VER)
+    _InterlockedExchangeAdd((volatile long*)p, (long)v);
+#else
+    __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
 // IM_ALLOC() == ImGui::MemAlloc()
 void* ImGui::MemAlloc(size_t size)
 {
     if (ImGuiContext* ctx = GImGui)
-        ctx->IO.MetricsActiveAllocations++;
+        ImAtomicAddInt(&ctx->IO.MetricsActiveAllocations, 1);
     return (*GImAllocatorAllocFunc)(size, GImAllocatorUserData);
 }
 
@@ -3661,7 +3676,7 @@ void ImGui::MemFree(void* ptr)
 {
     if (ptr)
         if (ImGuiContext* ctx = GImGui)
-            ctx->IO.MetricsActiveAllocations--;
+            ImAtomicAddInt(&ctx->IO.MetricsActiveAllocations, -1);
     return (*GImAllocatorFreeFunc)(ptr, GImAllocatorUserData);
 }
 
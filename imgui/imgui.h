@@ -242,6 +242,7 @@ typedef int     (*ImGuiInputTextCallback)(ImGuiInputTextCallbackData* data);
 typedef void    (*ImGuiSizeCallback)(ImGuiSizeCallbackData* data);              // Callback function for ImGui::SetNextWindowSizeConstraints()
 typedef void*   (*ImGuiMemAllocFunc)(size_t sz, void* user_data);               // Function signature for ImGui::SetAllocatorFunctions()
 typedef void    (*ImGuiMemFreeFunc)(void* ptr, void* user_data);                // Function signature for ImGui::SetAllocatorFunctions()
+typedef void    (*ImFontGlyphMissingFunc)(const ImFont* font, ImWchar c, void* user_data); // Function signature for ImFontAtlas::GlyphMissingFn
 
 // ImVec2: 2D vector used to store positions, sizes etc. [Compile-time configurable type]
 // This is a frequently used type in the API. Consider using IM_VEC2_CLASS_EXTRA to create implicit cast from/to our preferred type.
@@ -2816,6 +2817,8 @@ struct ImFontAtlas
     int                         TexDesiredWidth;    // Texture width desired by user before Build(). Must be a power-of-two. If have many glyphs your graphics API have texture size restrictions you may want to increase texture width to decrease height.
     int                         TexGlyphPadding;    // Padding between glyphs within texture in pixels. Defaults to 1. If your rendering method doesn't rely on bilinear filtering you may set this to 0 (will also need to set AntiAliasedLinesUseTex = false).
     bool                        Locked;             // Marked as Locked by ImGui::NewFrame() so attempt to modify the atlas will assert.
+    ImFontGlyphMissingFunc      GlyphMissingFn;     // Optional. Called by ImFont::FindGlyph() for a character the font has no glyph for (yet), before it returns the fallback glyph, so glyphs can be rasterized on demand. May be called from any thread building draw lists, and again on every lookup until the glyph is added.
+    void*                       GlyphMissingUserData; // Passed to GlyphMissingFn.
 
     // [Internal]
     // NB: Access texture data via GetTexData*() calls! Which will setup a default font for you.
@@ -6,6 +6,7 @@
 // Implemented features:
 //  [X] Renderer: User texture binding. Use 'GLuint' OpenGL texture identifier as void*/ImTextureID. Read the FAQ about ImTextureID!
 //  [x] Renderer: Desktop GL only: Support for large meshes (64k+ vertices) with 16-bit indices.
+//  [x] Renderer: Desktop GL 3.2+ only: Optional fenced ring buffer for vertex/index uploads, optional minimal state backup.
 
 // You can use unmodified imgui_impl_* files in your project. See examples/ folder for examples of using this.
 // Prefer including the entire imgui/ repository into your project (either as a copy or as a submodule), and only build the backends you need.
@@ -14,6 +15,9 @@
 
 // CHANGELOG
 // (minor and older changes stripped away, please see git history for details)
+//  2026-10-19: OpenGL: Added ImGui_ImplOpenGL3_RenderExtraDrawData() for draws besides the frame's that must not advance the ring.
+//  2026-10-19: OpenGL: Added ImGui_ImplOpenGL3_UpdateFontsTexture() to upload a dirty region of the font atlas with glTexSubImage2D(). CreateDeviceObjects() keeps a font texture created before the first NewFrame().
+//  2026-10-19: OpenGL: Added ImGui_ImplOpenGL3_SetFlags() with a triple-buffered, fence-guarded ring buffer upload path and a minimal state backup contract, and ImGui_ImplOpenGL3_GetRenderStats().
 //  2022-05-23: OpenGL: Reworking 2021-12-15 "Using buffer orphaning" so it only happens on Intel GPU, seems to cause problems otherwise. (#4468, #4825, #4832, #5127).
 //  2022-05-13: OpenGL: Fix state corruption on OpenGL ES 2.0 due to not preserving GL_ELEMENT_ARRAY_BUFFER_BINDING and vertex attribute states.
 //  2021-12-15: OpenGL: Using buffer orphaning + glBufferSubData(), seems to fix leaks with multi-viewports with some Intel HD drivers.
@@ -173,6 +177,12 @@
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
 #endif
 
+// Desktop GL 3.2+ has fences and glMapBufferRange() for the optional ring buffer, GL 4.4 adds persistent mapping
+#if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3) && defined(GL_VERSION_3_2) && defined(GL_MAP_UNSYNCHRONIZED_BIT)
+#define IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+#define IMGUI_IMPL_OPENGL_RING_FRAMES   3
+#endif
+
 // Desktop GL use extension detection
 #if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3)
 #define IMGUI_IMPL_OPENGL_MAY_HAVE_EXTENSIONS
@@ -195,6 +205,17 @@ struct ImGui_ImplOpenGL3_Data
     GLsizeiptr      IndexBufferSize;
     bool            HasClipOrigin;
     bool            UseBufferSubData;
+    int             Flags;                   // ImGui_ImplOpenGL3_Flags_
+    ImGui_ImplOpenGL3_RenderStats Stats;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+    bool            HasBufferStorage;
+    GLuint          RingVao, RingHandle;     // One buffer laid out as [vertex slot 0..2][index slot 0..2], one slot per frame in flight
+    int             RingVtxCapacity;         // Per slot
+    int             RingIdxCapacity;
+    char*           RingMapped;              // Whole buffer when persistently mapped, NULL when mapped every frame
+    GLsync          RingFences[IMGUI_IMPL_OPENGL_RING_FRAMES];
+    int             RingSlot;
+#endif
 
     ImGui_ImplOpenGL3_Data() { memset((void*)this, 0, sizeof(*this)); }
 };
@@ -206,6 +227,10 @@ static ImGui_ImplOpenGL3_Data* ImGui_ImplOpenGL3_GetBackendData()
     return ImGui::GetCurrentContext() ? (ImGui_ImplOpenGL3_Data*)ImGui::GetIO().BackendRendererUserData : NULL;
 }
 
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+static void ImGui_ImplOpenGL3_DestroyRingBuffer();
+#endif
+
 // OpenGL vertex attribute state (for ES 1.0 and ES 2.0 only)
 #ifndef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
 struct ImGui_ImplOpenGL3_VtxAttribState
@@ -313,8 +338,16 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
         const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
         if (extension != NULL && strcmp(extension, "GL_ARB_clip_control") == 0)
             bd->HasClipOrigin = true;
+#if defined(IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER) && defined(GL_MAP_PERSISTENT_BIT)
+        if (extension != NULL && strcmp(extension, "GL_ARB_buffer_storage") == 0)
+            bd->HasBufferStorage = true;
+#endif
     }
 #endif
+#if defined(IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER) && defined(GL_MAP_PERSISTENT_BIT)
+    if (bd->GlVersion >= 440)
+        bd->HasBufferStorage = true;
+#endif
 
     return true;
 }
@@ -340,6 +373,43 @@ void    ImGui_ImplOpenGL3_NewFrame()
         ImGui_ImplOpenGL3_CreateDeviceObjects();
 }
 
+void    ImGui_ImplOpenGL3_SetFlags(int flags)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != NULL && "Did you call ImGui_ImplOpenGL3_Init()?");
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+    if (!(flags & ImGui_ImplOpenGL3_Flags_RingBuffer))
+        ImGui_ImplOpenGL3_DestroyRingBuffer();
+#endif
+    bd->Flags = flags;
+}
+
+int     ImGui_ImplOpenGL3_GetFlags()
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    return bd ? bd->Flags : 0;
+}
+
+const ImGui_ImplOpenGL3_RenderStats* ImGui_ImplOpenGL3_GetRenderStats()
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    return bd ? &bd->Stats : NULL;
+}
+
+// The ring has one slot per frame in flight; a second upload in the same frame would take the next frame's slot
+// and make its fence wait early. Clearing the flag only for this call leaves the ring itself alive.
+void    ImGui_ImplOpenGL3_RenderExtraDrawData(ImDrawData* draw_data)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    IM_ASSERT(bd != NULL && "Did you call ImGui_ImplOpenGL3_Init()?");
+    const int flags = bd->Flags;
+    const ImGui_ImplOpenGL3_RenderStats stats = bd->Stats;
+    bd->Flags &= ~ImGui_ImplOpenGL3_Flags_RingBuffer;
+    ImGui_ImplOpenGL3_RenderDrawData(draw_data);
+    bd->Flags = flags;
+    bd->Stats = stats;
+}
+
 static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_width, int fb_height, GLuint vertex_array_object)
 {
     ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
@@ -363,7 +433,7 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     // Support for GL 4.5 rarely used glClipControl(GL_UPPER_LEFT)
 #if defined(GL_CLIP_ORIGIN)
     bool clip_origin_lower_left = true;
-    if (bd->HasClipOrigin)
+    if (bd->HasClipOrigin && !(bd->Flags & ImGui_ImplOpenGL3_Flags_MinimalStateBackup))
     {
         GLenum current_clip_origin = 0; glGetIntegerv(GL_CLIP_ORIGIN, (GLint*)&current_clip_origin);
         if (current_clip_origin == GL_UPPER_LEFT)
@@ -402,6 +472,12 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     glBindVertexArray(vertex_array_object);
 #endif
 
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+    // The ring VAO keeps its buffer and attribute bindings
+    if (vertex_array_object != 0 && vertex_array_object == bd->RingVao)
+        return;
+#endif
+
     // Bind vertex/index buffers and setup attributes for ImDrawVert
     glBindBuffer(GL_ARRAY_BUFFER, bd->VboHandle);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->ElementsHandle);
@@ -413,72 +489,159 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     glVertexAttribPointer(bd->AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
 }
 
-// OpenGL3 Render function.
-// Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly.
-// This is in order to be able to run within an OpenGL engine that doesn't do so.
-void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+static void ImGui_ImplOpenGL3_DestroyRingBuffer()
 {
-    // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
-    int fb_width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
-    int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
-    if (fb_width <= 0 || fb_height <= 0)
-        return;
-
+    // Deleting the buffer also drops its mapping; the GL keeps the storage alive until queued draws are done with it
     ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    for (int i = 0; i < IMGUI_IMPL_OPENGL_RING_FRAMES; i++)
+        if (bd->RingFences[i]) { glDeleteSync(bd->RingFences[i]); bd->RingFences[i] = NULL; }
+    if (bd->RingHandle) { glDeleteBuffers(1, &bd->RingHandle); bd->RingHandle = 0; }
+    if (bd->RingVao)    { glDeleteVertexArrays(1, &bd->RingVao); bd->RingVao = 0; }
+    bd->RingMapped = NULL;
+    bd->RingVtxCapacity = bd->RingIdxCapacity = 0;
+    bd->RingSlot = 0;
+}
 
-    // Backup GL state
-    GLenum last_active_texture; glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&last_active_texture);
-    glActiveTexture(GL_TEXTURE0);
-    GLuint last_program; glGetIntegerv(GL_CURRENT_PROGRAM, (GLint*)&last_program);
-    GLuint last_texture; glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&last_texture);
-#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
-    GLuint last_sampler; if (bd->GlVersion >= 330) { glGetIntegerv(GL_SAMPLER_BINDING, (GLint*)&last_sampler); } else { last_sampler = 0; }
-#endif
-    GLuint last_array_buffer; glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint*)&last_array_buffer);
-#ifndef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
-    // This is part of VAO on OpenGL 3.0+ and OpenGL ES 3.0+.
-    GLint last_element_array_buffer; glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &last_element_array_buffer);
-    ImGui_ImplOpenGL3_VtxAttribState last_vtx_attrib_state_pos; last_vtx_attrib_state_pos.GetState(bd->AttribLocationVtxPos);
-    ImGui_ImplOpenGL3_VtxAttribState last_vtx_attrib_state_uv; last_vtx_attrib_state_uv.GetState(bd->AttribLocationVtxUV);
-    ImGui_ImplOpenGL3_VtxAttribState last_vtx_attrib_state_color; last_vtx_attrib_state_color.GetState(bd->AttribLocationVtxColor);
-#endif
-#ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
-    GLuint last_vertex_array_object; glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint*)&last_vertex_array_object);
-#endif
-#ifdef IMGUI_IMPL_HAS_POLYGON_MODE
-    GLint last_polygon_mode[2]; glGetIntegerv(GL_POLYGON_MODE, last_polygon_mode);
-#endif
-    GLint last_viewport[4]; glGetIntegerv(GL_VIEWPORT, last_viewport);
-    GLint last_scissor_box[4]; glGetIntegerv(GL_SCISSOR_BOX, last_scissor_box);
-    GLenum last_blend_src_rgb; glGetIntegerv(GL_BLEND_SRC_RGB, (GLint*)&last_blend_src_rgb);
-    GLenum last_blend_dst_rgb; glGetIntegerv(GL_BLEND_DST_RGB, (GLint*)&last_blend_dst_rgb);
-    GLenum last_blend_src_alpha; glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint*)&last_blend_src_alpha);
-    GLenum last_blend_dst_alpha; glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint*)&last_blend_dst_alpha);
-    GLenum last_blend_equation_rgb; glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint*)&last_blend_equation_rgb);
-    GLenum last_blend_equation_alpha; glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint*)&last_blend_equation_alpha);
-    GLboolean last_enable_blend = glIsEnabled(GL_BLEND);
-    GLboolean last_enable_cull_face = glIsEnabled(GL_CULL_FACE);
-    GLboolean last_enable_depth_test = glIsEnabled(GL_DEPTH_TEST);
-    GLboolean last_enable_stencil_test = glIsEnabled(GL_STENCIL_TEST);
-    GLboolean last_enable_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
-#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
-    GLboolean last_enable_primitive_restart = (bd->GlVersion >= 310) ? glIsEnabled(GL_PRIMITIVE_RESTART) : GL_FALSE;
+// (Re)create the ring with room for at least vtx_count/idx_count per frame. Leaves the ring VAO bound.
+static void ImGui_ImplOpenGL3_CreateRingBuffer(int vtx_count, int idx_count)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    ImGui_ImplOpenGL3_DestroyRingBuffer();
+
+    // Grow with headroom so a panel that keeps expanding doesn't reallocate every frame
+    bd->RingVtxCapacity = 32 * 1024;
+    bd->RingIdxCapacity = 64 * 1024;
+    while (bd->RingVtxCapacity < vtx_count + vtx_count / 2)
+        bd->RingVtxCapacity *= 2;
+    while (bd->RingIdxCapacity < idx_count + idx_count / 2)
+        bd->RingIdxCapacity *= 2;
+    const GLsizeiptr ring_size = IMGUI_IMPL_OPENGL_RING_FRAMES * ((GLsizeiptr)bd->RingVtxCapacity * (int)sizeof(ImDrawVert) + (GLsizeiptr)bd->RingIdxCapacity * (int)sizeof(ImDrawIdx));
+
+    glGenVertexArrays(1, &bd->RingVao);
+    glBindVertexArray(bd->RingVao);
+    glGenBuffers(1, &bd->RingHandle);
+    glBindBuffer(GL_ARRAY_BUFFER, bd->RingHandle);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->RingHandle);
+#ifdef GL_MAP_PERSISTENT_BIT
+    if (bd->HasBufferStorage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, ring_size, NULL, flags);
+        bd->RingMapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, ring_size, flags);
+    }
+    else
 #endif
+    glBufferData(GL_ARRAY_BUFFER, ring_size, NULL, GL_STREAM_DRAW);
 
-    // Setup desired GL state
-    // Recreate the VAO every time (this is to easily allow multiple GL contexts to be rendered to. VAO are not shared among GL contexts)
-    // The renderer would actually work without any VAO bound, but then our VertexAttrib calls would overwrite the default one currently bound.
-    GLuint vertex_array_object = 0;
-#ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
-    glGenVertexArrays(1, &vertex_array_object);
+    // Every slot is addressed through base vertex/index offsets, so the attributes always start at 0
+    glEnableVertexAttribArray(bd->AttribLocationVtxPos);
+    glEnableVertexAttribArray(bd->AttribLocationVtxUV);
+    glEnableVertexAttribArray(bd->AttribLocationVtxColor);
+    glVertexAttribPointer(bd->AttribLocationVtxPos,   2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, pos));
+    glVertexAttribPointer(bd->AttribLocationVtxUV,    2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, uv));
+    glVertexAttribPointer(bd->AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
+}
+
+// Copy every draw list of the frame into the current ring slot. Returns false when the ring is not in use.
+// vtx_base receives the first vertex of the slot, idx_base the byte offset of its first index.
+static bool ImGui_ImplOpenGL3_UploadRing(ImDrawData* draw_data, GLint* vtx_base, GLintptr* idx_base)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    if (!(bd->Flags & ImGui_ImplOpenGL3_Flags_RingBuffer) || bd->GlVersion < 320)
+        return false;
+
+    if (bd->RingHandle == 0 || draw_data->TotalVtxCount > bd->RingVtxCapacity || draw_data->TotalIdxCount > bd->RingIdxCapacity)
+        ImGui_ImplOpenGL3_CreateRingBuffer(draw_data->TotalVtxCount, draw_data->TotalIdxCount);
+
+    // Wait for the GPU to be done with the frame that last used this slot. With three slots this only blocks when the CPU is a full two frames ahead.
+    const int slot = bd->RingSlot;
+    if (GLsync fence = bd->RingFences[slot])
+    {
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            bd->Stats.FenceWaits++;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+        }
+        glDeleteSync(fence);
+        bd->RingFences[slot] = NULL;
+    }
+
+    const GLintptr vtx_offset = (GLintptr)slot * bd->RingVtxCapacity * (int)sizeof(ImDrawVert);
+    const GLintptr idx_offset = (GLintptr)IMGUI_IMPL_OPENGL_RING_FRAMES * bd->RingVtxCapacity * (int)sizeof(ImDrawVert) + (GLintptr)slot * bd->RingIdxCapacity * (int)sizeof(ImDrawIdx);
+    const GLsizeiptr vtx_size = (GLsizeiptr)draw_data->TotalVtxCount * (int)sizeof(ImDrawVert);
+    const GLsizeiptr idx_size = (GLsizeiptr)draw_data->TotalIdxCount * (int)sizeof(ImDrawIdx);
+    glBindBuffer(GL_ARRAY_BUFFER, bd->RingHandle);
+
+    // Persistently mapped: plain copies. Otherwise map each range once, unsynchronized since the fence already guarantees the slot is free.
+    char* vtx_dst = bd->RingMapped ? bd->RingMapped + vtx_offset : NULL;
+    char* idx_dst = bd->RingMapped ? bd->RingMapped + idx_offset : NULL;
+    const GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    if (vtx_size > 0)
+    {
+        if (!bd->RingMapped)
+            vtx_dst = (char*)glMapBufferRange(GL_ARRAY_BUFFER, vtx_offset, vtx_size, map_flags);
+        if (vtx_dst != NULL)
+            for (int n = 0; n < draw_data->CmdListsCount; n++)
+            {
+                const ImDrawList* cmd_list = draw_data->CmdLists[n];
+                memcpy(vtx_dst, cmd_list->VtxBuffer.Data, (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+                vtx_dst += (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+            }
+        if (!bd->RingMapped)
+        {
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            bd->Stats.BufferUploads++;
+        }
+    }
+    if (idx_size > 0)
+    {
+        if (!bd->RingMapped)
+            idx_dst = (char*)glMapBufferRange(GL_ARRAY_BUFFER, idx_offset, idx_size, map_flags);
+        if (idx_dst != NULL)
+            for (int n = 0; n < draw_data->CmdListsCount; n++)
+            {
+                const ImDrawList* cmd_list = draw_data->CmdLists[n];
+                memcpy(idx_dst, cmd_list->IdxBuffer.Data, (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+                idx_dst += (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+            }
+        if (!bd->RingMapped)
+        {
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            bd->Stats.BufferUploads++;
+        }
+    }
+    bd->Stats.UploadBytes += (size_t)(vtx_size + idx_size);
+    bd->Stats.RingBytes = (size_t)IMGUI_IMPL_OPENGL_RING_FRAMES * ((size_t)bd->RingVtxCapacity * sizeof(ImDrawVert) + (size_t)bd->RingIdxCapacity * sizeof(ImDrawIdx));
+    bd->Stats.RingPersistent = bd->RingMapped != NULL;
+
+    *vtx_base = slot * bd->RingVtxCapacity;
+    *idx_base = idx_offset;
+    return true;
+}
+
+// Fence the slot written this frame and move on to the next one
+static void ImGui_ImplOpenGL3_AdvanceRing()
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    bd->RingFences[bd->RingSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    bd->RingSlot = (bd->RingSlot + 1) % IMGUI_IMPL_OPENGL_RING_FRAMES;
+}
 #endif
-    ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+
+// Issue the draw commands of every ImDrawList, uploading each one first unless the ring already holds the whole frame.
+// In ring mode all lists share one buffer, so each list is offset by the vertices/indices of the lists before it.
+static void ImGui_ImplOpenGL3_RenderCommandLists(ImDrawData* draw_data, int fb_width, int fb_height, GLuint vertex_array_object, bool use_ring, GLint ring_vtx_base, GLintptr ring_idx_base)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
 
     // Will project scissor/clipping rectangles into framebuffer space
     ImVec2 clip_off = draw_data->DisplayPos;         // (0,0) unless using multi-viewports
     ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
 
     // Render command lists
+    GLint list_vtx_base = ring_vtx_base;
+    GLintptr list_idx_base = ring_idx_base;
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
@@ -489,25 +652,30 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
         // - OpenGL drivers are in a very sorry state in 2022, for now we are switching code path based on vendors.
         const GLsizeiptr vtx_buffer_size = (GLsizeiptr)cmd_list->VtxBuffer.Size * (int)sizeof(ImDrawVert);
         const GLsizeiptr idx_buffer_size = (GLsizeiptr)cmd_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx);
-        if (bd->UseBufferSubData)
+        if (!use_ring)
         {
-            if (bd->VertexBufferSize < vtx_buffer_size)
+            if (bd->UseBufferSubData)
             {
-                bd->VertexBufferSize = vtx_buffer_size;
-                glBufferData(GL_ARRAY_BUFFER, bd->VertexBufferSize, NULL, GL_STREAM_DRAW);
+                if (bd->VertexBufferSize < vtx_buffer_size)
+                {
+                    bd->VertexBufferSize = vtx_buffer_size;
+                    glBufferData(GL_ARRAY_BUFFER, bd->VertexBufferSize, NULL, GL_STREAM_DRAW);
+                }
+                if (bd->IndexBufferSize < idx_buffer_size)
+                {
+                    bd->IndexBufferSize = idx_buffer_size;
+                    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bd->IndexBufferSize, NULL, GL_STREAM_DRAW);
+                }
+                glBufferSubData(GL_ARRAY_BUFFER, 0, vtx_buffer_size, (const GLvoid*)cmd_list->VtxBuffer.Data);
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, idx_buffer_size, (const GLvoid*)cmd_list->IdxBuffer.Data);
             }
-            if (bd->IndexBufferSize < idx_buffer_size)
+            else
             {
-                bd->IndexBufferSize = idx_buffer_size;
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, bd->IndexBufferSize, NULL, GL_STREAM_DRAW);
+                glBufferData(GL_ARRAY_BUFFER, vtx_buffer_size, (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx_buffer_size, (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
             }
-            glBufferSubData(GL_ARRAY_BUFFER, 0, vtx_buffer_size, (const GLvoid*)cmd_list->VtxBuffer.Data);
-            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, idx_buffer_size, (const GLvoid*)cmd_list->IdxBuffer.Data);
-        }
-        else
-        {
-            glBufferData(GL_ARRAY_BUFFER, vtx_buffer_size, (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx_buffer_size, (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+            bd->Stats.BufferUploads += 2;
+            bd->Stats.UploadBytes += (size_t)(vtx_buffer_size + idx_buffer_size);
         }
 
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
@@ -535,19 +703,151 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 
                 // Bind texture, Draw
                 glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->GetTexID());
+                bd->Stats.DrawCalls++;
 #ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
                 if (bd->GlVersion >= 320)
-                    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)), (GLint)pcmd->VtxOffset);
+                    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(list_idx_base + (intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx))), list_vtx_base + (GLint)pcmd->VtxOffset);
                 else
 #endif
                 glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)));
             }
         }
+        if (use_ring)
+        {
+            list_vtx_base += cmd_list->VtxBuffer.Size;
+            list_idx_base += idx_buffer_size;
+        }
+    }
+}
+
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+// Render without querying any state, leaving behind the fixed state documented for ImGui_ImplOpenGL3_Flags_MinimalStateBackup.
+// glGet*() calls can force the driver to synchronize with its command thread, and a full backup is ~30 of them per frame.
+static void ImGui_ImplOpenGL3_RenderDrawDataMinimal(ImDrawData* draw_data, int fb_width, int fb_height)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    glActiveTexture(GL_TEXTURE0);
+
+    GLint ring_vtx_base = 0;
+    GLintptr ring_idx_base = 0;
+    const bool use_ring = ImGui_ImplOpenGL3_UploadRing(draw_data, &ring_vtx_base, &ring_idx_base);
+    GLuint vertex_array_object = 0;
+    if (use_ring)
+        vertex_array_object = bd->RingVao;
+    else
+        glGenVertexArrays(1, &vertex_array_object);
+    ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+    ImGui_ImplOpenGL3_RenderCommandLists(draw_data, fb_width, fb_height, vertex_array_object, use_ring, ring_vtx_base, ring_idx_base);
+    if (use_ring)
+        ImGui_ImplOpenGL3_AdvanceRing();
+
+    glUseProgram(0);
+    glBindVertexArray(0);
+    if (!use_ring)
+        glDeleteVertexArrays(1, &vertex_array_object);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glEnable(GL_DEPTH_TEST);
+    // The viewport already covers the framebuffer; face culling, stencil and primitive restart were disabled by ImGui_ImplOpenGL3_SetupRenderState()
+}
+#endif
+
+// OpenGL3 Render function.
+// Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly.
+// This is in order to be able to run within an OpenGL engine that doesn't do so.
+void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
+{
+    // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
+    int fb_width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+    int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+    if (fb_width <= 0 || fb_height <= 0)
+        return;
+
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    memset((void*)&bd->Stats, 0, sizeof(bd->Stats));
+    bd->Stats.VtxCount = draw_data->TotalVtxCount;
+    bd->Stats.IdxCount = draw_data->TotalIdxCount;
+
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+    if ((bd->Flags & ImGui_ImplOpenGL3_Flags_MinimalStateBackup) && bd->GlVersion >= 320)
+    {
+        ImGui_ImplOpenGL3_RenderDrawDataMinimal(draw_data, fb_width, fb_height);
+        return;
     }
+#endif
+
+    // Backup GL state
+    GLenum last_active_texture; glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&last_active_texture);
+    glActiveTexture(GL_TEXTURE0);
+    GLuint last_program; glGetIntegerv(GL_CURRENT_PROGRAM, (GLint*)&last_program);
+    GLuint last_texture; glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&last_texture);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_BIND_SAMPLER
+    GLuint last_sampler; if (bd->GlVersion >= 330) { glGetIntegerv(GL_SAMPLER_BINDING, (GLint*)&last_sampler); } else { last_sampler = 0; }
+#endif
+    GLuint last_array_buffer; glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint*)&last_array_buffer);
+#ifndef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
+    // This is part of VAO on OpenGL 3.0+ and OpenGL ES 3.0+.
+    GLint last_element_array_buffer; glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &last_element_array_buffer);
+    ImGui_ImplOpenGL3_VtxAttribState last_vtx_attrib_state_pos; last_vtx_attrib_state_pos.GetState(bd->AttribLocationVtxPos);
+    ImGui_ImplOpenGL3_VtxAttribState last_vtx_attrib_state_uv; last_vtx_attrib_state_uv.GetState(bd->AttribLocationVtxUV);
+    ImGui_ImplOpenGL3_VtxAttribState last_vtx_attrib_state_color; last_vtx_attrib_state_color.GetState(bd->AttribLocationVtxColor);
+#endif
+#ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
+    GLuint last_vertex_array_object; glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint*)&last_vertex_array_object);
+#endif
+#ifdef IMGUI_IMPL_HAS_POLYGON_MODE
+    GLint last_polygon_mode[2]; glGetIntegerv(GL_POLYGON_MODE, last_polygon_mode);
+#endif
+    GLint last_viewport[4]; glGetIntegerv(GL_VIEWPORT, last_viewport);
+    GLint last_scissor_box[4]; glGetIntegerv(GL_SCISSOR_BOX, last_scissor_box);
+    GLenum last_blend_src_rgb; glGetIntegerv(GL_BLEND_SRC_RGB, (GLint*)&last_blend_src_rgb);
+    GLenum last_blend_dst_rgb; glGetIntegerv(GL_BLEND_DST_RGB, (GLint*)&last_blend_dst_rgb);
+    GLenum last_blend_src_alpha; glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint*)&last_blend_src_alpha);
+    GLenum last_blend_dst_alpha; glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint*)&last_blend_dst_alpha);
+    GLenum last_blend_equation_rgb; glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint*)&last_blend_equation_rgb);
+    GLenum last_blend_equation_alpha; glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint*)&last_blend_equation_alpha);
+    GLboolean last_enable_blend = glIsEnabled(GL_BLEND);
+    GLboolean last_enable_cull_face = glIsEnabled(GL_CULL_FACE);
+    GLboolean last_enable_depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean last_enable_stencil_test = glIsEnabled(GL_STENCIL_TEST);
+    GLboolean last_enable_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_PRIMITIVE_RESTART
+    GLboolean last_enable_primitive_restart = (bd->GlVersion >= 310) ? glIsEnabled(GL_PRIMITIVE_RESTART) : GL_FALSE;
+#endif
+
+    // Setup desired GL state
+    // Recreate the VAO every time (this is to easily allow multiple GL contexts to be rendered to. VAO are not shared among GL contexts)
+    // The renderer would actually work without any VAO bound, but then our VertexAttrib calls would overwrite the default one currently bound.
+    // In ring buffer mode the whole frame is uploaded up front and drawn with the ring's own persistent VAO instead.
+    GLuint vertex_array_object = 0;
+    bool use_ring = false;
+    GLint ring_vtx_base = 0;
+    GLintptr ring_idx_base = 0;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+    use_ring = ImGui_ImplOpenGL3_UploadRing(draw_data, &ring_vtx_base, &ring_idx_base);
+    if (use_ring)
+        vertex_array_object = bd->RingVao;
+#endif
+#ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
+    if (!use_ring)
+        glGenVertexArrays(1, &vertex_array_object);
+#endif
+    ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+    ImGui_ImplOpenGL3_RenderCommandLists(draw_data, fb_width, fb_height, vertex_array_object, use_ring, ring_vtx_base, ring_idx_base);
+
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+    if (use_ring)
+        ImGui_ImplOpenGL3_AdvanceRing();
+#endif
 
     // Destroy the temporary VAO
 #ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
-    glDeleteVertexArrays(1, &vertex_array_object);
+    if (!use_ring)
+        glDeleteVertexArrays(1, &vertex_array_object);
 #endif
 
     // Restore modified GL state
@@ -619,6 +919,36 @@ bool ImGui_ImplOpenGL3_CreateFontsTexture()
     return true;
 }
 
+// Re-upload the (x, y, w, h) region of the RGBA32 atlas after the application wrote new glyphs into it, instead of the whole texture.
+// The atlas size must not have changed since ImGui_ImplOpenGL3_CreateFontsTexture().
+void ImGui_ImplOpenGL3_UpdateFontsTexture(int x, int y, int w, int h)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    if (!bd->FontTexture || w <= 0 || h <= 0)
+        return;
+
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    IM_ASSERT(x >= 0 && y >= 0 && x + w <= width && y + h <= height);
+
+    GLint last_texture;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+    glBindTexture(GL_TEXTURE_2D, bd->FontTexture);
+#ifdef GL_UNPACK_ROW_LENGTH // Not on WebGL/ES: upload whole rows there
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+#else
+    x = 0;
+    w = width;
+#endif
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels + ((size_t)y * width + x) * 4);
+#ifdef GL_UNPACK_ROW_LENGTH
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#endif
+    glBindTexture(GL_TEXTURE_2D, last_texture);
+}
+
 void ImGui_ImplOpenGL3_DestroyFontsTexture()
 {
     ImGuiIO& io = ImGui::GetIO();
@@ -845,7 +1175,8 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
     glGenBuffers(1, &bd->VboHandle);
     glGenBuffers(1, &bd->ElementsHandle);
 
-    ImGui_ImplOpenGL3_CreateFontsTexture();
+    if (!bd->FontTexture) // The application may have created it already
+        ImGui_ImplOpenGL3_CreateFontsTexture();
 
     // Restore modified GL state
     glBindTexture(GL_TEXTURE_2D, last_texture);
@@ -862,6 +1193,9 @@ void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
     ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
     if (bd->VboHandle)      { glDeleteBuffers(1, &bd->VboHandle); bd->VboHandle = 0; }
     if (bd->ElementsHandle) { glDeleteBuffers(1, &bd->ElementsHandle); bd->ElementsHandle = 0; }
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_RING_BUFFER
+    ImGui_ImplOpenGL3_DestroyRingBuffer();
+#endif
     if (bd->ShaderHandle)   { glDeleteProgram(bd->ShaderHandle); bd->ShaderHandle = 0; }
     ImGui_ImplOpenGL3_DestroyFontsTexture();
 }
@@ -6,6 +6,7 @@
 // Implemented features:
 //  [X] Renderer: User texture binding. Use 'GLuint' OpenGL texture identifier as void*/ImTextureID. Read the FAQ about ImTextureID!
 //  [x] Renderer: Desktop GL only: Support for large meshes (64k+ vertices) with 16-bit indices.
+//  [x] Renderer: Desktop GL 3.2+ only: Optional fenced ring buffer for vertex/index uploads, optional minimal state backup.
 
 // You can use unmodified imgui_impl_* files in your project. See examples/ folder for examples of using this.
 // Prefer including the entire imgui/ repository into your project (either as a copy or as a submodule), and only build the backends you need.
@@ -29,9 +30,47 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data);
 // (Optional) Called by Init/NewFrame/Shutdown
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateFontsTexture();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_UpdateFontsTexture(int x, int y, int w, int h);  // Re-upload a region of io.Fonts' RGBA32 pixels
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 
+// (Optional) Buffer upload and state backup modes, desktop GL 3.2+ only (ignored otherwise)
+// - RingBuffer: all draw lists of a frame are copied into one triple-buffered vertex/index buffer, guarded by a fence per
+//   frame slot, instead of re-specifying the buffers for every ImDrawList. The buffer is persistently mapped when
+//   glBufferStorage() is available (GL 4.4 / ARB_buffer_storage), mapped unsynchronized once per frame otherwise.
+//   The VAO is created once instead of every frame, so the ring is tied to the GL context that first rendered with it.
+// - MinimalStateBackup: nothing is queried with glGet*(). Instead RenderDrawData() leaves a fixed state behind:
+//   program, VAO, GL_ARRAY_BUFFER, sampler and GL_TEXTURE_2D unbound with GL_TEXTURE0 active, blend and scissor disabled
+//   with the blend function reset to (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), depth test enabled, face culling, stencil
+//   and primitive restart disabled, polygon mode GL_FILL, and the viewport covering the whole framebuffer. The clip
+//   origin is assumed to be GL_LOWER_LEFT. Only use it when that is what the app expects.
+enum ImGui_ImplOpenGL3_Flags_
+{
+    ImGui_ImplOpenGL3_Flags_None                = 0,
+    ImGui_ImplOpenGL3_Flags_RingBuffer          = 1 << 0,
+    ImGui_ImplOpenGL3_Flags_MinimalStateBackup  = 1 << 1,
+};
+
+// Filled by every RenderDrawData() call
+struct ImGui_ImplOpenGL3_RenderStats
+{
+    int         VtxCount;           // Vertices and indices submitted this frame
+    int         IdxCount;
+    int         DrawCalls;
+    int         BufferUploads;      // glBufferData/glBufferSubData/glMapBufferRange calls (0 with a persistent ring)
+    size_t      UploadBytes;
+    int         FenceWaits;         // Frames where the ring slot was still in use by the GPU
+    size_t      RingBytes;          // Size of the ring buffer, all three slots
+    bool        RingPersistent;
+};
+
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetFlags(int flags);      // ImGui_ImplOpenGL3_Flags_
+IMGUI_IMPL_API int      ImGui_ImplOpenGL3_GetFlags();
+IMGUI_IMPL_API const ImGui_ImplOpenGL3_RenderStats* ImGui_ImplOpenGL3_GetRenderStats();
+// Render additional draw data within a frame (e.g. into an offscreen target): uploads each list without the ring,
+// so the ring slot of the frame's own RenderDrawData() call is neither used nor advanced, and the render stats are kept
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_RenderExtraDrawData(ImDrawData* draw_data);
+
 // Specific OpenGL ES versions
 //#define IMGUI_IMPL_OPENGL_ES2     // Auto-detected on Emscripten
 //#define IMGUI_IMPL_OPENGL_ES3     // Auto-detected on iOS/Android
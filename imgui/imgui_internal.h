@@ -717,6 +717,18 @@ struct ImChunkStream
 #endif
 #define IM_DRAWLIST_ARCFAST_SAMPLE_MAX                          IM_DRAWLIST_ARCFAST_TABLE_SIZE // Sample index _PathArcToFastEx() for 360 angle.
 
+// Code paths of the AddPolyline() and AddConvexPolyFilled() tessellators. All of them produce bit-identical output.
+// The SIMD paths are only compiled on x86-64 with IMGUI_ENABLE_SSE, the AVX2 one is selected at runtime.
+enum ImDrawTessellationSimd_
+{
+    ImDrawTessellationSimd_Scalar,
+    ImDrawTessellationSimd_SSE2,
+    ImDrawTessellationSimd_AVX2,
+};
+
+IMGUI_API int           ImDrawTessellationSimdSupported();              // Best ImDrawTessellationSimd_ this build and CPU can run
+IMGUI_API const char*   ImDrawTessellationSimdName(int simd);
+
 // Data shared between all ImDrawList instances
 // You may want to create your own instance of this if you want to use ImDrawList completely without ImGui. In that case, watch out for future changes to this structure.
 struct IMGUI_API ImDrawListSharedData
@@ -728,6 +740,7 @@ struct IMGUI_API ImDrawListSharedData
     float           CircleSegmentMaxError;      // Number of circle segments to use per pixel of radius for AddCircle() etc
     ImVec4          ClipRectFullscreen;         // Value for PushClipRectFullscreen()
     ImDrawListFlags InitialFlags;               // Initial flags at the beginning of the frame (it is possible to alter flags on a per-drawlist basis afterwards)
+    int             TessellationSimd;           // ImDrawTessellationSimd_ used by AddPolyline()/AddConvexPolyFilled(), defaults to ImDrawTessellationSimdSupported()
 
     // [Internal] Lookup tables
     ImVec2          ArcFastVtx[IM_DRAWLIST_ARCFAST_TABLE_SIZE]; // Sample points on the quarter of the circle.
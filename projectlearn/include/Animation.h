@@ -8,12 +8,38 @@
 #include "animdata.h"
 #include "model.h"
 
+/*one node of the clip's hierarchy; nodes are stored flat in pre-order, so a node's parent
+  always has a smaller index*/
 struct AssimpNodeData
 {
 	glm::mat4 transformation;
 	std::string name;
+	int parent;
 	int childrenCount;
-	std::vector<AssimpNodeData> children;
+};
+
+/*
+	Node as the animator evaluates it. Only nodes that are animated or deform vertices are
+	kept; every static node in between is folded into "pre" of its descendants, so
+	global = global[parent] * pre * local(bone), in one forward loop over the array.
+*/
+struct EvaluationNode
+{
+	/*index into the evaluation array, -1 when everything above is static (pre is then global)*/
+	int parent;
+	/*index into GetBones(), -1 for a node without a channel (its own transform is in pre)*/
+	int bone;
+	/*index into the bone palette, -1 for nodes that do not deform anything*/
+	int paletteId;
+	bool identityPre;
+	/*levels of kept nodes below this one; 0 for the end of a chain (see AnimationLOD)*/
+	int height;
+	glm::mat4 pre;
+	glm::mat4 offset;
+	/*bind pose local transform, used instead of the channel when LOD skips this node*/
+	glm::mat4 bind;
+	/*index into GetNodes(), for the name*/
+	int node;
 };
 
 class Animation
@@ -21,20 +47,89 @@ class Animation
 public:
 	Animation() = default;
 
-	Animation(const std::string& animationPath, Model* model)
+	Animation(const std::string& animationPath, Model* model,
+		const CompressionSettings& compression = CompressionSettings())
 	{
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
 		assert(scene && scene->mRootNode);
-		auto animation = scene->mAnimations[0];
-		m_Duration = animation->mDuration;
-		m_TicksPerSecond = animation->mTicksPerSecond;
-		aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
-		globalTransformation = globalTransformation.Inverse();
-		ReadHeirarchyData(m_RootNode, scene->mRootNode);
-		ReadMissingBones(animation, *model);
+		Read(scene->mAnimations[0], scene->mRootNode, model->GetBoneInfoMap(), model->GetBoneCount());
+		if (compression.enabled)
+		{
+			m_Compressed.Build(m_Bones, m_Duration, compression);
+			m_Compressed.PrintReport(animationPath);
+			for (size_t i = 0; i < m_Bones.size(); i++)
+				m_Bones[i].UseCompressedTrack(&m_Compressed, i);
+		}
 	}
 
+	/*clip assembled in memory instead of read from a file (see RunSkinningSelfTest); bones the
+	  map doesn't know yet are added to it, like a model's. uncompressed*/
+	Animation(const aiAnimation* animation, const aiNode* root, std::map<std::string, BoneInfo>& boneInfoMap, int& boneCount)
+	{
+		Read(animation, root, boneInfoMap, boneCount);
+	}
+
+	/*clip baked by house_bake: the hierarchy and the compressed streams come straight from the
+	  bundle, bones are created without raw keys*/
+	Animation(const Bundle& bundle, const std::string& name, Model* model)
+		: m_Duration(0.0f), m_TicksPerSecond(0)
+	{
+		int index = bundle.Find(BundleEntryType::Clip, name);
+		if (index < 0)
+		{
+			std::cout << "ERROR::BUNDLE::CLIP_NOT_FOUND: " << name << std::endl;
+			return;
+		}
+		const uint8_t* data = bundle.Data(index);
+		const BundleClip* header = (const BundleClip*)data;
+		const BundleNode* nodes = (const BundleNode*)(data + sizeof(BundleClip));
+		const char* boneNames = (const char*)(nodes + header->nodeCount);
+		const uint8_t* clip = (const uint8_t*)(boneNames + header->boneCount * BUNDLE_NAME_LENGTH);
+		m_Duration = header->duration;
+		m_TicksPerSecond = (int)header->ticksPerSecond;
+
+		m_Nodes.resize(header->nodeCount);
+		for (uint32_t i = 0; i < header->nodeCount; i++)
+		{
+			m_Nodes[i].name = nodes[i].name;
+			m_Nodes[i].parent = nodes[i].parent;
+			m_Nodes[i].childrenCount = nodes[i].childrenCount;
+			std::memcpy(&m_Nodes[i].transformation, nodes[i].transformation, sizeof(nodes[i].transformation));
+		}
+
+		auto& boneInfoMap = model->GetBoneInfoMap();
+		int& boneCount = model->GetBoneCount();
+		m_Bones.reserve(header->boneCount);
+		for (uint32_t i = 0; i < header->boneCount; i++)
+		{
+			std::string boneName(boneNames + i * BUNDLE_NAME_LENGTH);
+			if (boneInfoMap.find(boneName) == boneInfoMap.end())
+			{
+				boneInfoMap[boneName].id = boneCount;
+				boneCount++;
+			}
+			m_Bones.push_back(Bone(boneName, boneInfoMap[boneName].id));
+		}
+		m_BoneInfoMap = boneInfoMap;
+
+		if (!m_Compressed.Deserialize(clip, header->clipBytes) || m_Compressed.GetTrackCount() != m_Bones.size())
+		{
+			std::cout << "ERROR::BUNDLE::BAD_CLIP: " << name << std::endl;
+			m_Bones.clear();
+			return;
+		}
+		for (size_t i = 0; i < m_Bones.size(); i++)
+			m_Bones[i].UseCompressedTrack(&m_Compressed, i);
+		BuildEvaluationOrder();
+		/*everything above was copied out of the mapping*/
+		bundle.Release(bundle.Entry(index));
+	}
+
+	/*bones point into m_Compressed*/
+	Animation(const Animation&) = delete;
+	Animation& operator=(const Animation&) = delete;
+
 	~Animation()
 	{
 	}
@@ -52,21 +147,41 @@ public:
 	}
 
 	
+	int FindBoneIndex(const std::string& name) const
+	{
+		for (size_t i = 0; i < m_Bones.size(); i++)
+			if (m_Bones[i].GetBoneName() == name) return (int)i;
+		return -1;
+	}
+
+	inline const std::vector<Bone>& GetBones() const { return m_Bones; }
+	/*EvaluationNode::height of each bone, in GetBones() order*/
+	inline const std::vector<int>& GetBoneHeights() const { return m_BoneHeights; }
 	inline float GetTicksPerSecond() { return m_TicksPerSecond; }
 	inline float GetDuration() { return m_Duration;}
-	inline const AssimpNodeData& GetRootNode() { return m_RootNode; }
+	inline const CompressionStats& GetCompressionStats() { return m_Compressed.GetStats(); }
+	inline const CompressedClip& GetCompressedClip() const { return m_Compressed; }
+	inline const std::vector<AssimpNodeData>& GetNodes() const { return m_Nodes; }
+	inline const std::vector<EvaluationNode>& GetEvaluationNodes() const { return m_EvaluationNodes; }
 	inline const std::map<std::string,BoneInfo>& GetBoneIDMap() 
 	{ 
 		return m_BoneInfoMap;
 	}
 
 private:
-	void ReadMissingBones(const aiAnimation* animation, Model& model)
+	void Read(const aiAnimation* animation, const aiNode* root, std::map<std::string, BoneInfo>& boneInfoMap, int& boneCount)
 	{
-		int size = animation->mNumChannels;
+		m_Duration = animation->mDuration;
+		m_TicksPerSecond = animation->mTicksPerSecond;
+		ReadHeirarchyData(root);
+		ReadMissingBones(animation, boneInfoMap, boneCount);
+		BuildEvaluationOrder();
+	}
 
-		auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
-		int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
+	/*boneInfoMap and boneCount are the model's (m_BoneInfoMap and m_BoneCounter)*/
+	void ReadMissingBones(const aiAnimation* animation, std::map<std::string, BoneInfo>& boneInfoMap, int& boneCount)
+	{
+		int size = animation->mNumChannels;
 
 		//reading channels(bones engaged in an animation and their keyframes)
 		for (int i = 0; i < size; i++)
@@ -86,24 +201,92 @@ private:
 		m_BoneInfoMap = boneInfoMap;
 	}
 
-	void ReadHeirarchyData(AssimpNodeData& dest, const aiNode* src)
+	/*flattens the assimp tree with an explicit stack instead of recursive copies*/
+	void ReadHeirarchyData(const aiNode* root)
 	{
-		assert(src);
+		assert(root);
+		std::vector<std::pair<const aiNode*, int>> stack;
+		stack.push_back({ root, -1 });
+		while (!stack.empty())
+		{
+			const aiNode* src = stack.back().first;
+			int parent = stack.back().second;
+			stack.pop_back();
 
-		dest.name = src->mName.data;
-		dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
-		dest.childrenCount = src->mNumChildren;
+			AssimpNodeData dest;
+			dest.name = src->mName.data;
+			dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
+			dest.parent = parent;
+			dest.childrenCount = src->mNumChildren;
+			int index = (int)m_Nodes.size();
+			m_Nodes.push_back(dest);
 
-		for (int i = 0; i < src->mNumChildren; i++)
+			// reversed so children come out in their original order
+			for (int i = (int)src->mNumChildren - 1; i >= 0; i--)
+				stack.push_back({ src->mChildren[i], index });
+		}
+	}
+
+	void BuildEvaluationOrder()
+	{
+		// per source node: nearest kept node at or above it, and for folded nodes the static
+		// transform accumulated since that kept node, which their children inherit
+		std::vector<int> keptAncestor(m_Nodes.size(), -1);
+		std::vector<glm::mat4> folded(m_Nodes.size(), glm::mat4(1.0f));
+		std::vector<bool> isFolded(m_Nodes.size(), false);
+
+		for (size_t i = 0; i < m_Nodes.size(); i++)
 		{
-			AssimpNodeData newData;
-			ReadHeirarchyData(newData, src->mChildren[i]);
-			dest.children.push_back(newData);
+			const AssimpNodeData& node = m_Nodes[i];
+			int bone = FindBoneIndex(node.name);
+			auto info = m_BoneInfoMap.find(node.name);
+			int paletteId = info != m_BoneInfoMap.end() ? info->second.id : -1;
+
+			int parent = node.parent;
+			int keptParent = parent >= 0 ? keptAncestor[parent] : -1;
+			bool betweenIdentity = parent < 0 || !isFolded[parent];
+			glm::mat4 between = betweenIdentity ? glm::mat4(1.0f) : folded[parent];
+
+			if (bone < 0 && paletteId < 0)
+			{
+				// static and deforms nothing: never evaluated, only passed down
+				folded[i] = between * node.transformation;
+				isFolded[i] = true;
+				keptAncestor[i] = keptParent;
+				continue;
+			}
+
+			EvaluationNode evaluation;
+			evaluation.parent = keptParent;
+			evaluation.bone = bone;
+			evaluation.paletteId = paletteId;
+			evaluation.pre = bone >= 0 ? between : between * node.transformation;
+			evaluation.identityPre = bone >= 0 && betweenIdentity;
+			evaluation.offset = paletteId >= 0 ? info->second.offset : glm::mat4(1.0f);
+			evaluation.bind = node.transformation;
+			evaluation.height = 0;
+			evaluation.node = (int)i;
+			keptAncestor[i] = (int)m_EvaluationNodes.size();
+			m_EvaluationNodes.push_back(evaluation);
+		}
+
+		// children come after their parents, so one backward pass settles every height
+		m_BoneHeights.assign(m_Bones.size(), 0);
+		for (int i = (int)m_EvaluationNodes.size() - 1; i >= 0; i--)
+		{
+			const EvaluationNode& node = m_EvaluationNodes[i];
+			if (node.parent >= 0)
+				m_EvaluationNodes[node.parent].height = std::max(m_EvaluationNodes[node.parent].height, node.height + 1);
+			if (node.bone >= 0) m_BoneHeights[node.bone] = node.height;
 		}
 	}
+
 	float m_Duration;
 	int m_TicksPerSecond;
 	std::vector<Bone> m_Bones;
-	AssimpNodeData m_RootNode;
+	CompressedClip m_Compressed;
+	std::vector<AssimpNodeData> m_Nodes;
+	std::vector<EvaluationNode> m_EvaluationNodes;
+	std::vector<int> m_BoneHeights;
 	std::map<std::string, BoneInfo> m_BoneInfoMap;
 };
@@ -0,0 +1,558 @@
+#pragma once
+
+/* Compressed key streams for a whole clip */
+
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include "animdata.h"
+
+struct CompressionSettings
+{
+	bool enabled = true;
+	/*largest error a removed key may introduce, in model units*/
+	float positionTolerance = 0.001f;
+	/*in radians*/
+	float rotationTolerance = 0.001f;
+	float scaleTolerance = 0.0001f;
+};
+
+struct CompressionStats
+{
+	size_t rawBytes = 0;
+	size_t compressedBytes = 0;
+	size_t rawKeys = 0;
+	size_t keptKeys = 0;
+	int constantChannels = 0;
+	int channels = 0;
+	float maxPositionError = 0.0f;
+	float maxRotationError = 0.0f;
+	float maxScaleError = 0.0f;
+	double samplesPerSecond = 0.0;
+};
+
+/*
+	Every bone channel (position, rotation, scale) goes through three steps:
+	1. constant-track elimination: a channel whose keys all match the first one within
+	   tolerance collapses into a single full-precision value
+	2. error-bounded key reduction: keys are dropped recursively (Douglas-Peucker style) as
+	   long as interpolating their neighbours stays within tolerance of every original key
+	3. quantization: times become uint16 fractions of the clip, positions and scales uint16
+	   per component within the channel's own range, rotations "smallest three" (the largest
+	   component is implied, the other three take 15 bits each, its index 2 bits)
+	All keys of the clip then live in one contiguous blob, split into SoA streams
+	(times | positions | rotations | scales | constants) so a pose sample walks a few
+	cache lines instead of three vectors per bone.
+*/
+class CompressedClip
+{
+public:
+	struct Channel
+	{
+		/*1 means constant: valueOffset indexes the float constants*/
+		uint32_t keyCount = 0;
+		uint32_t timeOffset = 0;
+		uint32_t valueOffset = 0;
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 extent = glm::vec3(0.0f);
+	};
+
+	struct Track
+	{
+		Channel position;
+		Channel rotation;
+		Channel scale;
+	};
+
+	/*the key each channel of a track was last sampled at (see SampleTrack)*/
+	struct Cursor
+	{
+		uint32_t position = 0, rotation = 0, scale = 0;
+	};
+
+	CompressedClip() = default;
+
+	/*builds one track per bone, in the order of the bones vector. Source is Bone; it is a
+	  template only so Bone.h can include this header*/
+	template <typename Source>
+	void Build(const std::vector<Source>& bones, float duration, const CompressionSettings& settings)
+	{
+		m_Tracks.clear();
+		m_Tracks.resize(bones.size());
+		m_Stats = CompressionStats();
+
+		float lastTime = duration;
+		for (const Source& bone : bones)
+		{
+			for (const KeyPosition& key : bone.GetPositionKeys()) lastTime = std::max(lastTime, key.timeStamp);
+			for (const KeyRotation& key : bone.GetRotationKeys()) lastTime = std::max(lastTime, key.timeStamp);
+			for (const KeyScale& key : bone.GetScaleKeys()) lastTime = std::max(lastTime, key.timeStamp);
+		}
+		m_TimeScale = lastTime > 0.0f ? lastTime / 65535.0f : 1.0f;
+
+		std::vector<uint16_t> times, positions, rotations, scales;
+		std::vector<float> constants;
+		for (size_t i = 0; i < bones.size(); i++)
+		{
+			const Source& bone = bones[i];
+			Track& track = m_Tracks[i];
+
+			std::vector<glm::vec4> values;
+			std::vector<float> stamps;
+
+			for (const KeyPosition& key : bone.GetPositionKeys()) { values.push_back(glm::vec4(key.position, 0.0f)); stamps.push_back(key.timeStamp); }
+			encodeVector(track.position, values, stamps, settings.positionTolerance, times, positions, constants);
+			m_Stats.rawBytes += values.size() * sizeof(KeyPosition);
+
+			values.clear(); stamps.clear();
+			for (const KeyRotation& key : bone.GetRotationKeys())
+			{
+				glm::quat q = glm::normalize(key.orientation);
+				values.push_back(glm::vec4(q.x, q.y, q.z, q.w));
+				stamps.push_back(key.timeStamp);
+			}
+			encodeRotation(track.rotation, values, stamps, settings.rotationTolerance, times, rotations, constants);
+			m_Stats.rawBytes += values.size() * sizeof(KeyRotation);
+
+			values.clear(); stamps.clear();
+			for (const KeyScale& key : bone.GetScaleKeys()) { values.push_back(glm::vec4(key.scale, 0.0f)); stamps.push_back(key.timeStamp); }
+			encodeVector(track.scale, values, stamps, settings.scaleTolerance, times, scales, constants);
+			m_Stats.rawBytes += values.size() * sizeof(KeyScale);
+		}
+
+		// lay the streams out back to back; every section starts 4-byte aligned
+		auto align = [](size_t offset) { return (offset + 3) & ~size_t(3); };
+		m_TimeSection = 0;
+		m_PositionSection = align(m_TimeSection + times.size() * sizeof(uint16_t));
+		m_RotationSection = align(m_PositionSection + positions.size() * sizeof(uint16_t));
+		m_ScaleSection = align(m_RotationSection + rotations.size() * sizeof(uint16_t));
+		m_ConstantSection = align(m_ScaleSection + scales.size() * sizeof(uint16_t));
+		m_Blob.assign(m_ConstantSection + constants.size() * sizeof(float), 0);
+		if (!times.empty()) std::memcpy(&m_Blob[m_TimeSection], times.data(), times.size() * sizeof(uint16_t));
+		if (!positions.empty()) std::memcpy(&m_Blob[m_PositionSection], positions.data(), positions.size() * sizeof(uint16_t));
+		if (!rotations.empty()) std::memcpy(&m_Blob[m_RotationSection], rotations.data(), rotations.size() * sizeof(uint16_t));
+		if (!scales.empty()) std::memcpy(&m_Blob[m_ScaleSection], scales.data(), scales.size() * sizeof(uint16_t));
+		if (!constants.empty()) std::memcpy(&m_Blob[m_ConstantSection], constants.data(), constants.size() * sizeof(float));
+
+		m_Stats.compressedBytes = m_Blob.size() + m_Tracks.size() * sizeof(Track);
+		m_Stats.channels = (int)m_Tracks.size() * 3;
+		measureError(bones);
+		measureThroughput(duration);
+	}
+
+	size_t GetTrackCount() const { return m_Tracks.size(); }
+	const CompressionStats& GetStats() const { return m_Stats; }
+
+	glm::vec3 SamplePosition(size_t track, float time) const
+	{
+		uint32_t cursor = 0;
+		return sampleVector(m_Tracks[track].position, m_PositionSection, time, 0.0f, cursor);
+	}
+
+	glm::vec3 SampleScale(size_t track, float time) const
+	{
+		uint32_t cursor = 0;
+		return sampleVector(m_Tracks[track].scale, m_ScaleSection, time, 1.0f, cursor);
+	}
+
+	glm::quat SampleRotation(size_t track, float time) const
+	{
+		uint32_t cursor = 0;
+		return sampleRotation(m_Tracks[track].rotation, time, cursor);
+	}
+
+	/*all three channels of a track, each key search starting from where the last one on this
+	  cursor ended. playback moves forward a key or so per frame, so the binary search the
+	  single channel calls do every time is left for jumps (a loop wrapping, a seek). the
+	  cursor belongs to the caller: one per track per evaluator, since clips are shared*/
+	void SampleTrack(size_t track, float time, Cursor& cursor, glm::vec3& position, glm::quat& rotation, glm::vec3& scale) const
+	{
+		const Track& t = m_Tracks[track];
+		position = sampleVector(t.position, m_PositionSection, time, 0.0f, cursor.position);
+		rotation = sampleRotation(t.rotation, time, cursor.rotation);
+		scale = sampleVector(t.scale, m_ScaleSection, time, 1.0f, cursor.scale);
+	}
+
+	void PrintReport(const std::string& name) const
+	{
+		const CompressionStats& s = m_Stats;
+		std::cout << "Clip " << name << ": " << s.channels << " channels (" << s.constantChannels << " constant), "
+			<< s.keptKeys << "/" << s.rawKeys << " keys kept, "
+			<< s.rawBytes / 1024.0f << " KB -> " << s.compressedBytes / 1024.0f << " KB ("
+			<< (s.rawBytes ? 100.0f * s.compressedBytes / s.rawBytes : 0.0f) << "%), max error pos "
+			<< s.maxPositionError << " rot " << s.maxRotationError << " rad scale " << s.maxScaleError
+			<< ", decode " << s.samplesPerSecond / 1e6 << " M channel samples/s" << std::endl;
+	}
+
+	/*flat copy of the clip for the asset bundle: header, tracks, blob*/
+	size_t SerializedSize() const
+	{
+		return sizeof(SerializedHeader) + m_Tracks.size() * sizeof(Track) + m_Blob.size();
+	}
+
+	void Serialize(uint8_t* out) const
+	{
+		SerializedHeader header;
+		header.trackCount = (uint32_t)m_Tracks.size();
+		header.blobSize = (uint32_t)m_Blob.size();
+		header.sections[0] = (uint32_t)m_TimeSection;
+		header.sections[1] = (uint32_t)m_PositionSection;
+		header.sections[2] = (uint32_t)m_RotationSection;
+		header.sections[3] = (uint32_t)m_ScaleSection;
+		header.sections[4] = (uint32_t)m_ConstantSection;
+		header.timeScale = m_TimeScale;
+		header.stats = m_Stats;
+		std::memcpy(out, &header, sizeof(header));
+		out += sizeof(header);
+		if (!m_Tracks.empty()) std::memcpy(out, m_Tracks.data(), m_Tracks.size() * sizeof(Track));
+		out += m_Tracks.size() * sizeof(Track);
+		if (!m_Blob.empty()) std::memcpy(out, m_Blob.data(), m_Blob.size());
+	}
+
+	bool Deserialize(const uint8_t* data, size_t size)
+	{
+		SerializedHeader header;
+		if (size < sizeof(header)) return false;
+		std::memcpy(&header, data, sizeof(header));
+		if (size < sizeof(header) + header.trackCount * sizeof(Track) + header.blobSize) return false;
+		data += sizeof(header);
+		m_Tracks.resize(header.trackCount);
+		if (header.trackCount) std::memcpy(m_Tracks.data(), data, header.trackCount * sizeof(Track));
+		data += header.trackCount * sizeof(Track);
+		m_Blob.assign(data, data + header.blobSize);
+		m_TimeSection = header.sections[0];
+		m_PositionSection = header.sections[1];
+		m_RotationSection = header.sections[2];
+		m_ScaleSection = header.sections[3];
+		m_ConstantSection = header.sections[4];
+		m_TimeScale = header.timeScale;
+		m_Stats = header.stats;
+		return true;
+	}
+
+private:
+	struct SerializedHeader
+	{
+		uint32_t trackCount = 0;
+		uint32_t blobSize = 0;
+		uint32_t sections[5] = {};
+		float timeScale = 1.0f;
+		CompressionStats stats;
+	};
+
+	std::vector<Track> m_Tracks;
+	std::vector<uint8_t> m_Blob;
+	size_t m_TimeSection = 0, m_PositionSection = 0, m_RotationSection = 0, m_ScaleSection = 0, m_ConstantSection = 0;
+	float m_TimeScale = 1.0f;
+	CompressionStats m_Stats;
+
+	const float* constants() const { return reinterpret_cast<const float*>(&m_Blob[m_ConstantSection]); }
+
+	uint16_t quantizeTime(float time) const
+	{
+		float q = std::round(time / m_TimeScale);
+		return (uint16_t)std::min(65535.0f, std::max(0.0f, q));
+	}
+
+	/*index of the key at or before time, and the blend factor towards the next one. the
+	  search walks a few keys forward from cursor before it falls back to bisecting, and
+	  leaves cursor at the key found*/
+	uint32_t findKey(const Channel& channel, float time, float& factor, uint32_t& cursor) const
+	{
+		const uint16_t* stamps = reinterpret_cast<const uint16_t*>(&m_Blob[m_TimeSection]) + channel.timeOffset;
+		float t = time / m_TimeScale;
+		uint32_t lastKey = channel.keyCount - 1;
+		if (t <= stamps[0]) { factor = 0.0f; cursor = 0; return 0; }
+		if (t >= stamps[lastKey]) { factor = 0.0f; cursor = lastKey; return lastKey; }
+		uint32_t low = std::min(cursor, lastKey - 1);
+		if (stamps[low] <= t)
+			for (int step = 0; step < 4 && stamps[low + 1] <= t; step++) low++;
+		if (stamps[low] > t || stamps[low + 1] <= t)
+		{
+			low = 0;
+			uint32_t high = lastKey;
+			while (high - low > 1)
+			{
+				uint32_t mid = (low + high) / 2;
+				if (stamps[mid] <= t) low = mid;
+				else high = mid;
+			}
+		}
+		cursor = low;
+		factor = (t - stamps[low]) / float(stamps[low + 1] - stamps[low]);
+		return low;
+	}
+
+	glm::quat sampleRotation(const Channel& channel, float time, uint32_t& cursor) const
+	{
+		if (channel.keyCount == 0) return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		if (channel.keyCount == 1)
+		{
+			const float* c = constants() + channel.valueOffset;
+			return glm::quat(c[3], c[0], c[1], c[2]);
+		}
+		float factor;
+		uint32_t key = findKey(channel, time, factor, cursor);
+		const uint16_t* stream = reinterpret_cast<const uint16_t*>(&m_Blob[m_RotationSection]) + channel.valueOffset;
+		glm::quat a = unpackRotation(stream + key * 3);
+		if (factor <= 0.0f) return a;
+		glm::quat b = unpackRotation(stream + (key + 1) * 3);
+		return glm::normalize(glm::slerp(a, b, factor));
+	}
+
+	glm::vec3 sampleVector(const Channel& channel, size_t section, float time, float missing, uint32_t& cursor) const
+	{
+		if (channel.keyCount == 0) return glm::vec3(missing);
+		if (channel.keyCount == 1)
+		{
+			const float* c = constants() + channel.valueOffset;
+			return glm::vec3(c[0], c[1], c[2]);
+		}
+		float factor;
+		uint32_t key = findKey(channel, time, factor, cursor);
+		const uint16_t* stream = reinterpret_cast<const uint16_t*>(&m_Blob[section]) + channel.valueOffset;
+		glm::vec3 a = dequantize(channel, stream + key * 3);
+		if (factor <= 0.0f) return a;
+		return glm::mix(a, dequantize(channel, stream + (key + 1) * 3), factor);
+	}
+
+	static glm::vec3 dequantize(const Channel& channel, const uint16_t* q)
+	{
+		return channel.min + channel.extent * glm::vec3(q[0], q[1], q[2]) * (1.0f / 65535.0f);
+	}
+
+	/*smallest three: 2-bit index of the dropped component in the top bits of the first two
+	  words, the other three components in 15 bits each over [-1/sqrt2, 1/sqrt2]*/
+	static void packRotation(glm::vec4 q, uint16_t* out)
+	{
+		int largest = 0;
+		for (int i = 1; i < 4; i++)
+			if (std::fabs(q[i]) > std::fabs(q[largest])) largest = i;
+		if (q[largest] < 0.0f) q = -q;
+		const float range = 0.70710678f;
+		int o = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (i == largest) continue;
+			float n = (std::min(range, std::max(-range, q[i])) + range) / (2.0f * range);
+			out[o++] = (uint16_t)std::round(n * 32767.0f);
+		}
+		out[0] |= (uint16_t)((largest & 1) << 15);
+		out[1] |= (uint16_t)((largest >> 1) << 15);
+	}
+
+	static glm::quat unpackRotation(const uint16_t* in)
+	{
+		const float range = 0.70710678f;
+		int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+		float c[4];
+		float sum = 0.0f;
+		int o = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (i == largest) continue;
+			c[i] = (in[o++] & 0x7FFF) * (2.0f * range / 32767.0f) - range;
+			sum += c[i] * c[i];
+		}
+		c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+		return glm::quat(c[3], c[0], c[1], c[2]);
+	}
+
+	/*angle of the rotation between a and b. acos of their dot product only resolves about 7e-4 rad
+	  in float near 1, coarser than the tolerances; atan2 of the relative rotation stays accurate*/
+	static float rotationError(const glm::vec4& a, const glm::vec4& b)
+	{
+		glm::quat relative = glm::conjugate(glm::quat(a.w, a.x, a.y, a.z)) * glm::quat(b.w, b.x, b.y, b.z);
+		float s = glm::length(glm::vec3(relative.x, relative.y, relative.z));
+		return 2.0f * std::atan2(s, std::fabs(relative.w));
+	}
+
+	static glm::vec4 slerp4(const glm::vec4& a, const glm::vec4& b, float t)
+	{
+		glm::quat q = glm::slerp(glm::quat(a.w, a.x, a.y, a.z), glm::quat(b.w, b.x, b.y, b.z), t);
+		q = glm::normalize(q);
+		return glm::vec4(q.x, q.y, q.z, q.w);
+	}
+
+	/*Douglas-Peucker over time: keep [first,last], split at the worst key until every dropped
+	  key is reproduced within tolerance by interpolating the kept ones*/
+	static void reduce(const std::vector<glm::vec4>& values, const std::vector<float>& stamps, bool rotation,
+		float tolerance, size_t first, size_t last, std::vector<bool>& keep)
+	{
+		if (last <= first + 1) return;
+		float worst = 0.0f;
+		size_t worstIndex = first;
+		for (size_t i = first + 1; i < last; i++)
+		{
+			float span = stamps[last] - stamps[first];
+			float t = span > 0.0f ? (stamps[i] - stamps[first]) / span : 0.0f;
+			float error = rotation
+				? rotationError(slerp4(values[first], values[last], t), values[i])
+				: glm::length(glm::vec3(glm::mix(values[first], values[last], t) - values[i]));
+			if (error > worst) { worst = error; worstIndex = i; }
+		}
+		if (worst <= tolerance) return;
+		keep[worstIndex] = true;
+		reduce(values, stamps, rotation, tolerance, first, worstIndex, keep);
+		reduce(values, stamps, rotation, tolerance, worstIndex, last, keep);
+	}
+
+	/*shared front half of both encoders: constant check and key reduction*/
+	bool selectKeys(const std::vector<glm::vec4>& values, const std::vector<float>& stamps, bool rotation,
+		float tolerance, std::vector<size_t>& kept)
+	{
+		m_Stats.rawKeys += values.size();
+		kept.clear();
+		if (values.empty()) return false;
+
+		bool constant = true;
+		for (size_t i = 1; i < values.size() && constant; i++)
+		{
+			float error = rotation ? rotationError(values[0], values[i]) : glm::length(glm::vec3(values[i] - values[0]));
+			constant = error <= tolerance;
+		}
+		if (constant)
+		{
+			kept.push_back(0);
+			m_Stats.keptKeys++;
+			m_Stats.constantChannels++;
+			return true;
+		}
+
+		std::vector<bool> keep(values.size(), false);
+		keep.front() = keep.back() = true;
+		reduce(values, stamps, rotation, tolerance, 0, values.size() - 1, keep);
+		for (size_t i = 0; i < values.size(); i++)
+			if (keep[i]) kept.push_back(i);
+		m_Stats.keptKeys += kept.size();
+		return kept.size() == 1;
+	}
+
+	void writeTimes(Channel& channel, const std::vector<float>& stamps, const std::vector<size_t>& kept, std::vector<uint16_t>& times)
+	{
+		channel.keyCount = (uint32_t)kept.size();
+		channel.timeOffset = (uint32_t)times.size();
+		// keys closer than one time step would quantize to the same time and the decoder could only
+		// reach one of them. dropping either breaks the error bound, so a colliding key moves to the
+		// next free step instead: its value is kept and it is off in time by a step or two at most
+		std::vector<int> ticks(kept.size());
+		for (size_t i = 0; i < kept.size(); i++)
+		{
+			ticks[i] = quantizeTime(stamps[kept[i]]);
+			if (i > 0) ticks[i] = std::max(ticks[i], ticks[i - 1] + 1);
+		}
+		// and back from the end of the range if that ran past it
+		for (size_t i = kept.size(); i-- > 0;)
+		{
+			int limit = i + 1 < kept.size() ? ticks[i + 1] - 1 : 65535;
+			ticks[i] = std::max(0, std::min(ticks[i], limit));
+		}
+		for (int tick : ticks) times.push_back((uint16_t)tick);
+	}
+
+	void encodeVector(Channel& channel, const std::vector<glm::vec4>& values, const std::vector<float>& stamps,
+		float tolerance, std::vector<uint16_t>& times, std::vector<uint16_t>& stream, std::vector<float>& constants)
+	{
+		std::vector<size_t> kept;
+		if (selectKeys(values, stamps, false, tolerance, kept))
+		{
+			channel.keyCount = 1;
+			channel.valueOffset = (uint32_t)constants.size();
+			const glm::vec4& v = values[kept[0]];
+			constants.insert(constants.end(), { v.x, v.y, v.z });
+			return;
+		}
+		if (kept.empty()) return;
+
+		glm::vec3 low(values[kept[0]]), high(values[kept[0]]);
+		for (size_t index : kept)
+		{
+			low = glm::min(low, glm::vec3(values[index]));
+			high = glm::max(high, glm::vec3(values[index]));
+		}
+		channel.min = low;
+		channel.extent = high - low;
+		writeTimes(channel, stamps, kept, times);
+		channel.valueOffset = (uint32_t)stream.size();
+		for (size_t index : kept)
+		{
+			glm::vec3 v(values[index]);
+			for (int c = 0; c < 3; c++)
+			{
+				float n = channel.extent[c] > 0.0f ? (v[c] - low[c]) / channel.extent[c] : 0.0f;
+				stream.push_back((uint16_t)std::round(std::min(1.0f, std::max(0.0f, n)) * 65535.0f));
+			}
+		}
+	}
+
+	void encodeRotation(Channel& channel, const std::vector<glm::vec4>& values, const std::vector<float>& stamps,
+		float tolerance, std::vector<uint16_t>& times, std::vector<uint16_t>& stream, std::vector<float>& constants)
+	{
+		std::vector<size_t> kept;
+		if (selectKeys(values, stamps, true, tolerance, kept))
+		{
+			channel.keyCount = 1;
+			channel.valueOffset = (uint32_t)constants.size();
+			const glm::vec4& v = values[kept[0]];
+			constants.insert(constants.end(), { v.x, v.y, v.z, v.w });
+			return;
+		}
+		if (kept.empty()) return;
+
+		writeTimes(channel, stamps, kept, times);
+		channel.valueOffset = (uint32_t)stream.size();
+		for (size_t index : kept)
+		{
+			uint16_t packed[3];
+			packRotation(values[index], packed);
+			stream.insert(stream.end(), packed, packed + 3);
+		}
+	}
+
+	/*worst deviation from the source keys, checked at every original key time*/
+	template <typename Source>
+	void measureError(const std::vector<Source>& bones)
+	{
+		for (size_t i = 0; i < bones.size(); i++)
+		{
+			for (const KeyPosition& key : bones[i].GetPositionKeys())
+				m_Stats.maxPositionError = std::max(m_Stats.maxPositionError, glm::length(SamplePosition(i, key.timeStamp) - key.position));
+			for (const KeyRotation& key : bones[i].GetRotationKeys())
+			{
+				glm::quat q = SampleRotation(i, key.timeStamp);
+				glm::quat r = glm::normalize(key.orientation);
+				m_Stats.maxRotationError = std::max(m_Stats.maxRotationError,
+					rotationError(glm::vec4(q.x, q.y, q.z, q.w), glm::vec4(r.x, r.y, r.z, r.w)));
+			}
+			for (const KeyScale& key : bones[i].GetScaleKeys())
+				m_Stats.maxScaleError = std::max(m_Stats.maxScaleError, glm::length(SampleScale(i, key.timeStamp) - key.scale));
+		}
+	}
+
+	void measureThroughput(float duration)
+	{
+		if (m_Tracks.empty()) return;
+		const int steps = 256;
+		// volatile keeps the decode loop from being optimized away
+		volatile float sink = 0.0f;
+		auto start = std::chrono::steady_clock::now();
+		for (int s = 0; s < steps; s++)
+		{
+			float time = duration * s / steps;
+			for (size_t t = 0; t < m_Tracks.size(); t++)
+			{
+				sink = sink + SamplePosition(t, time).x + SampleScale(t, time).x + SampleRotation(t, time).w;
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		m_Stats.samplesPerSecond = seconds > 0.0 ? steps * m_Tracks.size() * 3 / seconds : 0.0;
+	}
+};
@@ -0,0 +1,699 @@
+#pragma once
+
+/* Blend tree / state machine evaluated into a pooled local pose */
+
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include "Animation.h"
+#include "Bone.h"
+#include "PoseEvaluator.h"
+
+/*local (parent-relative) transform of one skeleton node*/
+struct LocalTransform
+{
+	glm::vec3 translation = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+};
+
+inline LocalTransform Decompose(const glm::mat4& m)
+{
+	LocalTransform t;
+	t.translation = glm::vec3(m[3]);
+	glm::mat3 rotation(m);
+	for (int i = 0; i < 3; i++)
+	{
+		t.scale[i] = glm::length(rotation[i]);
+		if (t.scale[i] > 0.0f) rotation[i] /= t.scale[i];
+	}
+	t.rotation = glm::normalize(glm::quat_cast(rotation));
+	return t;
+}
+
+inline glm::mat4 Compose(const LocalTransform& t)
+{
+	return glm::translate(glm::mat4(1.0f), t.translation) * glm::toMat4(t.rotation)
+		* glm::scale(glm::mat4(1.0f), t.scale);
+}
+
+/*out = a..b at weight; rotations take the short way round and are nlerped, which is
+  what every blend does per frame anyway and far cheaper than slerp*/
+inline void BlendPoses(const LocalTransform* a, const LocalTransform* b, float weight, LocalTransform* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::quat rb = b[i].rotation;
+		if (glm::dot(a[i].rotation, rb) < 0.0f) rb = -rb;
+		out[i].translation = glm::mix(a[i].translation, b[i].translation, weight);
+		out[i].rotation = glm::normalize(a[i].rotation * (1.0f - weight) + rb * weight);
+		out[i].scale = glm::mix(a[i].scale, b[i].scale, weight);
+	}
+}
+
+/*
+	The source clip's flattened hierarchy (Animation::GetEvaluationNodes): only nodes that are
+	animated or deform vertices, parents first, with the static nodes in between folded into
+	pre, so global = global[parent] * pre * local. Which nodes are animated is decided by the
+	source clip; the other clips of the graph are expected to come from the same rig.
+*/
+struct Skeleton
+{
+	std::vector<std::string> names;
+	std::vector<int> parents;
+	std::vector<LocalTransform> bindPose;
+	/*index into the bone palette, -1 for nodes that do not deform anything*/
+	std::vector<int> boneIds;
+	std::vector<glm::mat4> offsets;
+	std::vector<glm::mat4> pre;
+	std::vector<bool> identityPre;
+	/*has a channel; the others have their own transform in pre and an identity local*/
+	std::vector<bool> animated;
+	/*EvaluationNode::height, which animation LOD masks by*/
+	std::vector<int> heights;
+	int animatedCount = 0;
+
+	Skeleton() = default;
+
+	explicit Skeleton(Animation& animation)
+	{
+		for (const EvaluationNode& node : animation.GetEvaluationNodes())
+		{
+			names.push_back(animation.GetNodes()[node.node].name);
+			parents.push_back(node.parent);
+			bindPose.push_back(node.bone >= 0 ? Decompose(node.bind) : LocalTransform());
+			boneIds.push_back(node.paletteId);
+			offsets.push_back(node.offset);
+			pre.push_back(node.pre);
+			identityPre.push_back(node.identityPre);
+			animated.push_back(node.bone >= 0);
+			heights.push_back(node.height);
+			if (node.bone >= 0) animatedCount++;
+		}
+	}
+
+	size_t size() const { return names.size(); }
+};
+
+/*
+	Per-frame arena of poses. The graph works out at build time how many intermediate poses
+	its worst frame can need and allocates them once; Acquire only bumps an index and Reset
+	rewinds it at the start of the next frame, so blending never touches the heap.
+*/
+class PosePool
+{
+public:
+	void Reserve(size_t poses, size_t bones)
+	{
+		m_Bones = bones;
+		m_Capacity = poses;
+		m_Storage.assign(poses * bones, LocalTransform());
+		m_Used = 0;
+	}
+
+	void Reset() { m_Used = 0; }
+
+	LocalTransform* Acquire()
+	{
+		if (m_Used >= m_Capacity)
+		{
+			// cannot happen with a correct TempPoses() count; reuse the last slot rather than allocate
+			std::cout << "ERROR::POSE_POOL::EXHAUSTED" << std::endl;
+			return m_Capacity ? &m_Storage[(m_Capacity - 1) * m_Bones] : nullptr;
+		}
+		m_HighWater = std::max(m_HighWater, m_Used + 1);
+		return &m_Storage[m_Used++ * m_Bones];
+	}
+
+	size_t Used() const { return m_Used; }
+	size_t Capacity() const { return m_Capacity; }
+	size_t HighWater() const { return m_HighWater; }
+
+private:
+	std::vector<LocalTransform> m_Storage;
+	size_t m_Bones = 0;
+	size_t m_Capacity = 0;
+	size_t m_Used = 0;
+	size_t m_HighWater = 0;
+};
+
+struct GraphStats
+{
+	int clipsSampled = 0;
+	int channelsSampled = 0;
+	/*skeleton nodes sampled by at least one clip, after the LOD mask*/
+	int bonesSampled = 0;
+	int blends = 0;
+	size_t posesUsed = 0;
+	size_t poseCapacity = 0;
+	/*worst case clips sampled in one frame, fixed by the graph's shape*/
+	int clipBudget = 0;
+	float evaluateMs = 0.0f;
+};
+
+struct GraphContext
+{
+	const Skeleton& skeleton;
+	PosePool& pool;
+	const std::vector<float>& parameters;
+	GraphStats& stats;
+	/*nodes this many levels above the end of their chain or less keep the bind pose (AnimationLOD)*/
+	int skipLeafLevels;
+	/*per skeleton node, set by the clips that sampled it this frame*/
+	std::vector<uint8_t>& sampled;
+};
+
+class AnimNode
+{
+public:
+	virtual ~AnimNode() = default;
+	/*advance local time*/
+	virtual void Update(float dt) = 0;
+	/*write a full local pose into out*/
+	virtual void Evaluate(GraphContext& context, LocalTransform* out) = 0;
+	/*restart, e.g. when a state machine enters this node*/
+	virtual void Reset() {}
+	/*pool poses this node (including its children) may hold at once*/
+	virtual int TempPoses() const { return 0; }
+	/*clips this node (including its children) may sample in one frame*/
+	virtual int ClipBudget() const = 0;
+};
+
+/*plays one clip, looping. the clip's channels are sampled in one batch by a PoseEvaluator
+  (on the job system for big skeletons) and only then scattered into the skeleton's order*/
+class ClipNode : public AnimNode
+{
+public:
+	ClipNode(Animation* clip, const Skeleton& skeleton, float speed = 1.0f)
+		: m_Clip(clip), m_Speed(speed)
+	{
+		m_Tracks.reserve(skeleton.size());
+		// channels no skeleton node reads are never sampled; the rest carry their node's height
+		// so the LOD mask can skip them in the evaluator
+		m_Heights.assign(clip->GetBones().size(), -1);
+		for (size_t i = 0; i < skeleton.size(); i++)
+		{
+			int track = skeleton.animated[i] ? clip->FindBoneIndex(skeleton.names[i]) : -1;
+			m_Tracks.push_back(track);
+			if (track >= 0) m_Heights[track] = skeleton.heights[i];
+		}
+	}
+
+	void Update(float dt) override
+	{
+		// a single-key clip has zero duration; hold its only pose rather than fmod into NaN
+		float duration = m_Clip->GetDuration();
+		if (duration <= 0.0f)
+		{
+			m_Time = 0.0f;
+			return;
+		}
+		m_Time += m_Clip->GetTicksPerSecond() * dt * m_Speed;
+		m_Time = fmod(m_Time, duration);
+		if (m_Time < 0.0f) m_Time += duration;
+	}
+
+	void Evaluate(GraphContext& context, LocalTransform* out) override
+	{
+		EvaluateAt(context, m_Time, out);
+	}
+
+	void EvaluateAt(GraphContext& context, float time, LocalTransform* out) const
+	{
+		const Skeleton& skeleton = context.skeleton;
+		context.stats.channelsSampled += 3 * m_Evaluator.Sample(m_Clip->GetBones(), time, &m_Heights, context.skipLeafLevels);
+		const PoseSoA& pose = m_Evaluator.GetPose();
+		for (size_t i = 0; i < m_Tracks.size(); i++)
+		{
+			int track = m_Tracks[i];
+			if (track >= 0 && skeleton.heights[i] >= context.skipLeafLevels)
+			{
+				context.sampled[i] = 1;
+				out[i].translation = glm::vec3(pose.tx[track], pose.ty[track], pose.tz[track]);
+				out[i].rotation = glm::quat(pose.qw[track], pose.qx[track], pose.qy[track], pose.qz[track]);
+				out[i].scale = glm::vec3(pose.sx[track], pose.sy[track], pose.sz[track]);
+			}
+			else
+				out[i] = skeleton.bindPose[i];
+		}
+		context.stats.clipsSampled++;
+	}
+
+	void Reset() override { m_Time = 0.0f; }
+	int ClipBudget() const override { return 1; }
+
+	void SetSpeed(float speed) { m_Speed = speed; }
+
+private:
+	Animation* m_Clip;
+	/*index into the clip's bones driving each skeleton node, or -1 for the bind pose*/
+	std::vector<int> m_Tracks;
+	/*per clip bone: the height of the skeleton node reading it, -1 when none does*/
+	std::vector<int> m_Heights;
+	/*scratch for EvaluateAt, which is const so the additive reference can be sampled too*/
+	mutable PoseEvaluator m_Evaluator;
+	float m_Speed;
+	float m_Time = 0.0f;
+};
+
+/*blends the two children whose thresholds bracket a float parameter*/
+class BlendSpace1D : public AnimNode
+{
+public:
+	explicit BlendSpace1D(int parameter) : m_Parameter(parameter) {}
+
+	void AddChild(AnimNode* node, float threshold)
+	{
+		auto at = std::find_if(m_Children.begin(), m_Children.end(),
+			[&](const Child& child) { return child.threshold > threshold; });
+		m_Children.insert(at, Child{ node, threshold });
+	}
+
+	void Update(float dt) override
+	{
+		for (Child& child : m_Children) child.node->Update(dt);
+	}
+
+	void Evaluate(GraphContext& context, LocalTransform* out) override
+	{
+		if (m_Children.empty()) return;
+		float value = context.parameters[m_Parameter];
+		size_t upper = 0;
+		while (upper < m_Children.size() && m_Children[upper].threshold < value) upper++;
+		if (upper == 0 || upper == m_Children.size())
+		{
+			m_Children[upper == 0 ? 0 : upper - 1].node->Evaluate(context, out);
+			return;
+		}
+		const Child& a = m_Children[upper - 1];
+		const Child& b = m_Children[upper];
+		float weight = (value - a.threshold) / (b.threshold - a.threshold);
+		LocalTransform* poseA = context.pool.Acquire();
+		LocalTransform* poseB = context.pool.Acquire();
+		a.node->Evaluate(context, poseA);
+		b.node->Evaluate(context, poseB);
+		BlendPoses(poseA, poseB, weight, out, context.skeleton.size());
+		context.stats.blends++;
+	}
+
+	void Reset() override
+	{
+		for (Child& child : m_Children) child.node->Reset();
+	}
+
+	int TempPoses() const override
+	{
+		int worst = 0;
+		for (const Child& child : m_Children) worst = std::max(worst, child.node->TempPoses());
+		return 2 + 2 * worst;
+	}
+
+	int ClipBudget() const override
+	{
+		// two children at most, the two most expensive in the worst case
+		std::vector<int> costs;
+		for (const Child& child : m_Children) costs.push_back(child.node->ClipBudget());
+		std::sort(costs.rbegin(), costs.rend());
+		return (costs.size() > 0 ? costs[0] : 0) + (costs.size() > 1 ? costs[1] : 0);
+	}
+
+private:
+	struct Child
+	{
+		AnimNode* node;
+		float threshold;
+	};
+	std::vector<Child> m_Children;
+	int m_Parameter;
+};
+
+/*
+	Scattered 2D blend space (e.g. strafe direction x speed). Weights are inverse squared
+	distance to each sample, then only the three strongest are kept and renormalized so the
+	cost stays at three clips however many samples the space has.
+*/
+class BlendSpace2D : public AnimNode
+{
+public:
+	static const int MAX_ACTIVE = 3;
+
+	BlendSpace2D(int parameterX, int parameterY) : m_ParameterX(parameterX), m_ParameterY(parameterY) {}
+
+	void AddChild(AnimNode* node, glm::vec2 position)
+	{
+		m_Children.push_back(Child{ node, position, 0.0f });
+	}
+
+	void Update(float dt) override
+	{
+		for (Child& child : m_Children) child.node->Update(dt);
+	}
+
+	void Evaluate(GraphContext& context, LocalTransform* out) override
+	{
+		if (m_Children.empty()) return;
+		glm::vec2 point(context.parameters[m_ParameterX], context.parameters[m_ParameterY]);
+
+		int active[MAX_ACTIVE];
+		int count = 0;
+		for (size_t i = 0; i < m_Children.size(); i++)
+		{
+			glm::vec2 d = point - m_Children[i].position;
+			float distance2 = glm::dot(d, d);
+			// sitting exactly on a sample plays that sample alone
+			if (distance2 < 1e-8f)
+			{
+				m_Children[i].node->Evaluate(context, out);
+				return;
+			}
+			m_Children[i].weight = 1.0f / distance2;
+			// insertion into the small sorted list of strongest samples
+			int at = count < MAX_ACTIVE ? count++ : MAX_ACTIVE;
+			while (at > 0 && m_Children[active[at - 1]].weight < m_Children[i].weight)
+			{
+				if (at < MAX_ACTIVE) active[at] = active[at - 1];
+				at--;
+			}
+			if (at < MAX_ACTIVE) active[at] = (int)i;
+		}
+
+		// accumulate: each further sample is blended in by its share of the running total
+		float total = m_Children[active[0]].weight;
+		m_Children[active[0]].node->Evaluate(context, out);
+		LocalTransform* pose = count > 1 ? context.pool.Acquire() : nullptr;
+		for (int k = 1; k < count; k++)
+		{
+			const Child& child = m_Children[active[k]];
+			total += child.weight;
+			child.node->Evaluate(context, pose);
+			BlendPoses(out, pose, child.weight / total, out, context.skeleton.size());
+			context.stats.blends++;
+		}
+	}
+
+	void Reset() override
+	{
+		for (Child& child : m_Children) child.node->Reset();
+	}
+
+	int TempPoses() const override
+	{
+		int worst = 0;
+		for (const Child& child : m_Children) worst = std::max(worst, child.node->TempPoses());
+		return 1 + MAX_ACTIVE * worst;
+	}
+
+	int ClipBudget() const override
+	{
+		std::vector<int> costs;
+		for (const Child& child : m_Children) costs.push_back(child.node->ClipBudget());
+		std::sort(costs.rbegin(), costs.rend());
+		int budget = 0;
+		for (size_t i = 0; i < costs.size() && i < (size_t)MAX_ACTIVE; i++) budget += costs[i];
+		return budget;
+	}
+
+private:
+	struct Child
+	{
+		AnimNode* node;
+		glm::vec2 position;
+		float weight;
+	};
+	std::vector<Child> m_Children;
+	int m_ParameterX, m_ParameterY;
+};
+
+/*
+	Layers the difference between an additive clip and its first frame on top of a base pose,
+	scaled by a weight parameter (e.g. breathing or a flinch over any locomotion).
+*/
+class AdditiveNode : public AnimNode
+{
+public:
+	AdditiveNode(AnimNode* base, ClipNode* additive, int weightParameter, const Skeleton& skeleton)
+		: m_Base(base), m_Additive(additive), m_Parameter(weightParameter)
+	{
+		m_Reference.resize(skeleton.size());
+	}
+
+	void Update(float dt) override
+	{
+		m_Base->Update(dt);
+		m_Additive->Update(dt);
+	}
+
+	void Evaluate(GraphContext& context, LocalTransform* out) override
+	{
+		m_Base->Evaluate(context, out);
+		float weight = context.parameters[m_Parameter];
+		if (weight <= 0.0f) return;
+		if (!m_HasReference)
+		{
+			// kept for good, so sampled in full whatever the LOD is this frame
+			GraphContext full = context;
+			full.skipLeafLevels = 0;
+			m_Additive->EvaluateAt(full, 0.0f, m_Reference.data());
+			m_HasReference = true;
+		}
+		LocalTransform* layer = context.pool.Acquire();
+		m_Additive->Evaluate(context, layer);
+		const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+		for (size_t i = 0; i < context.skeleton.size(); i++)
+		{
+			// nodes under the LOD mask hold the bind pose in both; no delta to add
+			if (context.skeleton.heights[i] < context.skipLeafLevels) continue;
+			const LocalTransform& reference = m_Reference[i];
+			glm::quat delta = layer[i].rotation * glm::inverse(reference.rotation);
+			if (delta.w < 0.0f) delta = -delta;
+			out[i].rotation = glm::normalize(glm::normalize(identity * (1.0f - weight) + delta * weight) * out[i].rotation);
+			out[i].translation += (layer[i].translation - reference.translation) * weight;
+			glm::vec3 ratio = layer[i].scale / glm::max(reference.scale, glm::vec3(1e-6f));
+			out[i].scale *= glm::mix(glm::vec3(1.0f), ratio, weight);
+		}
+		context.stats.blends++;
+	}
+
+	void Reset() override
+	{
+		m_Base->Reset();
+		m_Additive->Reset();
+	}
+
+	int TempPoses() const override { return 1 + m_Base->TempPoses() + m_Additive->TempPoses(); }
+	int ClipBudget() const override { return m_Base->ClipBudget() + 2; }
+
+private:
+	AnimNode* m_Base;
+	ClipNode* m_Additive;
+	int m_Parameter;
+	std::vector<LocalTransform> m_Reference;
+	bool m_HasReference = false;
+};
+
+/*
+	Named states with cross-fade transitions. Only the outgoing and incoming state are ever
+	evaluated: a transition requested mid-fade drops the oldest state, which keeps the
+	per-frame cost at two sub-graphs instead of a growing chain of fades.
+*/
+class StateMachine : public AnimNode
+{
+public:
+	int AddState(const std::string& name, AnimNode* node)
+	{
+		m_States.push_back(State{ name, node });
+		if (m_Current < 0) m_Current = 0;
+		return (int)m_States.size() - 1;
+	}
+
+	int FindState(const std::string& name) const
+	{
+		for (size_t i = 0; i < m_States.size(); i++)
+			if (m_States[i].name == name) return (int)i;
+		return -1;
+	}
+
+	void TransitionTo(int state, float duration)
+	{
+		if (state < 0 || state >= (int)m_States.size() || state == m_Current) return;
+		m_States[state].node->Reset();
+		if (duration <= 0.0f || m_Current < 0)
+		{
+			m_Previous = -1;
+			m_Current = state;
+			return;
+		}
+		m_Previous = m_Current;
+		m_Current = state;
+		m_FadeTime = 0.0f;
+		m_FadeDuration = duration;
+	}
+
+	void TransitionTo(const std::string& name, float duration)
+	{
+		int state = FindState(name);
+		if (state < 0)
+			std::cout << "ERROR::STATE_MACHINE::UNKNOWN_STATE: " << name << std::endl;
+		TransitionTo(state, duration);
+	}
+
+	int GetCurrentState() const { return m_Current; }
+	const std::string& GetStateName(int state) const { return m_States[state].name; }
+	size_t GetStateCount() const { return m_States.size(); }
+	bool IsFading() const { return m_Previous >= 0; }
+
+	void Update(float dt) override
+	{
+		if (m_Current < 0) return;
+		m_States[m_Current].node->Update(dt);
+		if (m_Previous < 0) return;
+		m_States[m_Previous].node->Update(dt);
+		m_FadeTime += dt;
+		if (m_FadeTime >= m_FadeDuration) m_Previous = -1;
+	}
+
+	void Evaluate(GraphContext& context, LocalTransform* out) override
+	{
+		if (m_Current < 0) return;
+		if (m_Previous < 0)
+		{
+			m_States[m_Current].node->Evaluate(context, out);
+			return;
+		}
+		float t = m_FadeTime / m_FadeDuration;
+		float weight = t * t * (3.0f - 2.0f * t);
+		LocalTransform* incoming = context.pool.Acquire();
+		m_States[m_Previous].node->Evaluate(context, out);
+		m_States[m_Current].node->Evaluate(context, incoming);
+		BlendPoses(out, incoming, weight, out, context.skeleton.size());
+		context.stats.blends++;
+	}
+
+	void Reset() override
+	{
+		m_Previous = -1;
+		if (m_Current >= 0) m_States[m_Current].node->Reset();
+	}
+
+	int TempPoses() const override
+	{
+		int worst = 0;
+		for (const State& state : m_States) worst = std::max(worst, state.node->TempPoses());
+		return 1 + 2 * worst;
+	}
+
+	int ClipBudget() const override
+	{
+		std::vector<int> costs;
+		for (const State& state : m_States) costs.push_back(state.node->ClipBudget());
+		std::sort(costs.rbegin(), costs.rend());
+		return (costs.size() > 0 ? costs[0] : 0) + (costs.size() > 1 ? costs[1] : 0);
+	}
+
+private:
+	struct State
+	{
+		std::string name;
+		AnimNode* node;
+	};
+	std::vector<State> m_States;
+	int m_Current = -1;
+	int m_Previous = -1;
+	float m_FadeTime = 0.0f;
+	float m_FadeDuration = 0.0f;
+};
+
+/*
+	One character's animation graph: owns the nodes, the named float parameters that drive
+	them and the pose pool. Build it once (Add nodes, SetRoot), then Update every frame and
+	hand the resulting local pose to an Animator.
+*/
+class AnimationGraph
+{
+public:
+	explicit AnimationGraph(Animation& skeletonSource)
+		: m_Skeleton(skeletonSource)
+	{
+		m_Pose.resize(m_Skeleton.size());
+		m_Sampled.resize(m_Skeleton.size());
+	}
+
+	template <typename Node, typename... Args>
+	Node* Add(Args&&... args)
+	{
+		Node* node = new Node(std::forward<Args>(args)...);
+		m_Nodes.push_back(std::unique_ptr<AnimNode>(node));
+		return node;
+	}
+
+	ClipNode* AddClip(Animation* clip, float speed = 1.0f)
+	{
+		return Add<ClipNode>(clip, m_Skeleton, speed);
+	}
+
+	/*index of a named parameter, created at 0 on first use*/
+	int Parameter(const std::string& name)
+	{
+		auto found = m_ParameterNames.find(name);
+		if (found != m_ParameterNames.end()) return found->second;
+		m_Parameters.push_back(0.0f);
+		return m_ParameterNames[name] = (int)m_Parameters.size() - 1;
+	}
+
+	void SetParameter(int index, float value) { m_Parameters[index] = value; }
+	void SetParameter(const std::string& name, float value) { m_Parameters[Parameter(name)] = value; }
+	float GetParameter(const std::string& name) { return m_Parameters[Parameter(name)]; }
+
+	/*call after the graph is complete; sizes the pose pool for its worst frame*/
+	void SetRoot(AnimNode* root)
+	{
+		m_Root = root;
+		m_Pool.Reserve(root ? root->TempPoses() : 0, m_Skeleton.size());
+		m_Stats.poseCapacity = m_Pool.Capacity();
+		m_Stats.clipBudget = root ? root->ClipBudget() : 0;
+	}
+
+	/*skipLeafLevels is the animation LOD mask, see GraphContext*/
+	void Update(float dt, int skipLeafLevels = 0)
+	{
+		if (!m_Root) return;
+		auto start = std::chrono::steady_clock::now();
+		m_Pool.Reset();
+		m_Stats.clipsSampled = m_Stats.channelsSampled = m_Stats.blends = 0;
+		std::fill(m_Sampled.begin(), m_Sampled.end(), 0);
+
+		GraphContext context{ m_Skeleton, m_Pool, m_Parameters, m_Stats, skipLeafLevels, m_Sampled };
+		m_Root->Update(dt);
+		m_Root->Evaluate(context, m_Pose.data());
+		m_Stats.bonesSampled = (int)std::count(m_Sampled.begin(), m_Sampled.end(), 1);
+
+		m_Stats.posesUsed = m_Pool.Used();
+		float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		// smoothed so the panel is readable
+		m_Stats.evaluateMs = m_Stats.evaluateMs * 0.9f + ms * 0.1f;
+	}
+
+	const Skeleton& GetSkeleton() const { return m_Skeleton; }
+	const std::vector<LocalTransform>& GetPose() const { return m_Pose; }
+	const GraphStats& GetStats() const { return m_Stats; }
+
+private:
+	Skeleton m_Skeleton;
+	std::vector<std::unique_ptr<AnimNode>> m_Nodes;
+	AnimNode* m_Root = nullptr;
+	std::vector<float> m_Parameters;
+	std::map<std::string, int> m_ParameterNames;
+	PosePool m_Pool;
+	std::vector<LocalTransform> m_Pose;
+	std::vector<uint8_t> m_Sampled;
+	GraphStats m_Stats;
+};
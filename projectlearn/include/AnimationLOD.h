@@ -0,0 +1,83 @@
+#pragma once
+
+/* Animation level of detail from the character's size on screen */
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+
+struct AnimationLODLevel
+{
+	/*smallest on-screen height, as a fraction of the viewport height, that uses this level*/
+	float minScreenSize;
+	/*evaluate the pose every N frames and interpolate the palette in between*/
+	int updateInterval;
+	/*bones this close to the end of a chain (fingers, face, toes) keep their bind pose;
+	  0 evaluates everything, 1 skips the tips, 2 also their parents...*/
+	int skipLeafLevels;
+};
+
+struct AnimationLODPolicy
+{
+	/*ordered from the largest minScreenSize down; the last level catches everything smaller*/
+	std::vector<AnimationLODLevel> levels;
+	bool freezeOffscreen = true;
+
+	static AnimationLODPolicy Default()
+	{
+		AnimationLODPolicy policy;
+		policy.levels = {
+			{ 0.25f, 1, 0 },
+			{ 0.10f, 2, 1 },
+			{ 0.04f, 3, 2 },
+			{ 0.00f, 4, 3 },
+		};
+		return policy;
+	}
+
+	int Select(float screenSize) const
+	{
+		for (size_t i = 0; i < levels.size(); i++)
+			if (screenSize >= levels[i].minScreenSize) return (int)i;
+		return levels.empty() ? -1 : (int)levels.size() - 1;
+	}
+};
+
+/*what an Animator did in its last UpdateAnimation*/
+struct AnimationLODState
+{
+	int level = 0;
+	bool visible = true;
+	float screenSize = 1.0f;
+	/*evaluated, interpolated or frozen*/
+	bool evaluated = false;
+	bool frozen = false;
+	int bonesEvaluated = 0;
+	int bonesTotal = 0;
+};
+
+/*height of a bounding sphere on screen as a fraction of the viewport height*/
+inline float ScreenSize(const glm::vec3& center, float radius, const glm::mat4& view, float fovY)
+{
+	glm::vec3 eye = glm::vec3(view * glm::vec4(center, 1.0f));
+	float distance = glm::length(eye);
+	if (distance <= radius) return 1.0f;
+	return radius / (distance * std::tan(fovY * 0.5f));
+}
+
+/*conservative sphere test against the six planes of a view-projection matrix*/
+inline bool SphereInFrustum(const glm::vec3& center, float radius, const glm::mat4& viewProjection)
+{
+	const glm::mat4& m = viewProjection;
+	for (int i = 0; i < 6; i++)
+	{
+		int axis = i / 2;
+		float sign = (i % 2) ? -1.0f : 1.0f;
+		// row 3 +/- row axis, read from the column-major matrix
+		glm::vec4 plane(m[0][3] + sign * m[0][axis], m[1][3] + sign * m[1][axis],
+			m[2][3] + sign * m[2][axis], m[3][3] + sign * m[3][axis]);
+		float length = glm::length(glm::vec3(plane));
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * length) return false;
+	}
+	return true;
+}
@@ -1,11 +1,26 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cmath>
+#include <iostream>
 #include <map>
 #include <vector>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
 #include "Animation.h"
 #include "Bone.h"
+#include "AnimationGraph.h"
+#include "PoseEvaluator.h"
+#include "AnimationLOD.h"
+
+/*relative difference between two bone scales that dual quaternion skinning still takes as equal*/
+#define DQS_SCALE_TOLERANCE 1e-3f
+
+enum class SkinningMode
+{
+	Linear,        // 4x4 matrix palette, linear blend skinning
+	DualQuaternion // 8-float dual quaternion palette, no candy-wrapper collapse at joints
+};
 
 class Animator
 {
@@ -15,65 +30,328 @@ public:
 		m_CurrentTime = 0.0;
 		m_CurrentAnimation = animation;
 
-		m_FinalBoneMatrices.reserve(1000);
-
-		for (int i = 0; i < 1000; i++)
-			m_FinalBoneMatrices.push_back(glm::mat4(1.0f));
+		// one palette entry per bone the model actually has, allocated once
+		size_t boneCount = 0;
+		for (const auto& bone : animation->GetBoneIDMap())
+			if ((size_t)bone.second.id + 1 > boneCount)
+				boneCount = bone.second.id + 1;
+		m_FinalBoneMatrices.assign(boneCount, glm::mat4(1.0f));
+		m_FinalBoneDQs.assign(boneCount, DualQuat{ glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f) });
+		m_GlobalTransforms.resize(animation->GetEvaluationNodes().size());
 	}
 
 	void UpdateAnimation(float dt)
 	{
 		m_DeltaTime = dt;
-		if (m_CurrentAnimation)
+		// time keeps running while the pose is frozen or waiting for its next LOD update
+		m_PendingTime += dt;
+		m_LODState.evaluated = m_LODState.frozen = false;
+		m_LODState.bonesEvaluated = 0;
+
+		int interval = 1, skipLeafLevels = 0;
+		if (m_LODPolicy)
+		{
+			if (m_LODPolicy->freezeOffscreen && !m_LODState.visible)
+			{
+				m_LODState.frozen = true;
+				return;
+			}
+			if (m_LODState.level >= 0 && m_LODState.level < (int)m_LODPolicy->levels.size())
+			{
+				interval = std::max(1, m_LODPolicy->levels[m_LODState.level].updateInterval);
+				skipLeafLevels = m_LODPolicy->levels[m_LODState.level].skipLeafLevels;
+			}
+		}
+
+		// between LOD updates only the palette is blended, from the previous key pose to the last
+		if (interval > 1 && m_KeyPosesValid && ++m_FramesSinceEvaluate < interval)
+		{
+			InterpolatePalette(float(m_FramesSinceEvaluate) / interval);
+			return;
+		}
+
+		float step = m_PendingTime;
+		m_PendingTime = 0.0f;
+		m_FramesSinceEvaluate = 0;
+		m_LODState.evaluated = true;
+		if (m_Graph)
 		{
-			m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt;
+			m_Graph->Update(step, skipLeafLevels);
+			ApplyPose(m_Graph->GetSkeleton(), m_Graph->GetPose());
+			m_LODState.bonesEvaluated = m_Graph->GetStats().bonesSampled;
+			m_LODState.bonesTotal = m_Graph->GetSkeleton().animatedCount;
+		}
+		else if (m_CurrentAnimation)
+		{
+			m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * step;
 			m_CurrentTime = fmod(m_CurrentTime, m_CurrentAnimation->GetDuration());
-			CalculateBoneTransform(&m_CurrentAnimation->GetRootNode(), glm::mat4(1.0f));
+			// every channel of the clip in one batched SIMD pass, then the hierarchy walk
+			m_LODState.bonesEvaluated = m_Evaluator.Evaluate(m_CurrentAnimation->GetBones(), m_CurrentTime,
+				&m_CurrentAnimation->GetBoneHeights(), skipLeafLevels);
+			m_LODState.bonesTotal = (int)m_CurrentAnimation->GetBones().size();
+			CalculateBoneTransforms(skipLeafLevels);
 		}
+
+		/*dual quaternions carry one uniform scale for the whole palette. a pose with anything else
+		  goes back to matrices for good, which this pass wrote as well*/
+		if (m_ScaleMismatch && m_SkinningMode == SkinningMode::DualQuaternion)
+		{
+			std::cout << "ERROR::ANIMATOR::DQS_SCALE: bone scales are non-uniform or differ between bones, "
+				"falling back to linear blend skinning" << std::endl;
+			SetSkinningMode(SkinningMode::Linear);
+		}
+
+		if (interval > 1)
+			StoreKeyPose();
+		else
+			m_KeyPosesValid = false;
+	}
+
+	void SetLODPolicy(const AnimationLODPolicy* policy) { m_LODPolicy = policy; }
+
+	/*pick this frame's LOD level from the character's world-space bounding sphere*/
+	void UpdateLOD(const glm::vec3& center, float radius, const glm::mat4& view, const glm::mat4& projection, float fovY)
+	{
+		if (!m_LODPolicy) return;
+		m_LODState.screenSize = ScreenSize(center, radius, view, fovY);
+		m_LODState.visible = SphereInFrustum(center, radius, projection * view);
+		m_LODState.level = m_LODPolicy->Select(m_LODState.screenSize);
 	}
 
+	const AnimationLODState& GetLODState() const { return m_LODState; }
+
 	void PlayAnimation(Animation* pAnimation)
 	{
 		m_CurrentAnimation = pAnimation;
 		m_CurrentTime = 0.0f;
 	}
 
-	void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
+	/*drive the palette from a graph (blends, layers, cross-fades) instead of a single clip;
+	  nullptr goes back to PlayAnimation behaviour*/
+	void SetGraph(AnimationGraph* graph)
 	{
-		std::string nodeName = node->name;
-		glm::mat4 nodeTransform = node->transformation;
+		m_Graph = graph;
+		if (graph && m_GlobalTransforms.size() < graph->GetSkeleton().size())
+			m_GlobalTransforms.resize(graph->GetSkeleton().size());
+	}
+	AnimationGraph* GetGraph() { return m_Graph; }
 
-		Bone* Bone = m_CurrentAnimation->FindBone(nodeName);
+	void SetSkinningMode(SkinningMode mode)
+	{
+		m_SkinningMode = mode;
+		m_PaletteScale = 0.0f;
+		m_ScaleMismatch = false;
+		m_KeyPosesValid = false;
+		m_StepInterpolated = false;
+		m_StepMatrices.clear();
+		m_StepDQs.clear();
+	}
+	SkinningMode GetSkinningMode() const { return m_SkinningMode; }
+
+	/*one forward pass over the flattened hierarchy; parents always precede their children*/
+	void CalculateBoneTransforms(int skipLeafLevels = 0)
+	{
+		const std::vector<EvaluationNode>& nodes = m_CurrentAnimation->GetEvaluationNodes();
+		if (m_GlobalTransforms.size() < nodes.size()) m_GlobalTransforms.resize(nodes.size());
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			const EvaluationNode& node = nodes[i];
+			glm::mat4 global = node.parent >= 0 ? m_GlobalTransforms[node.parent] : glm::mat4(1.0f);
+			if (!node.identityPre) global = global * node.pre;
+			if (node.bone >= 0)
+				global = global * (node.height < skipLeafLevels ? node.bind : ToMat4(m_Evaluator.GetLocal(node.bone)));
+			m_GlobalTransforms[i] = global;
+			if (node.paletteId >= 0 && node.paletteId < (int)m_FinalBoneMatrices.size())
+				WritePalette(node.paletteId, global * node.offset);
+		}
+	}
 
-		if (Bone)
+	/*local pose to palette: the blended pose goes through the evaluator's SIMD kernel like a
+	  single clip does, then the same forward loop as CalculateBoneTransforms over the skeleton,
+	  which is the flattened evaluation order*/
+	void ApplyPose(const Skeleton& skeleton, const std::vector<LocalTransform>& pose)
+	{
+		if (m_GraphPose.count != skeleton.size()) m_GraphPose.Resize(skeleton.size());
+		for (size_t i = 0; i < skeleton.size(); i++)
+			m_GraphPose.Set(i, pose[i].translation, pose[i].rotation, pose[i].scale);
+		m_Evaluator.Compose(m_GraphPose, m_GraphLocals);
+		for (size_t i = 0; i < skeleton.size(); i++)
 		{
-			Bone->Update(m_CurrentTime);
-			nodeTransform = Bone->GetLocalTransform();
+			int parent = skeleton.parents[i];
+			glm::mat4 global = parent >= 0 ? m_GlobalTransforms[parent] : glm::mat4(1.0f);
+			if (!skeleton.identityPre[i]) global = global * skeleton.pre[i];
+			if (skeleton.animated[i]) global = global * ToMat4(m_GraphLocals[i]);
+			m_GlobalTransforms[i] = global;
+			int index = skeleton.boneIds[i];
+			if (index >= 0 && index < (int)m_FinalBoneMatrices.size())
+				WritePalette(index, m_GlobalTransforms[i] * skeleton.offsets[i]);
 		}
+	}
 
-		glm::mat4 globalTransformation = parentTransform * nodeTransform;
+	/*fixed timestep: call before every simulation step. Interpolate then shows a palette part of the way
+	  from the one saved here to the one the step produces*/
+	void BeginStep()
+	{
+		if (m_SkinningMode == SkinningMode::DualQuaternion)
+			m_StepDQs = m_FinalBoneDQs;
+		else
+			m_StepMatrices = m_FinalBoneMatrices;
+	}
 
-		auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-		if (boneInfoMap.find(nodeName) != boneInfoMap.end())
+	/*after the frame's simulation steps: alpha is how far the frame is past the last step, in steps.
+	  at 1 (or without a step saved yet) the palette of the last step is shown as is*/
+	void Interpolate(float alpha)
+	{
+		bool dq = m_SkinningMode == SkinningMode::DualQuaternion;
+		m_StepInterpolated = alpha < 1.0f &&
+			(dq ? m_StepDQs.size() == m_FinalBoneDQs.size() : m_StepMatrices.size() == m_FinalBoneMatrices.size());
+		if (!m_StepInterpolated) return;
+		if (dq)
+		{
+			m_DisplayDQs.resize(m_FinalBoneDQs.size());
+			BlendPalette(m_StepDQs, m_FinalBoneDQs, alpha, m_DisplayDQs);
+		}
+		else
 		{
-			int index = boneInfoMap[nodeName].id;
-			glm::mat4 offset = boneInfoMap[nodeName].offset;
-			m_FinalBoneMatrices[index] = globalTransformation * offset;
+			m_DisplayMatrices.resize(m_FinalBoneMatrices.size());
+			BlendPalette(m_StepMatrices, m_FinalBoneMatrices, alpha, m_DisplayMatrices);
 		}
+	}
+
+	// views into the animator's own storage; valid until the next UpdateAnimation or Interpolate
+	Span<glm::mat4> GetFinalBoneMatrices() const
+	{
+		const std::vector<glm::mat4>& palette = m_StepInterpolated ? m_DisplayMatrices : m_FinalBoneMatrices;
+		return Span<glm::mat4>(palette.data(), palette.size());
+	}
 
-		for (int i = 0; i < node->childrenCount; i++)
-			CalculateBoneTransform(&node->children[i], globalTransformation);
+	Span<DualQuat> GetFinalBoneDualQuats() const
+	{
+		const std::vector<DualQuat>& palette = m_StepInterpolated ? m_DisplayDQs : m_FinalBoneDQs;
+		return Span<DualQuat>(palette.data(), palette.size());
+	}
+
+	/*model space transform of every evaluation node, in GetEvaluationNodes order (which is also the graph's skeleton order)*/
+	Span<glm::mat4> GetGlobalTransforms() const
+	{
+		return Span<glm::mat4>(m_GlobalTransforms.data(), m_GlobalTransforms.size());
 	}
 
-	std::vector<glm::mat4> GetFinalBoneMatrices()
+	// dual quaternions cannot hold scale; a uniform scale shared by the whole skeleton (e.g. a
+	// centimetre root) is factored out here and applied to the vertex before the rigid transform
+	float GetPaletteScale() const { return m_PaletteScale > 0.0f ? m_PaletteScale : 1.0f; }
+
+	// rigid part of a bone matrix as a unit dual quaternion. the uniform scale found on the
+	// first bone becomes the palette scale; scaleMismatch is set when this bone's scale is not
+	// uniform or not the palette's, which the dual quaternion can't express
+	static DualQuat ToDualQuat(const glm::mat4& m, float& paletteScale, bool* scaleMismatch = nullptr)
 	{
-		return m_FinalBoneMatrices;
+		glm::mat3 rotation(m);
+		float scale = glm::length(rotation[0]);
+		if (scale > 0.0f)
+		{
+			if (paletteScale <= 0.0f) paletteScale = scale;
+			float tolerance = DQS_SCALE_TOLERANCE * scale;
+			if (scaleMismatch && (std::fabs(glm::length(rotation[1]) - scale) > tolerance ||
+				std::fabs(glm::length(rotation[2]) - scale) > tolerance ||
+				std::fabs(paletteScale - scale) > DQS_SCALE_TOLERANCE * paletteScale))
+				*scaleMismatch = true;
+			rotation[0] /= scale;
+			rotation[1] /= scale;
+			rotation[2] /= scale;
+		}
+		glm::quat real = glm::normalize(glm::quat_cast(rotation));
+		glm::vec3 t(m[3]);
+		// dual = 0.5 * (0, t) * real
+		glm::quat dual = glm::quat(0.0f, t.x, t.y, t.z) * real * 0.5f;
+		return DualQuat{ glm::vec4(real.x, real.y, real.z, real.w), glm::vec4(dual.x, dual.y, dual.z, dual.w) };
 	}
 
 private:
+	/*the palette just evaluated becomes the newest key; the first key after a gap is used twice*/
+	void StoreKeyPose()
+	{
+		if (m_SkinningMode == SkinningMode::DualQuaternion)
+		{
+			m_PreviousDQs = m_KeyPosesValid ? m_NextDQs : m_FinalBoneDQs;
+			m_NextDQs = m_FinalBoneDQs;
+			m_FinalBoneDQs = m_PreviousDQs;
+		}
+		else
+		{
+			m_PreviousMatrices = m_KeyPosesValid ? m_NextMatrices : m_FinalBoneMatrices;
+			m_NextMatrices = m_FinalBoneMatrices;
+			m_FinalBoneMatrices = m_PreviousMatrices;
+		}
+		m_KeyPosesValid = true;
+	}
+
+	/*the shown pose trails the evaluated one by one interval, which is what makes it smooth*/
+	void InterpolatePalette(float t)
+	{
+		if (m_SkinningMode == SkinningMode::DualQuaternion)
+			BlendPalette(m_PreviousDQs, m_NextDQs, t, m_FinalBoneDQs);
+		else
+			BlendPalette(m_PreviousMatrices, m_NextMatrices, t, m_FinalBoneMatrices);
+	}
+
+	static void BlendPalette(const std::vector<DualQuat>& from, const std::vector<DualQuat>& to, float t, std::vector<DualQuat>& out)
+	{
+		for (size_t i = 0; i < out.size(); i++)
+		{
+			const DualQuat& a = from[i];
+			DualQuat b = to[i];
+			if (glm::dot(a.real, b.real) < 0.0f) { b.real = -b.real; b.dual = -b.dual; }
+			glm::vec4 real = glm::mix(a.real, b.real, t);
+			float length = glm::length(real);
+			out[i].real = real / length;
+			out[i].dual = glm::mix(a.dual, b.dual, t) / length;
+		}
+	}
+
+	/*matrices are split into translation/rotation/scale and blended like graph poses; a componentwise
+	  lerp of two rotations shrinks the bone towards the halfway point and shears it*/
+	static void BlendPalette(const std::vector<glm::mat4>& from, const std::vector<glm::mat4>& to, float t, std::vector<glm::mat4>& out)
+	{
+		for (size_t i = 0; i < out.size(); i++)
+		{
+			LocalTransform a = Decompose(from[i]), b = Decompose(to[i]), blended;
+			BlendPoses(&a, &b, t, &blended, 1);
+			out[i] = Compose(blended);
+		}
+	}
+
+	void WritePalette(int index, const glm::mat4& boneMatrix)
+	{
+		if (m_SkinningMode == SkinningMode::DualQuaternion)
+			m_FinalBoneDQs[index] = ToDualQuat(boneMatrix, m_PaletteScale, &m_ScaleMismatch);
+		/*in dual quaternion mode too, so a pose that turns out to need matrices has them*/
+		m_FinalBoneMatrices[index] = boneMatrix;
+	}
+
 	std::vector<glm::mat4> m_FinalBoneMatrices;
+	std::vector<DualQuat> m_FinalBoneDQs;
+	SkinningMode m_SkinningMode = SkinningMode::Linear;
+	float m_PaletteScale = 0.0f;
+	bool m_ScaleMismatch = false;
 	Animation* m_CurrentAnimation = nullptr;
+	AnimationGraph* m_Graph = nullptr;
+	PoseEvaluator m_Evaluator;
+	PoseSoA m_GraphPose;
+	std::vector<Affine3x4> m_GraphLocals;
+
+	const AnimationLODPolicy* m_LODPolicy = nullptr;
+	AnimationLODState m_LODState;
+	float m_PendingTime = 0.0f;
+	int m_FramesSinceEvaluate = 0;
+	bool m_KeyPosesValid = false;
+	std::vector<glm::mat4> m_PreviousMatrices, m_NextMatrices;
+	std::vector<DualQuat> m_PreviousDQs, m_NextDQs;
+	bool m_StepInterpolated = false;
+	std::vector<glm::mat4> m_StepMatrices, m_DisplayMatrices;
+	std::vector<DualQuat> m_StepDQs, m_DisplayDQs;
+	std::vector<glm::mat4> m_GlobalTransforms;
 	float m_CurrentTime = 0.0f;
 	float m_DeltaTime = 0.0f;
 
-};
\ No newline at end of file
+};
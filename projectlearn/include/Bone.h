@@ -10,24 +10,8 @@
 #include <glm/gtx/quaternion.hpp>
 #include <assimp_glm_helpers.h>
 #include <vector>
-
-struct KeyPosition
-{
-	glm::vec3 position;
-	float timeStamp;
-};
-
-struct KeyRotation
-{
-	glm::quat orientation;
-	float timeStamp;
-};
-
-struct KeyScale
-{
-	glm::vec3 scale;
-	float timeStamp;
-};
+#include "animdata.h"
+#include "AnimationCompression.h"
 
 class Bone
 {
@@ -72,21 +56,66 @@ public:
 			m_Scales.push_back(data);
 		}
 	}
-	
+
+	/*bone without raw keys, sampled only through UseCompressedTrack (baked bundles)*/
+	Bone(const std::string& name, int ID)
+		:
+		m_Name(name),
+		m_ID(ID),
+		m_LocalTransform(1.0f)
+	{
+		m_NumPositions = m_NumRotations = m_NumScalings = 0;
+	}
+
 	void Update(float animationTime)
 	{
-		glm::mat4 translation = InterpolatePosition(animationTime);
-		glm::mat4 rotation = InterpolateRotation(animationTime);
-		glm::mat4 scale = InterpolateScaling(animationTime);
-		m_LocalTransform = translation * rotation * scale;
+		glm::vec3 position, scale;
+		glm::quat rotation;
+		Sample(animationTime, position, rotation, scale);
+		m_LocalTransform = glm::translate(glm::mat4(1.0f), position) * glm::toMat4(rotation)
+			* glm::scale(glm::mat4(1.0f), scale);
+	}
+
+	/*local transform as separate channels, which is what blending needs*/
+	void Sample(float animationTime, glm::vec3& position, glm::quat& rotation, glm::vec3& scale) const
+	{
+		if (m_Clip)
+		{
+			position = m_Clip->SamplePosition(m_Track, animationTime);
+			rotation = m_Clip->SampleRotation(m_Track, animationTime);
+			scale = m_Clip->SampleScale(m_Track, animationTime);
+			return;
+		}
+		position = InterpolatePosition(animationTime);
+		rotation = InterpolateRotation(animationTime);
+		scale = InterpolateScaling(animationTime);
 	}
+
 	glm::mat4 GetLocalTransform() { return m_LocalTransform; }
 	std::string GetBoneName() const { return m_Name; }
 	int GetBoneID() { return m_ID; }
+
+	const std::vector<KeyPosition>& GetPositionKeys() const { return m_Positions; }
+	const std::vector<KeyRotation>& GetRotationKeys() const { return m_Rotations; }
+	const std::vector<KeyScale>& GetScaleKeys() const { return m_Scales; }
+
+	/*the compressed clip and track this bone samples, null before UseCompressedTrack*/
+	const CompressedClip* GetCompressedClip() const { return m_Clip; }
+	size_t GetTrack() const { return m_Track; }
+
+	/*samples from the clip's compressed track from now on and frees the source keys*/
+	void UseCompressedTrack(const CompressedClip* clip, size_t track)
+	{
+		m_Clip = clip;
+		m_Track = track;
+		std::vector<KeyPosition>().swap(m_Positions);
+		std::vector<KeyRotation>().swap(m_Rotations);
+		std::vector<KeyScale>().swap(m_Scales);
+	}
 	
 
 
-	int GetPositionIndex(float animationTime)
+	int GetPositionIndex(float animationTime) const
 	{
 		for (int index = 0; index < m_NumPositions - 1; ++index)
 		{
@@ -96,7 +125,7 @@ public:
 		assert(0);
 	}
 
-	int GetRotationIndex(float animationTime)
+	int GetRotationIndex(float animationTime) const
 	{
 		for (int index = 0; index < m_NumRotations - 1; ++index)
 		{
@@ -106,7 +135,7 @@ public:
 		assert(0);
 	}
 
-	int GetScaleIndex(float animationTime)
+	int GetScaleIndex(float animationTime) const
 	{
 		for (int index = 0; index < m_NumScalings - 1; ++index)
 		{
@@ -119,7 +148,7 @@ public:
 
 private:
 
-	float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
+	float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime) const
 	{
 		float scaleFactor = 0.0f;
 		float midWayLength = animationTime - lastTimeStamp;
@@ -128,10 +157,10 @@ private:
 		return scaleFactor;
 	}
 
-	glm::mat4 InterpolatePosition(float animationTime)
+	glm::vec3 InterpolatePosition(float animationTime) const
 	{
 		if (1 == m_NumPositions)
-			return glm::translate(glm::mat4(1.0f), m_Positions[0].position);
+			return m_Positions[0].position;
 
 		int p0Index = GetPositionIndex(animationTime);
 		int p1Index = p0Index + 1;
@@ -139,16 +168,13 @@ private:
 			m_Positions[p1Index].timeStamp, animationTime);
 		glm::vec3 finalPosition = glm::mix(m_Positions[p0Index].position, m_Positions[p1Index].position
 			, scaleFactor);
-		return glm::translate(glm::mat4(1.0f), finalPosition);
+		return finalPosition;
 	}
 
-	glm::mat4 InterpolateRotation(float animationTime)
+	glm::quat InterpolateRotation(float animationTime) const
 	{
 		if (1 == m_NumRotations)
-		{
-			auto rotation = glm::normalize(m_Rotations[0].orientation);
-			return glm::toMat4(rotation);
-		}
+			return glm::normalize(m_Rotations[0].orientation);
 
 		int p0Index = GetRotationIndex(animationTime);
 		int p1Index = p0Index + 1;
@@ -156,15 +182,13 @@ private:
 			m_Rotations[p1Index].timeStamp, animationTime);
 		glm::quat finalRotation = glm::slerp(m_Rotations[p0Index].orientation, m_Rotations[p1Index].orientation
 			, scaleFactor);
-		finalRotation = glm::normalize(finalRotation);
-		return glm::toMat4(finalRotation);
-
+		return glm::normalize(finalRotation);
 	}
 
-	glm::mat4 InterpolateScaling(float animationTime)
+	glm::vec3 InterpolateScaling(float animationTime) const
 	{
 		if (1 == m_NumScalings)
-			return glm::scale(glm::mat4(1.0f), m_Scales[0].scale);
+			return m_Scales[0].scale;
 
 		int p0Index = GetScaleIndex(animationTime);
 		int p1Index = p0Index + 1;
@@ -172,7 +196,7 @@ private:
 			m_Scales[p1Index].timeStamp, animationTime);
 		glm::vec3 finalScale = glm::mix(m_Scales[p0Index].scale, m_Scales[p1Index].scale
 			, scaleFactor);
-		return glm::scale(glm::mat4(1.0f), finalScale);
+		return finalScale;
 	}
 
 	std::vector<KeyPosition> m_Positions;
@@ -181,6 +205,8 @@ private:
 	int m_NumPositions;
 	int m_NumRotations;
 	int m_NumScalings;
+	const CompressedClip* m_Clip = nullptr;
+	size_t m_Track = 0;
 
 	glm::mat4 m_LocalTransform;
 	std::string m_Name;
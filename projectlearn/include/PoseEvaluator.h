@@ -0,0 +1,426 @@
+#pragma once
+
+/* Batched pose sampling and SIMD composition of local bone matrices */
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <assimp/scene.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include "Animation.h"
+#include "Bone.h"
+#include "job_system.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define POSE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/*functions built for a newer ISA than the rest of the file; MSVC needs no attribute*/
+#if defined(POSE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define POSE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define POSE_TARGET_AVX2
+#endif
+
+/*8-bone blocks per job. sampling costs far more per bone than composing (key search and
+  interpolation), so it splits a ~65 bone skeleton into a few jobs where composing doesn't*/
+#define POSE_SAMPLE_GRAIN 4
+#define POSE_COMPOSE_GRAIN 16
+
+/*local bone transform as a 3x4 row-major affine matrix (the last row is always 0,0,0,1)*/
+struct Affine3x4
+{
+	float m[12];
+};
+
+inline glm::mat4 ToMat4(const Affine3x4& a)
+{
+	return glm::mat4(
+		glm::vec4(a.m[0], a.m[4], a.m[8], 0.0f),
+		glm::vec4(a.m[1], a.m[5], a.m[9], 0.0f),
+		glm::vec4(a.m[2], a.m[6], a.m[10], 0.0f),
+		glm::vec4(a.m[3], a.m[7], a.m[11], 1.0f));
+}
+
+/*every channel of a pose in its own array, padded to a multiple of 8 bones*/
+struct PoseSoA
+{
+	size_t count = 0;
+	std::vector<float> tx, ty, tz;
+	std::vector<float> qx, qy, qz, qw;
+	std::vector<float> sx, sy, sz;
+
+	void Resize(size_t bones)
+	{
+		count = bones;
+		size_t padded = (bones + 7) & ~size_t(7);
+		for (std::vector<float>* channel : { &tx, &ty, &tz, &qx, &qy, &qz, &sx, &sy, &sz })
+			channel->assign(padded, 0.0f);
+		qw.assign(padded, 1.0f);
+		sx.assign(padded, 1.0f);
+		sy.assign(padded, 1.0f);
+		sz.assign(padded, 1.0f);
+	}
+
+	void Set(size_t i, const glm::vec3& t, const glm::quat& q, const glm::vec3& s)
+	{
+		tx[i] = t.x; ty[i] = t.y; tz[i] = t.z;
+		qx[i] = q.x; qy[i] = q.y; qz[i] = q.z; qw[i] = q.w;
+		sx[i] = s.x; sy[i] = s.y; sz[i] = s.z;
+	}
+};
+
+enum class PoseISA
+{
+	Scalar,
+	SSE2,
+	AVX2
+};
+
+inline const char* PoseISAName(PoseISA isa)
+{
+	switch (isa)
+	{
+	case PoseISA::AVX2: return "AVX2";
+	case PoseISA::SSE2: return "SSE2";
+	default: return "scalar";
+	}
+}
+
+/*best instruction set this CPU (and OS, for the AVX register state) supports*/
+inline PoseISA DetectPoseISA()
+{
+#if defined(POSE_X86) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return PoseISA::AVX2;
+	if (__builtin_cpu_supports("sse2")) return PoseISA::SSE2;
+#elif defined(POSE_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	if (avx2 && osxsave && (_xgetbv(0) & 6) == 6) return PoseISA::AVX2;
+	if (sse2) return PoseISA::SSE2;
+#endif
+	return PoseISA::Scalar;
+}
+
+/*
+	Composition kernels: translation * rotation(q) * scale for bones [begin, end), written as
+	Affine3x4. All three compute the same expression in the same order so they agree to the
+	last bit apart from the scalar tail of the SIMD versions, which is the scalar kernel.
+*/
+inline void ComposeScalar(const PoseSoA& pose, Affine3x4* out, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		float x = pose.qx[i], y = pose.qy[i], z = pose.qz[i], w = pose.qw[i];
+		float x2 = x + x, y2 = y + y, z2 = z + z;
+		float xx = x * x2, yy = y * y2, zz = z * z2;
+		float xy = x * y2, xz = x * z2, yz = y * z2;
+		float wx = w * x2, wy = w * y2, wz = w * z2;
+		float* m = out[i].m;
+		m[0] = (1.0f - (yy + zz)) * pose.sx[i]; m[1] = (xy - wz) * pose.sy[i]; m[2] = (xz + wy) * pose.sz[i]; m[3] = pose.tx[i];
+		m[4] = (xy + wz) * pose.sx[i]; m[5] = (1.0f - (xx + zz)) * pose.sy[i]; m[6] = (yz - wx) * pose.sz[i]; m[7] = pose.ty[i];
+		m[8] = (xz - wy) * pose.sx[i]; m[9] = (yz + wx) * pose.sy[i]; m[10] = (1.0f - (xx + yy)) * pose.sz[i]; m[11] = pose.tz[i];
+	}
+}
+
+#ifdef POSE_X86
+inline void ComposeSSE2(const PoseSoA& pose, Affine3x4* out, size_t begin, size_t end)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&pose.qx[i]), y = _mm_loadu_ps(&pose.qy[i]);
+		__m128 z = _mm_loadu_ps(&pose.qz[i]), w = _mm_loadu_ps(&pose.qw[i]);
+		__m128 sx = _mm_loadu_ps(&pose.sx[i]), sy = _mm_loadu_ps(&pose.sy[i]), sz = _mm_loadu_ps(&pose.sz[i]);
+		__m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+		// one register per matrix element across four bones, transposed into one row per bone
+		__m128 r0[4] = { _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+			_mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_loadu_ps(&pose.tx[i]) };
+		__m128 r1[4] = { _mm_mul_ps(_mm_add_ps(xy, wz), sx), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+			_mm_mul_ps(_mm_sub_ps(yz, wx), sz), _mm_loadu_ps(&pose.ty[i]) };
+		__m128 r2[4] = { _mm_mul_ps(_mm_sub_ps(xz, wy), sx), _mm_mul_ps(_mm_add_ps(yz, wx), sy),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), _mm_loadu_ps(&pose.tz[i]) };
+		_MM_TRANSPOSE4_PS(r0[0], r0[1], r0[2], r0[3]);
+		_MM_TRANSPOSE4_PS(r1[0], r1[1], r1[2], r1[3]);
+		_MM_TRANSPOSE4_PS(r2[0], r2[1], r2[2], r2[3]);
+		for (int k = 0; k < 4; k++)
+		{
+			_mm_storeu_ps(out[i + k].m + 0, r0[k]);
+			_mm_storeu_ps(out[i + k].m + 4, r1[k]);
+			_mm_storeu_ps(out[i + k].m + 8, r2[k]);
+		}
+	}
+	ComposeScalar(pose, out, i, end);
+}
+
+/*4x4 transpose inside each 128-bit half: afterwards register k holds bone k (low) and k+4 (high)*/
+POSE_TARGET_AVX2 inline void TransposeRowsAVX(__m256 r[4])
+{
+	__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+	__m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+	__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+	__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+	r[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	r[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	r[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	r[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+POSE_TARGET_AVX2 inline void ComposeAVX2(const PoseSoA& pose, Affine3x4* out, size_t begin, size_t end)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&pose.qx[i]), y = _mm256_loadu_ps(&pose.qy[i]);
+		__m256 z = _mm256_loadu_ps(&pose.qz[i]), w = _mm256_loadu_ps(&pose.qw[i]);
+		__m256 sx = _mm256_loadu_ps(&pose.sx[i]), sy = _mm256_loadu_ps(&pose.sy[i]), sz = _mm256_loadu_ps(&pose.sz[i]);
+		__m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+		__m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		__m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+		__m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+		__m256 r0[4] = { _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx), _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+			_mm256_mul_ps(_mm256_add_ps(xz, wy), sz), _mm256_loadu_ps(&pose.tx[i]) };
+		__m256 r1[4] = { _mm256_mul_ps(_mm256_add_ps(xy, wz), sx), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+			_mm256_mul_ps(_mm256_sub_ps(yz, wx), sz), _mm256_loadu_ps(&pose.ty[i]) };
+		__m256 r2[4] = { _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx), _mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz), _mm256_loadu_ps(&pose.tz[i]) };
+		TransposeRowsAVX(r0);
+		TransposeRowsAVX(r1);
+		TransposeRowsAVX(r2);
+		for (int k = 0; k < 4; k++)
+		{
+			_mm_storeu_ps(out[i + k].m + 0, _mm256_castps256_ps128(r0[k]));
+			_mm_storeu_ps(out[i + k].m + 4, _mm256_castps256_ps128(r1[k]));
+			_mm_storeu_ps(out[i + k].m + 8, _mm256_castps256_ps128(r2[k]));
+			_mm_storeu_ps(out[i + k + 4].m + 0, _mm256_extractf128_ps(r0[k], 1));
+			_mm_storeu_ps(out[i + k + 4].m + 4, _mm256_extractf128_ps(r1[k], 1));
+			_mm_storeu_ps(out[i + k + 4].m + 8, _mm256_extractf128_ps(r2[k], 1));
+		}
+	}
+	ComposeSSE2(pose, out, i, end);
+}
+#endif
+
+typedef void (*ComposeFunction)(const PoseSoA& pose, Affine3x4* out, size_t begin, size_t end);
+
+inline ComposeFunction SelectCompose(PoseISA isa)
+{
+#ifdef POSE_X86
+	if (isa == PoseISA::AVX2) return ComposeAVX2;
+	if (isa == PoseISA::SSE2) return ComposeSSE2;
+#endif
+	return ComposeScalar;
+}
+
+/*
+	Samples every bone of a clip into SoA channels, then composes all local matrices in one
+	SIMD pass. The ISA is detected once per process; pass one explicitly to compare kernels.
+*/
+class PoseEvaluator
+{
+public:
+	PoseEvaluator() : PoseEvaluator(DefaultISA()) {}
+	explicit PoseEvaluator(PoseISA isa) : m_ISA(isa), m_Compose(SelectCompose(isa)) {}
+
+	static PoseISA DefaultISA()
+	{
+		static const PoseISA isa = DetectPoseISA();
+		return isa;
+	}
+
+	/*local transforms of clip bones in the order of Animation::GetBones. with heights, bones
+	  below minHeight are not sampled and their result is stale; returns the bones sampled.
+	  skeletons bigger than a few blocks are sampled and composed on the job system, in blocks
+	  of 8 so every range starts on a SIMD boundary*/
+	int Evaluate(const std::vector<Bone>& bones, float time, const std::vector<int>* heights = nullptr, int minHeight = 0)
+	{
+		return evaluate(bones, time, heights, minHeight, true);
+	}
+
+	/*the sampling half of Evaluate: the channels land in GetPose and nothing is composed, for
+	  callers that blend poses first (ClipNode) and compose the result with Compose*/
+	int Sample(const std::vector<Bone>& bones, float time, const std::vector<int>* heights = nullptr, int minHeight = 0)
+	{
+		return evaluate(bones, time, heights, minHeight, false);
+	}
+
+	/*local matrices of any pose, e.g. a blended graph pose, with this evaluator's kernel*/
+	void Compose(const PoseSoA& pose, std::vector<Affine3x4>& out) const
+	{
+		out.resize(pose.count);
+		size_t blocks = (pose.count + 7) / 8;
+		Jobs().ParallelFor(blocks, POSE_COMPOSE_GRAIN, [&](size_t firstBlock, size_t lastBlock)
+		{
+			m_Compose(pose, out.data(), firstBlock * 8, std::min(lastBlock * 8, pose.count));
+		});
+	}
+
+	const Affine3x4& GetLocal(size_t bone) const { return m_Local[bone]; }
+	const std::vector<Affine3x4>& GetLocals() const { return m_Local; }
+	const PoseSoA& GetPose() const { return m_Pose; }
+	PoseISA GetISA() const { return m_ISA; }
+
+private:
+	PoseISA m_ISA;
+	ComposeFunction m_Compose;
+	PoseSoA m_Pose;
+	std::vector<Affine3x4> m_Local;
+	/*key cursors of the clip sampled last, one per track*/
+	const CompressedClip* m_CursorClip = nullptr;
+	std::vector<CompressedClip::Cursor> m_Cursors;
+
+	/*the clip every bone samples, when bone i is its track i (an Animation's bones); such
+	  bones are sampled straight from the clip with this evaluator's key cursors*/
+	static const CompressedClip* sharedClip(const std::vector<Bone>& bones)
+	{
+		const CompressedClip* clip = bones.empty() ? nullptr : bones[0].GetCompressedClip();
+		if (!clip || clip->GetTrackCount() != bones.size()) return nullptr;
+		for (size_t i = 0; i < bones.size(); i++)
+			if (bones[i].GetCompressedClip() != clip || bones[i].GetTrack() != i) return nullptr;
+		return clip;
+	}
+
+	int evaluate(const std::vector<Bone>& bones, float time, const std::vector<int>* heights, int minHeight, bool compose)
+	{
+		if (m_Pose.count != bones.size()) m_Pose.Resize(bones.size());
+		if (compose && m_Local.size() != bones.size()) m_Local.resize(bones.size());
+		const CompressedClip* clip = sharedClip(bones);
+		if (clip && (clip != m_CursorClip || m_Cursors.size() != bones.size()))
+		{
+			m_CursorClip = clip;
+			m_Cursors.assign(bones.size(), CompressedClip::Cursor());
+		}
+		std::atomic<int> sampled(0);
+		size_t blocks = (bones.size() + 7) / 8;
+		Jobs().ParallelFor(blocks, POSE_SAMPLE_GRAIN, [&](size_t firstBlock, size_t lastBlock)
+		{
+			size_t begin = firstBlock * 8, end = std::min(lastBlock * 8, bones.size());
+			glm::vec3 t, s;
+			glm::quat q;
+			int count = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				if (heights && (*heights)[i] < minHeight) continue;
+				if (clip) clip->SampleTrack(i, time, m_Cursors[i], t, q, s);
+				else bones[i].Sample(time, t, q, s);
+				m_Pose.Set(i, t, q, s);
+				count++;
+			}
+			if (compose) m_Compose(m_Pose, m_Local.data(), begin, end);
+			sampled += count;
+		});
+		return sampled;
+	}
+};
+
+/*
+	--bench-pose: synthetic clips of 50, 200 and 1000 bones (compressed like a loaded clip),
+	timing the per-bone Bone::Update path against the batched evaluator with every kernel
+	this CPU can run. Also checks that the kernels agree with glm.
+*/
+inline void RunPoseBenchmark()
+{
+	std::cout << "Pose evaluation benchmark, best ISA: " << PoseISAName(PoseEvaluator::DefaultISA()) << std::endl;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const int keys = 30;
+	const float duration = 29.0f;
+	const int frames = 2000;
+
+	for (int boneCount : { 50, 200, 1000 })
+	{
+		std::vector<Bone> bones;
+		bones.reserve(boneCount);
+		for (int b = 0; b < boneCount; b++)
+		{
+			// aiNodeAnim frees its key arrays when it goes out of scope
+			aiNodeAnim channel;
+			channel.mNumPositionKeys = channel.mNumRotationKeys = channel.mNumScalingKeys = keys;
+			channel.mPositionKeys = new aiVectorKey[keys];
+			channel.mRotationKeys = new aiQuatKey[keys];
+			channel.mScalingKeys = new aiVectorKey[keys];
+			for (int k = 0; k < keys; k++)
+			{
+				channel.mPositionKeys[k].mTime = channel.mRotationKeys[k].mTime = channel.mScalingKeys[k].mTime = k;
+				channel.mPositionKeys[k].mValue.x = unit(random);
+				channel.mPositionKeys[k].mValue.y = unit(random);
+				channel.mPositionKeys[k].mValue.z = unit(random);
+				glm::quat q = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+				channel.mRotationKeys[k].mValue.w = q.w;
+				channel.mRotationKeys[k].mValue.x = q.x;
+				channel.mRotationKeys[k].mValue.y = q.y;
+				channel.mRotationKeys[k].mValue.z = q.z;
+				channel.mScalingKeys[k].mValue.x = channel.mScalingKeys[k].mValue.y = channel.mScalingKeys[k].mValue.z = 1.0f + 0.1f * unit(random);
+			}
+			bones.push_back(Bone("bone" + std::to_string(b), b, &channel));
+		}
+		CompressedClip clip;
+		clip.Build(bones, duration, CompressionSettings());
+		for (int b = 0; b < boneCount; b++)
+			bones[b].UseCompressedTrack(&clip, b);
+
+		// reference: what Animator did per bone
+		volatile float sink = 0.0f;
+		auto start = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++)
+		{
+			float time = duration * f / frames;
+			for (Bone& bone : bones)
+			{
+				bone.Update(time);
+				sink = sink + bone.GetLocalTransform()[3][0];
+			}
+		}
+		double baseline = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames / boneCount;
+		std::cout << "  " << boneCount << " bones: per-bone " << baseline << " ns/bone";
+
+		for (PoseISA isa : { PoseISA::Scalar, PoseISA::SSE2, PoseISA::AVX2 })
+		{
+			if (isa > PoseEvaluator::DefaultISA()) continue;
+			PoseEvaluator evaluator(isa);
+			start = std::chrono::steady_clock::now();
+			for (int f = 0; f < frames; f++)
+			{
+				evaluator.Evaluate(bones, duration * f / frames);
+				sink = sink + evaluator.GetLocal(0).m[3];
+			}
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames / boneCount;
+
+			// same time on both paths, largest element difference
+			float error = 0.0f;
+			evaluator.Evaluate(bones, duration * 0.37f);
+			for (int b = 0; b < boneCount; b++)
+			{
+				bones[b].Update(duration * 0.37f);
+				glm::mat4 reference = bones[b].GetLocalTransform();
+				glm::mat4 batched = ToMat4(evaluator.GetLocal(b));
+				for (int c = 0; c < 4; c++)
+					for (int r = 0; r < 4; r++)
+						error = std::max(error, std::fabs(reference[c][r] - batched[c][r]));
+			}
+			std::cout << ", " << PoseISAName(isa) << " " << ns << " ns/bone (" << baseline / ns << "x, max diff " << error << ")";
+		}
+		std::cout << std::endl;
+	}
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstddef>
 
 struct BoneInfo
 {
@@ -11,4 +13,50 @@ struct BoneInfo
 	glm::mat4 offset;
 
 };
-#pragma once
\ No newline at end of file
+
+/*source keyframes as read from assimp, one vector per channel (see Bone)*/
+struct KeyPosition
+{
+	glm::vec3 position;
+	float timeStamp;
+};
+
+struct KeyRotation
+{
+	glm::quat orientation;
+	float timeStamp;
+};
+
+struct KeyScale
+{
+	glm::vec3 scale;
+	float timeStamp;
+};
+
+/*rigid bone transform as a unit dual quaternion, 8 floats (half a mat4).
+  both parts are stored x,y,z,w so they upload straight into two vec4 uniforms*/
+struct DualQuat
+{
+	glm::vec4 real;
+	glm::vec4 dual;
+};
+
+/*read-only view of contiguous memory owned by someone else (std::span without C++20)*/
+template <typename T>
+class Span
+{
+public:
+	Span() = default;
+	Span(const T* data, size_t size) : m_Data(data), m_Size(size) {}
+
+	const T* data() const { return m_Data; }
+	size_t size() const { return m_Size; }
+	bool empty() const { return m_Size == 0; }
+	const T& operator[](size_t i) const { return m_Data[i]; }
+	const T* begin() const { return m_Data; }
+	const T* end() const { return m_Data + m_Size; }
+
+private:
+	const T* m_Data = nullptr;
+	size_t m_Size = 0;
+};
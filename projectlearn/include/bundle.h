@@ -0,0 +1,413 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// house bundle: every asset of the scene baked by house_bake into one file.
+//
+//   BundleHeader | entry data, each aligned to BUNDLE_ALIGNMENT | BundleEntry table of contents
+//
+// entries are raw blobs the runtime uses in place: vertex and index arrays in the exact
+// layout Mesh uploads, block-compressed texture mips, and small fixed-size records for
+// models and clips. loading is one mmap plus a walk over the table of contents.
+// the file is only read back by the same build that wrote it (struct layouts are raw).
+
+#define BUNDLE_MAGIC "HOUSEBND"
+#define BUNDLE_VERSION 6
+#define BUNDLE_ALIGNMENT 64
+#define BUNDLE_NAME_LENGTH 64
+
+enum class BundleEntryType : uint32_t
+{
+    Model = 1,    // BundleModel record followed by its meshes, lights and bones
+    Vertices = 2, // Vertex[]
+    Indices = 3,  // uint16_t[] or uint32_t[], see BundleMesh::indexSize
+    Texture = 4,  // BundleTexture record followed by its mips
+    Clip = 5,     // BundleClip record followed by nodes, bone names and the compressed clip
+    Meshlets = 6  // Meshlet[] of every LOD back to back, see BundleLOD (and meshlet.h)
+};
+
+struct BundleHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t tocOffset;
+};
+
+struct BundleEntry
+{
+    BundleEntryType type;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+    char name[BUNDLE_NAME_LENGTH];
+};
+
+struct BundleMaterial
+{
+    float Ka[4], Kd[4], Ks[4];
+    float shininess;
+    float transparency;
+    uint32_t hasTexture;
+};
+
+#define BUNDLE_MAX_MESH_TEXTURES 8
+// matches MESH_MAX_LODS (mesh_simplify.h)
+#define BUNDLE_MAX_MESH_LODS 4
+
+// a range of the mesh's index entry, counted in indices, and its range of the meshlet entry
+struct BundleLOD
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+};
+
+struct BundleMesh
+{
+    char name[BUNDLE_NAME_LENGTH];
+    uint32_t vertexEntry;
+    uint32_t indexEntry;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexSize; // 2 or 4 bytes
+    BundleMaterial material;
+    uint32_t textureCount;
+    uint32_t textureEntries[BUNDLE_MAX_MESH_TEXTURES];
+    char textureTypes[BUNDLE_MAX_MESH_TEXTURES][24];
+    uint32_t lodCount;
+    BundleLOD lods[BUNDLE_MAX_MESH_LODS];
+    uint32_t meshletEntry;
+    uint32_t meshletCount; // 0: no meshlet entry
+};
+
+struct BundleLight
+{
+    float ambient[3], diffuse[3], specular[3];
+    float position[3], normal[3];
+    float angle, constant, linear, exp;
+};
+
+struct BundleBone
+{
+    char name[BUNDLE_NAME_LENGTH];
+    int32_t id;
+    float offset[16];
+};
+
+// followed by BundleMesh[meshCount], BundleLight[bulbCount + pointBulbCount], BundleBone[boneCount]
+struct BundleModel
+{
+    uint32_t meshCount;
+    uint32_t bulbCount;
+    uint32_t pointBulbCount;
+    uint32_t boneCount;
+    // what loading the source through assimp cost at bake time, for comparison
+    float assimpMs;
+};
+
+struct BundleMip
+{
+    uint32_t width, height;
+    uint64_t offset; // from the start of the entry
+    uint64_t size;
+};
+
+// followed by BundleMip[mipCount] and the mip data
+struct BundleTexture
+{
+    uint32_t format; // TextureFormat
+    uint32_t mipCount;
+    float decodeMs; // stb_image decode time at bake time
+    uint32_t reserved;
+};
+
+struct BundleNode
+{
+    char name[BUNDLE_NAME_LENGTH];
+    int32_t parent;
+    int32_t childrenCount;
+    float transformation[16];
+};
+
+// followed by BundleNode[nodeCount], char[boneCount][BUNDLE_NAME_LENGTH] in track order,
+// and clipBytes of CompressedClip::Serialize output
+struct BundleClip
+{
+    float duration;
+    float ticksPerSecond;
+    uint32_t nodeCount;
+    uint32_t boneCount;
+    uint64_t clipBytes;
+    char model[BUNDLE_NAME_LENGTH];
+    float assimpMs;
+    uint32_t reserved;
+};
+
+inline void CopyBundleName(char *dst, const std::string &src)
+{
+    std::memset(dst, 0, BUNDLE_NAME_LENGTH);
+    std::strncpy(dst, src.c_str(), BUNDLE_NAME_LENGTH - 1);
+}
+
+// read side: maps the whole file once; pointers returned stay valid while the Bundle lives
+class Bundle
+{
+public:
+    Bundle() = default;
+    Bundle(const Bundle &) = delete;
+    Bundle &operator=(const Bundle &) = delete;
+
+    ~Bundle()
+    {
+        Close();
+    }
+
+    bool Open(const std::string &path)
+    {
+        Close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            std::cout << "ERROR::BUNDLE::CANNOT_OPEN: " << path << std::endl;
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        size = (size_t)fileSize.QuadPart;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        base = mapping ? (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::cout << "ERROR::BUNDLE::CANNOT_OPEN: " << path << std::endl;
+            return false;
+        }
+        struct stat info;
+        fstat(fd, &info);
+        size = (size_t)info.st_size;
+        void *mapped = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        // the mapping keeps the file alive on its own
+        close(fd);
+        base = mapped == MAP_FAILED ? nullptr : (const uint8_t *)mapped;
+#endif
+        if (!base)
+        {
+            std::cout << "ERROR::BUNDLE::MAP_FAILED: " << path << std::endl;
+            Close();
+            return false;
+        }
+
+        // sizes are compared by subtraction so a corrupt offset can't wrap around
+        const BundleHeader *header = (const BundleHeader *)base;
+        if (size < sizeof(BundleHeader) || std::memcmp(header->magic, BUNDLE_MAGIC, 8) != 0 || header->version != BUNDLE_VERSION
+            || header->tocOffset % alignof(BundleEntry) != 0 || header->tocOffset > size
+            || header->entryCount > (size - header->tocOffset) / sizeof(BundleEntry))
+        {
+            std::cout << "ERROR::BUNDLE::BAD_HEADER: " << path << std::endl;
+            Close();
+            return false;
+        }
+        entries = (const BundleEntry *)(base + header->tocOffset);
+        entryCount = header->entryCount;
+        // a truncated file would send Data and Touch past the mapping
+        for (uint32_t i = 0; i < entryCount; i++)
+            if (entries[i].offset > size || entries[i].size > size - entries[i].offset)
+            {
+                std::cout << "ERROR::BUNDLE::BAD_ENTRY: " << path << " entry " << i << std::endl;
+                Close();
+                return false;
+            }
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base) munmap((void *)base, size);
+#endif
+        base = nullptr;
+        entries = nullptr;
+        size = 0;
+        entryCount = 0;
+    }
+
+    bool IsOpen() const { return base != nullptr; }
+    uint32_t EntryCount() const { return entryCount; }
+    const BundleEntry &Entry(uint32_t index) const { return entries[index]; }
+    const uint8_t *Data(const BundleEntry &entry) const { return base + entry.offset; }
+    const uint8_t *Data(uint32_t index) const { return base + entries[index].offset; }
+
+    // paging hints for streaming loads: Prefetch before touching an entry, Release once its data
+    // has been copied out, so only the entries being uploaded stay resident
+    void Prefetch(const BundleEntry &entry) const
+    {
+#ifndef _WIN32
+        advise(entry, MADV_WILLNEED);
+#endif
+    }
+
+    void Release(const BundleEntry &entry) const
+    {
+#ifdef _WIN32
+        // drops the pages from the working set; they are still backed by the file
+        VirtualUnlock((LPVOID)(base + entry.offset), (SIZE_T)entry.size);
+#else
+        advise(entry, MADV_DONTNEED);
+#endif
+    }
+
+    // reads one byte of every page of the entry, so it is resident when this returns; for
+    // loader threads, to keep page faults off the GL thread. returns the entry size
+    size_t Touch(const BundleEntry &entry) const
+    {
+        Prefetch(entry);
+        const size_t page = 4096;
+        volatile uint8_t sink = 0;
+        for (uint64_t offset = 0; offset < entry.size; offset += page) sink = sink + base[entry.offset + offset];
+        if (entry.size) sink = sink + base[entry.offset + entry.size - 1];
+        return (size_t)entry.size;
+    }
+
+    size_t Size() const { return size; }
+
+    // index of the named entry of a type, or -1
+    int Find(BundleEntryType type, const std::string &name) const
+    {
+        for (uint32_t i = 0; i < entryCount; i++)
+            if (entries[i].type == type && std::strncmp(entries[i].name, name.c_str(), BUNDLE_NAME_LENGTH) == 0)
+                return (int)i;
+        return -1;
+    }
+
+private:
+    const uint8_t *base = nullptr;
+    size_t size = 0;
+
+#ifndef _WIN32
+    void advise(const BundleEntry &entry, int advice) const
+    {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t begin = entry.offset / page * page;
+        size_t end = std::min(size, (size_t)((entry.offset + entry.size + page - 1) / page * page));
+        if (end > begin) madvise((void *)(base + begin), end - begin, advice);
+    }
+#endif
+
+    const BundleEntry *entries = nullptr;
+    uint32_t entryCount = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+};
+
+// peak resident set of the process so far, 0 where the platform does not report it
+inline size_t PeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return (size_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// write side, used by house_bake
+class BundleWriter
+{
+public:
+    bool Open(const std::string &path)
+    {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::BUNDLE::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        BundleHeader header = {};
+        out.write((const char *)&header, sizeof(header)); // rewritten by Finish
+        return true;
+    }
+
+    // returns the entry index other records use to refer to it
+    uint32_t Add(BundleEntryType type, const std::string &name, const void *data, size_t bytes)
+    {
+        uint64_t offset = (uint64_t)out.tellp();
+        uint64_t aligned = (offset + BUNDLE_ALIGNMENT - 1) / BUNDLE_ALIGNMENT * BUNDLE_ALIGNMENT;
+        static const char zeros[BUNDLE_ALIGNMENT] = {};
+        out.write(zeros, (std::streamsize)(aligned - offset));
+        out.write((const char *)data, (std::streamsize)bytes);
+
+        BundleEntry entry = {};
+        entry.type = type;
+        entry.offset = aligned;
+        entry.size = bytes;
+        if (name.size() >= BUNDLE_NAME_LENGTH)
+            std::cout << "ERROR::BUNDLE::NAME_TRUNCATED: " << name << std::endl;
+        CopyBundleName(entry.name, name);
+        toc.push_back(entry);
+        return (uint32_t)toc.size() - 1;
+    }
+
+    uint64_t BytesWritten() { return (uint64_t)out.tellp(); }
+
+    bool Finish()
+    {
+        BundleHeader header = {};
+        std::memcpy(header.magic, BUNDLE_MAGIC, 8);
+        header.version = BUNDLE_VERSION;
+        header.entryCount = (uint32_t)toc.size();
+        // the table of contents is read in place, so it starts aligned for BundleEntry
+        uint64_t end = (uint64_t)out.tellp();
+        header.tocOffset = (end + alignof(BundleEntry) - 1) / alignof(BundleEntry) * alignof(BundleEntry);
+        static const char zeros[alignof(BundleEntry)] = {};
+        out.write(zeros, (std::streamsize)(header.tocOffset - end));
+        out.write((const char *)toc.data(), (std::streamsize)(toc.size() * sizeof(BundleEntry)));
+        out.seekp(0);
+        out.write((const char *)&header, sizeof(header));
+        out.close();
+        return !out.fail();
+    }
+
+private:
+    std::ofstream out;
+    std::vector<BundleEntry> toc;
+};
+
+#endif
@@ -54,6 +54,9 @@ class Camera
 		float MouseSensitivity;
 		float Zoom;
 
+		//smoothed rate of movement from ProcessKeyboard in units per second (see UpdateVelocity)
+		glm::vec3 Velocity;
+
 		Camera(glm::vec3 position=glm::vec3(0.0f, 0.0f, -35.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f),float yaw = YAW, float pitch= PITCH) : MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
 	    {
 			Front = glm::vec3(0.0f,0.0f,35.f);
@@ -61,7 +64,11 @@ class Camera
 			WorldUp = up;
 			Yaw = yaw;
 			Pitch = PITCH;
+			Velocity = glm::vec3(0.0f);
+			moved = glm::vec3(0.0f);
 			updateCameraVectors();
+			previousPosition = Position;
+			previousYaw = Yaw;
 		}
 
 		glm::mat4 GetViewMatrix()
@@ -74,6 +81,7 @@ class Camera
 		void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 		{
 			float velocity = MovementSpeed * deltaTime;
+			glm::vec3 start = Position;
 			if(direction == FORWARD)
 				Position += Front * velocity ;
 			if(direction == BACKWARD)
@@ -101,6 +109,32 @@ class Camera
 				//Pitch -= deltaTime*EULERFACTOR;
 				//updateCameraVectors();
 			}
+			moved += Position - start;
+		}
+
+		//call once a frame after the keyboard input; folds this frame's movement into Velocity
+		void UpdateVelocity(float deltaTime)
+		{
+			if(deltaTime <= 0.0f) return;
+			Velocity += (moved / deltaTime - Velocity) * 0.2f;
+			moved = glm::vec3(0.0f);
+		}
+
+		//fixed timestep: call before every simulation step; Interpolated blends from the state saved here
+		void BeginStep()
+		{
+			previousPosition = Position;
+			previousYaw = Yaw;
+		}
+
+		//a copy for rendering, alpha of the way from the state before the last step to the current one
+		Camera Interpolated(float alpha) const
+		{
+			Camera eye = *this;
+			eye.Position = glm::mix(previousPosition, Position, alpha);
+			eye.Yaw = previousYaw + (Yaw - previousYaw) * alpha;
+			eye.updateCameraVectors();
+			return eye;
 		}
 
 		void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true)
@@ -109,6 +143,7 @@ class Camera
 			yoffset *= MouseSensitivity;
 
 			Yaw += xoffset ;
+			previousYaw += xoffset; //mouse look shows up right away, it isn't part of the stepped motion
 			Pitch += yoffset;
 
 			if(constrainPitch)
@@ -132,6 +167,10 @@ class Camera
 		}
 
 private:
+		glm::vec3 moved;
+		glm::vec3 previousPosition;
+		float previousYaw;
+
 		void updateCameraVectors()
 		{
 			glm::vec3 front;
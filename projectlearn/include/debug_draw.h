@@ -0,0 +1,221 @@
+#ifndef DEBUG_DRAW_H
+#define DEBUG_DRAW_H
+
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include <glm/glm.hpp>
+
+#include <animdata.h>
+#include <job_system.h>
+#include <model.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// ImDrawLists built as jobs on Jobs() and merged into the frame's ImDrawData, for debug overlays
+// too big to generate on the main thread. every job fills its own list, so the lists share
+// nothing but ImGui's allocator (ImGui::MemAlloc counts allocations atomically). they read a
+// copy of the frame's ImDrawListSharedData taken in Begin, not the context's, which ImGui keeps
+// changing on the main thread (current font, clip rect) while the jobs run. the lists go in
+// front of the UI in the order their jobs were submitted, whichever finished first, so the
+// frame is the same for any number of threads
+class ParallelDrawLists
+{
+public:
+    typedef std::function<void(ImDrawList &)> Job;
+
+    struct Stats
+    {
+        int jobs = 0, threads = 0;
+        int vertices = 0, indices = 0;
+        float buildMs = 0.0f; // summed over the jobs
+        float waitMs = 0.0f;  // main thread blocked in Merge
+    };
+
+    // off: Submit runs the job right away on the calling thread
+    bool parallel = true;
+
+    ParallelDrawLists() = default;
+    ParallelDrawLists(const ParallelDrawLists &) = delete;
+    ParallelDrawLists &operator=(const ParallelDrawLists &) = delete;
+
+    ~ParallelDrawLists() { Jobs().Wait(counter); }
+
+    // after ImGui::NewFrame, once the frame's font and display size are known
+    void Begin()
+    {
+        Jobs().Wait(counter);
+        frameData = *ImGui::GetDrawListSharedData();
+        texture = ImGui::GetIO().Fonts->TexID;
+        used = 0;
+        buildNs = 0;
+        stats = Stats();
+        stats.threads = parallel ? Jobs().ThreadCount() : 0;
+    }
+
+    // the job gets an empty list with the font texture and a full screen clip rect pushed. with
+    // after, it starts once after reaches zero, for overlays of something still being computed
+    void Submit(Job job, JobCounter *after = nullptr)
+    {
+        if (used == lists.size()) lists.push_back(std::unique_ptr<ImDrawList>(new ImDrawList(&frameData)));
+        ImDrawList *list = lists[used++].get();
+        if (!parallel || Jobs().ThreadCount() == 0)
+        {
+            if (after) Jobs().Wait(*after);
+            build(list, job);
+            return;
+        }
+        Jobs().Run([this, list, job] { build(list, job); }, &counter, after);
+    }
+
+    // after ImGui::Render: waits for the jobs and puts their lists in front of the UI's
+    void Merge(ImDrawData *drawData)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        Jobs().Wait(counter);
+        stats.waitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        stats.jobs = (int)used;
+        stats.buildMs = buildNs / 1.0e6f;
+
+        merged.resize(0);
+        for (size_t i = 0; i < used; i++)
+        {
+            ImDrawList *list = lists[i].get();
+            if (list->CmdBuffer.Size == 0 || list->VtxBuffer.Size == 0) continue;
+            merged.push_back(list);
+            stats.vertices += list->VtxBuffer.Size;
+            stats.indices += list->IdxBuffer.Size;
+        }
+        if (!drawData || !drawData->Valid || merged.Size == 0) return;
+        for (int i = 0; i < drawData->CmdListsCount; i++) merged.push_back(drawData->CmdLists[i]);
+        drawData->CmdLists = merged.Data;
+        drawData->CmdListsCount = merged.Size;
+        drawData->TotalVtxCount += stats.vertices;
+        drawData->TotalIdxCount += stats.indices;
+    }
+
+    const Stats &GetStats() const { return stats; }
+
+private:
+    JobCounter counter;
+
+    // written in Begin only, while no job is queued
+    ImDrawListSharedData frameData;
+    ImTextureID texture = NULL;
+
+    // one list per job, reused from frame to frame
+    std::vector<std::unique_ptr<ImDrawList>> lists;
+    size_t used = 0;
+    ImVector<ImDrawList *> merged;
+    std::atomic<long long> buildNs{ 0 };
+    Stats stats;
+
+    void build(ImDrawList *list, const Job &job)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        list->_Data = &frameData;
+        list->_ResetForNewFrame();
+        list->PushTextureID(texture);
+        list->PushClipRectFullScreen();
+        job(*list);
+        list->_PopUnusedDrawCmd();
+        buildNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+};
+
+// world space to ImGui's screen space, for overlays drawn over the 3D view
+struct ScreenProjection
+{
+    glm::mat4 viewProjection;
+    ImVec2 size;
+    float focal; // pixels covered by one unit at distance one
+
+    ScreenProjection(const glm::mat4 &projection, const glm::mat4 &view, ImVec2 displaySize)
+        : viewProjection(projection * view), size(displaySize), focal(projection[1][1] * displaySize.y * 0.5f) {}
+
+    // false behind the camera. depth is the distance along the view direction
+    bool Project(const glm::vec3 &position, ImVec2 &screen, float &depth) const
+    {
+        glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+        if (clip.w <= 1e-4f) return false;
+        screen = ImVec2((clip.x / clip.w * 0.5f + 0.5f) * size.x, (0.5f - clip.y / clip.w * 0.5f) * size.y);
+        depth = clip.w;
+        return true;
+    }
+};
+
+// a line from every joint to its parent. globals are model space, ordered like parents
+inline void DrawSkeleton(ImDrawList &list, const ScreenProjection &projection, const glm::mat4 &model,
+                         Span<glm::mat4> globals, const std::vector<int> &parents, ImU32 color)
+{
+    size_t count = std::min(globals.size(), parents.size());
+    for (size_t i = 0; i < count; i++)
+    {
+        ImVec2 joint, parent;
+        float depth;
+        if (!projection.Project(glm::vec3(model * globals[i][3]), joint, depth)) continue;
+        list.AddCircleFilled(joint, 2.0f, color, 6);
+        if (parents[i] < 0) continue;
+        if (projection.Project(glm::vec3(model * globals[parents[i]][3]), parent, depth))
+            list.AddLine(parent, joint, color, 1.5f);
+    }
+}
+
+// a disc per light in its diffuse colour; spot lights also get their cone, one unit long
+inline void DrawLightGizmos(ImDrawList &list, const ScreenProjection &projection, const std::vector<Bulbs> &bulbs, bool spot)
+{
+    const int ringPoints = 16;
+    ImVec2 ring[ringPoints];
+    for (const Bulbs &bulb : bulbs)
+    {
+        ImVec2 center;
+        float depth;
+        if (!projection.Project(bulb.position, center, depth)) continue;
+        glm::vec3 rgb = glm::clamp(bulb.diffuse + bulb.ambient, glm::vec3(0.2f), glm::vec3(1.0f));
+        ImU32 color = ImGui::ColorConvertFloat4ToU32(ImVec4(rgb.x, rgb.y, rgb.z, 1.0f));
+        list.AddCircle(center, std::max(3.0f, 0.1f * projection.focal / depth), color, 0, 1.5f);
+        if (!spot || glm::dot(bulb.normal, bulb.normal) < 1e-8f) continue;
+
+        // rim of the cone, projected point by point; skipped when part of it is behind the camera
+        glm::vec3 axis = glm::normalize(bulb.normal);
+        glm::vec3 side = glm::normalize(glm::cross(axis, std::fabs(axis.y) < 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f)));
+        glm::vec3 up = glm::cross(side, axis);
+        float rim = std::tan(glm::radians(glm::clamp(bulb.angle, 1.0f, 80.0f)));
+        int projected = 0;
+        for (int i = 0; i < ringPoints; i++, projected++)
+        {
+            float a = 6.2831853f * i / ringPoints;
+            glm::vec3 point = bulb.position + axis + (side * std::cos(a) + up * std::sin(a)) * rim;
+            if (!projection.Project(point, ring[i], depth)) break;
+        }
+        if (projected < ringPoints) continue;
+        list.AddPolyline(ring, ringPoints, color, ImDrawFlags_Closed, 1.0f);
+        for (int i = 0; i < ringPoints; i += ringPoints / 4) list.AddLine(center, ring[i], color, 1.0f);
+    }
+}
+
+// outline of the bounding sphere of a mesh, and of its meshlets in [first, last)
+inline void DrawCullingBounds(ImDrawList &list, const ScreenProjection &projection, const glm::mat4 &model, const Mesh &mesh,
+                              size_t first, size_t last, bool meshBounds, ImU32 meshColor, ImU32 meshletColor)
+{
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    ImVec2 center;
+    float depth;
+    if (meshBounds && projection.Project(glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f)), center, depth))
+        list.AddCircle(center, mesh.boundsRadius * scale * projection.focal / depth, meshColor, 0, 1.5f);
+    last = std::min(last, mesh.meshlets.size());
+    for (size_t i = first; i < last; i++)
+    {
+        const Meshlet &meshlet = mesh.meshlets[i];
+        if (projection.Project(glm::vec3(model * glm::vec4(meshlet.center, 1.0f)), center, depth))
+            list.AddCircle(center, std::max(1.0f, meshlet.radius * scale * projection.focal / depth), meshletColor, 12);
+    }
+}
+
+#endif
@@ -0,0 +1,359 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// the last few seconds of frame times (or latencies), summarized as percentiles. a spike shows
+// up in the tail long after it has vanished from an average
+class PercentileWindow
+{
+public:
+    struct Summary
+    {
+        float p50 = 0.0f, p95 = 0.0f, p99 = 0.0f, max = 0.0f, mean = 0.0f;
+        int count = 0;
+    };
+
+    explicit PercentileWindow(size_t capacity = 600) : samples(capacity, 0.0f) {}
+
+    void Add(float ms)
+    {
+        samples[next] = ms;
+        next = (next + 1) % samples.size();
+        count = std::min(count + 1, samples.size());
+    }
+
+    Summary Summarize() const
+    {
+        Summary summary;
+        if (count == 0) return summary;
+        sorted.assign(samples.begin(), samples.begin() + count);
+        std::sort(sorted.begin(), sorted.end());
+        float sum = 0.0f;
+        for (float ms : sorted) sum += ms;
+        summary.p50 = at(0.50f);
+        summary.p95 = at(0.95f);
+        summary.p99 = at(0.99f);
+        summary.max = sorted.back();
+        summary.mean = sum / count;
+        summary.count = (int)count;
+        return summary;
+    }
+
+private:
+    std::vector<float> samples;
+    mutable std::vector<float> sorted;
+    size_t next = 0, count = 0;
+
+    float at(float percentile) const
+    {
+        return sorted[std::min(count - 1, (size_t)(percentile * (count - 1) + 0.5f))];
+    }
+};
+
+enum class VsyncMode
+{
+    Off,
+    On,
+    Adaptive // vsync while frames keep up with the display, tearing instead of waiting a whole refresh when they don't
+};
+
+// paces the main loop. the simulation (camera movement, animation) advances in fixed steps
+// independent of the frame rate and the frame renders it interpolated between the last two
+// steps, so a long frame delays the picture but doesn't change how far things move. frames can
+// be capped with a sleep that stops short of the deadline and a spin for the rest, and vsync is
+// off, on or adaptive. every frame is fenced: once the GPU is done with it, the time from the
+// input it was built from to its completion (GPU timestamp) is recorded as its latency, which is
+// what the display shows at the next refresh at the earliest. the fence and vsync half runs on
+// whichever thread owns the context (see render_thread.h), the rest on the main thread
+class FramePacer
+{
+public:
+    struct Stats
+    {
+        PercentileWindow::Summary frame, latency; // ms, refreshed twice a second
+        int steps = 0;                            // simulation steps this frame
+        long long droppedSteps = 0;               // simulation time dropped after stalls
+        float sleepMs = 0.0f, spinMs = 0.0f;      // frame cap wait, this frame
+        float wakeErrorMs = 0.0f;                 // how late the cap let the frame go
+        float sleepMarginMs = 0.0f;               // the part of the wait that spins
+        int swapInterval = 0;
+        bool tearControl = false;                 // driver adaptive vsync (swap interval -1)
+        int refreshRate = 60;
+    };
+
+    // what the GPU half of a frame needs to know about it, taken on the main thread
+    struct Mark
+    {
+        std::chrono::steady_clock::time_point input;
+        float frameSeconds = 0.0f;
+        VsyncMode vsync = VsyncMode::On;
+    };
+
+    // settings, applied from the next frame
+    bool fixedStep = true;
+    float stepHz = 60.0f;
+    float fpsCap = 0.0f; // 0: uncapped
+    VsyncMode vsync = VsyncMode::On;
+
+    explicit FramePacer(GLFWwindow *window)
+    {
+        GLFWmonitor *monitor = glfwGetWindowMonitor(window);
+        if (!monitor) monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+        if (mode && mode->refreshRate > 0) stats.refreshRate = mode->refreshRate;
+        stats.tearControl = glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+                            glfwExtensionSupported("GLX_EXT_swap_control_tear");
+        stats.sleepMarginMs = 1.0f;
+        lastWake = clock::now();
+    }
+
+    // at the top of the loop, right after the input was polled. returns the number of
+    // simulation steps to run this frame, each StepSeconds long
+    int BeginFrame()
+    {
+        clock::time_point now = clock::now();
+        frameSeconds = frameCount ? std::chrono::duration<float>(now - frameStart).count() : 0.0f;
+        frameStart = inputTime = now;
+        if (frameCount++) frameTimes.Add(frameSeconds * 1000.0f);
+
+        bool summarize = now - summaryTime > std::chrono::milliseconds(500);
+        if (summarize)
+        {
+            stats.frame = frameTimes.Summarize();
+            summaryTime = now;
+        }
+        {
+            std::lock_guard<std::mutex> lock(gpuMutex);
+            if (summarize) stats.latency = latencies.Summarize();
+            stats.swapInterval = swapInterval;
+        }
+
+        if (!fixedStep)
+        {
+            stepSeconds = frameSeconds;
+            accumulator = 0.0f;
+            alpha = 1.0f;
+            return stats.steps = 1;
+        }
+        stepSeconds = 1.0f / std::max(stepHz, 1.0f);
+        // one step to start from, and no more than a quarter second to catch up on after a stall
+        accumulator += frameCount == 1 ? stepSeconds : std::min(frameSeconds, 0.25f);
+        int steps = (int)(accumulator / stepSeconds);
+        if (steps > MaxSteps)
+        {
+            stats.droppedSteps += steps - MaxSteps;
+            accumulator -= (steps - MaxSteps) * stepSeconds;
+            steps = MaxSteps;
+        }
+        accumulator -= steps * stepSeconds;
+        alpha = std::min(std::max(accumulator / stepSeconds, 0.0f), 1.0f);
+        return stats.steps = steps;
+    }
+
+    float StepSeconds() const { return stepSeconds; }
+    float FrameSeconds() const { return frameSeconds; }
+    // how far the frame is past the last simulation step, in steps, for interpolation
+    float Alpha() const { return alpha; }
+
+    // for Fence, taken before the frame is handed to the thread that draws it
+    Mark FrameMark() const
+    {
+        Mark mark;
+        mark.input = inputTime;
+        mark.frameSeconds = frameSeconds;
+        mark.vsync = vsync;
+        return mark;
+    }
+
+    // right after glfwSwapBuffers, on the thread the context is current on: fences the frame and
+    // applies the vsync mode
+    void Fence(const Mark &mark)
+    {
+        std::lock_guard<std::mutex> lock(gpuMutex);
+        collectLatencies(false);
+        Pending pending;
+        pending.input = mark.input;
+        if (!freeQueries.empty())
+        {
+            pending.query = freeQueries.back();
+            freeQueries.pop_back();
+        }
+        else
+            glGenQueries(1, &pending.query);
+        glQueryCounter(pending.query, GL_TIMESTAMP);
+        pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        inFlight.push_back(pending);
+        // a GPU that falls this far behind would be waited on by the driver anyway
+        if (inFlight.size() > MaxInFlight) collectLatencies(true);
+
+        applyVsync(mark);
+    }
+
+    // on the main thread once the frame is submitted, before polling input: waits out the frame
+    // cap, so the next frame's input is as fresh as it can be. sleeps until shortly before the
+    // deadline, then spins. the sleep overshoots by up to a scheduler tick, so the margin left
+    // for spinning follows the worst overshoot seen lately
+    void Limit()
+    {
+        stats.sleepMs = stats.spinMs = stats.wakeErrorMs = 0.0f;
+        clock::time_point now = clock::now();
+        if (fpsCap <= 0.0f)
+        {
+            lastWake = now;
+            return;
+        }
+        clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(1.0f / fpsCap));
+        clock::time_point deadline = lastWake + period;
+        if (deadline <= now)
+        {
+            // late already; a new schedule from here instead of a burst of frames to catch up
+            lastWake = now;
+            return;
+        }
+
+        clock::time_point sleepUntil =
+            deadline - std::chrono::duration_cast<clock::duration>(std::chrono::duration<float, std::milli>(stats.sleepMarginMs));
+        if (sleepUntil > now)
+        {
+            std::this_thread::sleep_until(sleepUntil);
+            clock::time_point woke = clock::now();
+            float overshoot = std::chrono::duration<float, std::milli>(woke - sleepUntil).count();
+            stats.sleepMarginMs = std::min(std::max(std::max(stats.sleepMarginMs * 0.98f, overshoot * 1.25f), 0.2f), 4.0f);
+            stats.sleepMs = std::chrono::duration<float, std::milli>(woke - now).count();
+            now = woke;
+        }
+        clock::time_point spinStart = now;
+        while (now < deadline)
+        {
+            std::this_thread::yield();
+            now = clock::now();
+        }
+        stats.spinMs = std::chrono::duration<float, std::milli>(now - spinStart).count();
+        stats.wakeErrorMs = std::chrono::duration<float, std::milli>(now - deadline).count();
+        lastWake = deadline;
+    }
+
+    // needs the context, call before it goes away
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(gpuMutex);
+        for (Pending &pending : inFlight)
+        {
+            glDeleteSync(pending.fence);
+            freeQueries.push_back(pending.query);
+        }
+        inFlight.clear();
+        if (!freeQueries.empty()) glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+        freeQueries.clear();
+    }
+
+    const Stats &GetStats() const { return stats; }
+
+private:
+    typedef std::chrono::steady_clock clock;
+    static const int MaxSteps = 8;
+    static const size_t MaxInFlight = 8;
+
+    struct Pending
+    {
+        GLsync fence = 0;
+        GLuint query = 0;
+        clock::time_point input;
+    };
+
+    float frameSeconds = 0.0f, stepSeconds = 0.0f, accumulator = 0.0f, alpha = 1.0f;
+    unsigned long long frameCount = 0;
+    clock::time_point frameStart, inputTime, summaryTime, lastWake;
+    PercentileWindow frameTimes;
+
+    Stats stats;
+
+    // the GPU half, used by Fence
+    std::mutex gpuMutex;
+    PercentileWindow latencies;
+    std::deque<Pending> inFlight;
+    std::vector<GLuint> freeQueries;
+    long long gpuToCpuNs = 0; // steady_clock minus GL_TIMESTAMP, in nanoseconds
+    clock::time_point calibrated;
+    bool hasCalibration = false;
+    int swapInterval = 0;
+    bool swapIntervalSet = false;
+    int missedFrames = 0, keptFrames = 0;
+
+    static long long nanoseconds(clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    // lines the GPU clock up with ours; it drifts, so every few seconds
+    void calibrate()
+    {
+        clock::time_point now = clock::now();
+        if (hasCalibration && now - calibrated < std::chrono::seconds(5)) return;
+        GLint64 gpu = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu);
+        clock::time_point after = clock::now();
+        gpuToCpuNs = (nanoseconds(now) + nanoseconds(after)) / 2 - (long long)gpu;
+        calibrated = after;
+        hasCalibration = true;
+    }
+
+    // records the latency of every frame the GPU has finished. blocking waits for the oldest
+    void collectLatencies(bool blocking)
+    {
+        while (!inFlight.empty())
+        {
+            Pending &pending = inFlight.front();
+            GLenum status = glClientWaitSync(pending.fence, blocking ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                             blocking ? 1000000000ull : 0);
+            if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) return;
+            blocking = false;
+            calibrate();
+            GLuint64 done = 0;
+            glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &done);
+            float ms = ((long long)done + gpuToCpuNs - nanoseconds(pending.input)) / 1.0e6f;
+            if (ms > 0.0f) latencies.Add(ms);
+            glDeleteSync(pending.fence);
+            freeQueries.push_back(pending.query);
+            inFlight.pop_front();
+        }
+    }
+
+    void applyVsync(const Mark &mark)
+    {
+        int interval = 1;
+        if (mark.vsync == VsyncMode::Off)
+            interval = 0;
+        else if (mark.vsync == VsyncMode::Adaptive && stats.tearControl)
+            interval = -1;
+        else if (mark.vsync == VsyncMode::Adaptive)
+        {
+            // without the driver's help: a frame over one and a half refreshes was held back a
+            // whole refresh by vsync, so after two of those in a row vsync goes off until frames
+            // fit comfortably again for half a second
+            float refresh = 1.0f / stats.refreshRate;
+            interval = swapInterval == 0 ? 0 : 1;
+            missedFrames = mark.frameSeconds > refresh * 1.5f ? missedFrames + 1 : 0;
+            keptFrames = mark.frameSeconds < refresh * 0.9f ? keptFrames + 1 : 0;
+            if (interval == 1 && missedFrames >= 2) interval = 0;
+            if (interval == 0 && keptFrames >= stats.refreshRate / 2) interval = 1;
+        }
+        if (interval == swapInterval && swapIntervalSet) return;
+        glfwSwapInterval(interval);
+        swapInterval = interval;
+        swapIntervalSet = true;
+    }
+};
+
+#endif
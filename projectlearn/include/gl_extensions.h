@@ -0,0 +1,133 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// glad was generated for the GL 4.0 core profile, so entry points that only exist in later
+// versions (or as extensions) are resolved here at runtime. every pointer stays null when the
+// driver does not expose the feature, so callers check the matching flag before using it.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+typedef void (APIENTRYP PFNGETPROGRAMBINARY)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNPROGRAMBINARY)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNPROGRAMPARAMETERI)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADS)(GLuint count);
+typedef void (APIENTRYP PFNBUFFERSTORAGE)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECT)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+struct GLExtensions
+{
+    // GL 4.1 / ARB_get_program_binary
+    bool programBinary = false;
+    PFNGETPROGRAMBINARY GetProgramBinary = nullptr;
+    PFNPROGRAMBINARY ProgramBinary = nullptr;
+    PFNPROGRAMPARAMETERI ProgramParameteri = nullptr;
+
+    // KHR_parallel_shader_compile / ARB_parallel_shader_compile
+    bool parallelShaderCompile = false;
+    PFNMAXSHADERCOMPILERTHREADS MaxShaderCompilerThreads = nullptr;
+
+    // GL 4.4 / ARB_buffer_storage: immutable buffers that can stay mapped while the GPU reads them
+    bool bufferStorage = false;
+    PFNBUFFERSTORAGE BufferStorage = nullptr;
+
+    // GL 4.3 / ARB_multi_draw_indirect: a whole list of glDrawElementsIndirect commands in one call
+    bool multiDrawIndirect = false;
+    PFNMULTIDRAWELEMENTSINDIRECT MultiDrawElementsIndirect = nullptr;
+
+    // EXT_texture_compression_s3tc: BC1/BC3 uploads through glCompressedTexImage2D (core entry point)
+    bool textureCompressionS3TC = false;
+};
+
+inline GLExtensions& GLExt()
+{
+    static GLExtensions extensions;
+    return extensions;
+}
+
+inline bool HasGLVersion(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+inline bool HasGLExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// call once after gladLoadGLLoader, with the same loader function
+inline void LoadGLExtensions(GLADloadproc load)
+{
+    GLExtensions &ext = GLExt();
+
+    if (HasGLVersion(4, 1) || HasGLExtension("GL_ARB_get_program_binary"))
+    {
+        ext.GetProgramBinary = (PFNGETPROGRAMBINARY)load("glGetProgramBinary");
+        ext.ProgramBinary = (PFNPROGRAMBINARY)load("glProgramBinary");
+        ext.ProgramParameteri = (PFNPROGRAMPARAMETERI)load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        // a driver may advertise the extension but support zero formats, which makes it useless
+        ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+    }
+
+    if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADS)load("glMaxShaderCompilerThreadsKHR");
+    else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADS)load("glMaxShaderCompilerThreadsARB");
+    if (ext.MaxShaderCompilerThreads)
+    {
+        // let the driver pick its own thread count; GL_COMPLETION_STATUS_KHR then polls without blocking
+        ext.MaxShaderCompilerThreads(0xFFFFFFFFu);
+        ext.parallelShaderCompile = true;
+    }
+
+    if (HasGLVersion(4, 4) || HasGLExtension("GL_ARB_buffer_storage"))
+        ext.BufferStorage = (PFNBUFFERSTORAGE)load("glBufferStorage");
+    ext.bufferStorage = ext.BufferStorage != nullptr;
+
+    if (HasGLVersion(4, 3) || HasGLExtension("GL_ARB_multi_draw_indirect"))
+        ext.MultiDrawElementsIndirect = (PFNMULTIDRAWELEMENTSINDIRECT)load("glMultiDrawElementsIndirect");
+    ext.multiDrawIndirect = ext.MultiDrawElementsIndirect != nullptr;
+
+    ext.textureCompressionS3TC = HasGLExtension("GL_EXT_texture_compression_s3tc");
+}
+
+#endif
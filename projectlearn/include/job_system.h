@@ -0,0 +1,329 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// counts the jobs that signal it and are not finished yet. jobs can be queued to start once it
+// reaches zero, which is how one stage of a task graph waits for the one before without any
+// thread blocking in between
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> pending{ 0 };
+    std::mutex mutex;
+    std::vector<std::pair<std::function<void()>, JobCounter *>> waiting; // job, and the counter it signals
+};
+
+// threads besides the workers that get a deque and stats of their own (see RegisterThread)
+#define JOB_MAX_REGISTERED_THREADS 4
+
+// a fixed set of worker threads running short CPU jobs. every worker has its own deque: it
+// pushes and pops its own jobs at the back, where they are still in cache, and when it runs
+// dry it steals the oldest job from the front of someone else's. threads that aren't workers
+// (the main thread, the render thread) get one each once registered, and share one more
+// otherwise. Wait doesn't block while there is work: the waiting thread runs jobs itself, so
+// nested ParallelFor calls inside jobs are fine. with no worker threads every job runs inline
+// on the thread that queues it
+class JobSystem
+{
+public:
+    typedef std::function<void()> Job;
+    // [begin, end) of the range handed to ParallelFor
+    typedef std::function<void(size_t, size_t)> RangeJob;
+
+    // per slot, between two calls to Sample: 0 is the unregistered threads, then the workers,
+    // then the registered threads
+    struct ThreadStats
+    {
+        const char *name = "";
+        float busyMs = 0.0f;
+        int jobs = 0;
+        int steals = 0; // jobs taken from another thread's deque
+    };
+
+    explicit JobSystem(int threadCount)
+    {
+        threadCount = std::max(threadCount, 0);
+        workerCount = threadCount;
+        // allocated up front: the deques are walked without a lock on the vector
+        for (int i = 0; i <= threadCount + JOB_MAX_REGISTERED_THREADS; i++) slots.push_back(std::unique_ptr<Slot>(new Slot()));
+        slots[0]->name = "other threads";
+        for (int i = 1; i <= threadCount; i++) slots[i]->name = "worker";
+        lastSample = std::chrono::steady_clock::now();
+        for (int i = 1; i <= threadCount; i++) slots[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::unique_ptr<Slot> &slot : slots)
+            if (slot->thread.joinable()) slot->thread.join();
+    }
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    int ThreadCount() const { return workerCount; }
+
+    // gives the calling thread its own deque and stats under name (a string literal), instead of
+    // the one the unregistered threads share. once per thread, before it queues jobs; past
+    // JOB_MAX_REGISTERED_THREADS threads keep sharing
+    void RegisterThread(const char *name)
+    {
+        if (threadSlot() >= 0) return;
+        int index = registered.fetch_add(1);
+        if (index >= JOB_MAX_REGISTERED_THREADS) return;
+        int slot = workerCount + 1 + index;
+        slots[slot]->name = name;
+        threadSlot() = slot;
+    }
+
+    // queues job, counted by signal if given. with after, it starts once after reaches zero
+    void Run(Job job, JobCounter *signal = nullptr, JobCounter *after = nullptr)
+    {
+        if (signal) signal->pending.fetch_add(1, std::memory_order_relaxed);
+        if (after)
+        {
+            std::lock_guard<std::mutex> lock(after->mutex);
+            if (!after->Done())
+            {
+                after->waiting.emplace_back(std::move(job), signal);
+                return;
+            }
+        }
+        schedule(Task{ std::move(job), signal });
+    }
+
+    // returns once counter reaches zero, running queued jobs in the meantime. a counter on the
+    // stack must be waited on before it goes out of scope
+    void Wait(JobCounter &counter)
+    {
+        int self = currentSlot();
+        while (!counter.Done())
+        {
+            if (runOne(self)) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            finished.wait_for(lock, std::chrono::microseconds(200), [this, &counter] { return counter.Done() || queued > 0; });
+        }
+        // the last job may still be inside complete
+        std::lock_guard<std::mutex> lock(counter.mutex);
+    }
+
+    // calls job on ranges of at least grain items covering [0, count) and returns when all of
+    // them are done. the calling thread takes the first range
+    void ParallelFor(size_t count, size_t grain, const RangeJob &job)
+    {
+        if (count == 0) return;
+        grain = std::max<size_t>(grain, 1);
+        if (workerCount == 0 || count <= grain)
+        {
+            job(0, count);
+            return;
+        }
+        // a few ranges per thread, so a slow one can be balanced by stealing the rest
+        size_t ranges = std::min((count + grain - 1) / grain, slots.size() * 4);
+        size_t size = (count + ranges - 1) / ranges;
+        JobCounter counter;
+        for (size_t begin = size; begin < count; begin += size)
+        {
+            size_t end = std::min(begin + size, count);
+            Run([&job, begin, end] { job(begin, end); }, &counter);
+        }
+        job(0, std::min(size, count));
+        Wait(counter);
+    }
+
+    // busy time, jobs and steals per thread since the last call, and how long that was
+    std::vector<ThreadStats> Sample(float &windowMs)
+    {
+        auto now = std::chrono::steady_clock::now();
+        windowMs = std::chrono::duration<float, std::milli>(now - lastSample).count();
+        lastSample = now;
+        std::vector<ThreadStats> result(workerCount + 1 + std::min(registered.load(), JOB_MAX_REGISTERED_THREADS));
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            result[i].name = slots[i]->name;
+            result[i].busyMs = slots[i]->busyNs.exchange(0) / 1.0e6f;
+            result[i].jobs = slots[i]->jobs.exchange(0);
+            result[i].steals = slots[i]->steals.exchange(0);
+        }
+        return result;
+    }
+
+private:
+    struct Task
+    {
+        Job job;
+        JobCounter *signal;
+    };
+
+    struct Slot
+    {
+        std::thread thread;
+        const char *name = "";
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<long long> busyNs{ 0 };
+        std::atomic<int> jobs{ 0 }, steals{ 0 };
+    };
+
+    std::vector<std::unique_ptr<Slot>> slots; // 0 is shared by unregistered threads, then workers, then registered threads
+    int workerCount = 0;
+    std::atomic<int> registered{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake, finished;
+    int queued = 0; // tasks in all deques, under sleepMutex
+    bool quit = false;
+    std::chrono::steady_clock::time_point lastSample;
+
+    // -1 until the thread is a worker or registered
+    static int &threadSlot()
+    {
+        static thread_local int slot = -1;
+        return slot;
+    }
+
+    // a worker's or registered thread's own slot; 0 on every other thread
+    int currentSlot() const
+    {
+        int slot = threadSlot();
+        return slot >= 0 && slot < (int)slots.size() ? slot : 0;
+    }
+
+    void schedule(Task task)
+    {
+        if (workerCount == 0)
+        {
+            execute(task, currentSlot());
+            return;
+        }
+        Slot &slot = *slots[currentSlot()];
+        {
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            slot.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wake.notify_one();
+        finished.notify_all();
+    }
+
+    // own deque from the back, then everyone else's from the front
+    bool runOne(int self)
+    {
+        Task task;
+        bool stolen = false;
+        if (!pop(*slots[self], true, task))
+        {
+            size_t count = slots.size();
+            size_t i = 1;
+            for (; i < count; i++)
+                if (pop(*slots[(self + i) % count], false, task)) break;
+            if (i == count) return false;
+            stolen = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued--;
+        }
+        if (stolen) slots[self]->steals++;
+        execute(task, self);
+        return true;
+    }
+
+    static bool pop(Slot &slot, bool back, Task &task)
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        if (slot.tasks.empty()) return false;
+        if (back)
+        {
+            task = std::move(slot.tasks.back());
+            slot.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(slot.tasks.front());
+            slot.tasks.pop_front();
+        }
+        return true;
+    }
+
+    void execute(Task &task, int self)
+    {
+        auto start = std::chrono::steady_clock::now();
+        task.job();
+        Slot &slot = *slots[self];
+        slot.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        slot.jobs++;
+        if (task.signal) complete(*task.signal);
+    }
+
+    // the last job of a counter releases the jobs waiting on it. the counter isn't touched after
+    // its mutex is unlocked: Wait takes the mutex once more before the owner can destroy it
+    void complete(JobCounter &counter)
+    {
+        std::vector<std::pair<Job, JobCounter *>> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter.mutex);
+            if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+            ready.swap(counter.waiting);
+        }
+        for (std::pair<Job, JobCounter *> &entry : ready) schedule(Task{ std::move(entry.first), entry.second });
+        {
+            // so a thread between its check and its wait in Wait doesn't miss the notify
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        finished.notify_all();
+    }
+
+    void workerLoop(int self)
+    {
+        threadSlot() = self;
+        for (;;)
+        {
+            if (runOne(self)) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return quit || queued > 0; });
+            if (quit) return;
+        }
+    }
+};
+
+// worker threads of Jobs(); the command line sets it before the first call
+inline int &JobThreadCount()
+{
+    static int count = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    return count;
+}
+
+// the process wide job system, started on first use
+inline JobSystem &Jobs()
+{
+    static JobSystem jobs(JobThreadCount());
+    return jobs;
+}
+
+#endif
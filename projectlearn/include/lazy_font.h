@@ -0,0 +1,547 @@
+#ifndef LAZY_FONT_H
+#define LAZY_FONT_H
+
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "imgui_impl_opengl3.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// stb_truetype and stb_rect_pack, built the way imgui_draw.cpp builds its own copy so lazily
+// rasterized glyphs come out exactly like baked ones. static, so this header belongs in a
+// single translation unit (main.cpp)
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#endif
+#define STBRP_STATIC
+#define STBRP_ASSERT(x) do { IM_ASSERT(x); } while (0)
+#define STBRP_SORT ImQsort
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+#define STBTT_malloc(x, u) ((void)(u), IM_ALLOC(x))
+#define STBTT_free(x, u) ((void)(u), IM_FREE(x))
+#define STBTT_assert(x) do { IM_ASSERT(x); } while (0)
+#define STBTT_fmod(x, y) ImFmod(x, y)
+#define STBTT_sqrt(x) ImSqrt(x)
+#define STBTT_pow(x, y) ImPow(x, y)
+#define STBTT_fabs(x) ImFabs(x)
+#define STBTT_ifloor(x) ((int)ImFloorSigned(x))
+#define STBTT_iceil(x) ((int)ImCeil(x))
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "imstb_truetype.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+// ImGui's font atlas with glyphs rasterized on demand. ImFontAtlas::Build normally rasterizes
+// every glyph of every range before the first frame; here Build only bakes the handful ImGui
+// can't do without (space, dot, question mark) plus a few empty pages reserved as custom rects.
+// the first time text asks for any other glyph of the font's ranges (ImFontAtlas::GlyphMissingFn),
+// a worker thread rasterizes it into a free spot of a page while the frame carries on with the
+// fallback glyph. Update, before the next NewFrame, takes whatever the worker has finished by
+// then without waiting for the rest, copies those glyphs into the atlas, registers them with
+// their font and uploads only the rectangles that changed. a missing glyph is shown as the
+// placeholder until the frame after the worker gets to it. when the pages fill up the atlas is
+// rebuilt with twice as many, everything loaded so far baked in, once the worker is idle
+class LazyFontAtlas
+{
+public:
+    struct Stats
+    {
+        bool lazy = false;
+        float buildMs = 0.0f, uploadMs = 0.0f; // startup: ImFontAtlas::Build and the texture upload
+        int width = 0, height = 0;
+        size_t alphaBytes = 0, rgbaBytes = 0, pageBytes = 0, textureBytes = 0;
+        int bakedGlyphs = 0;    // rasterized by Build
+        int availableGlyphs = 0; // in the fonts' ranges, baked or not
+        int lazyGlyphs = 0, absentGlyphs = 0;
+        int pages = 0, pagesUsed = 0;
+        int uploads = 0;
+        size_t uploadBytes = 0;
+        float rasterMs = 0.0f;  // worker, all glyphs
+        float waitMs = 0.0f;    // main thread waiting on the worker's lock in Update, all frames
+        int placeholderFrames = 0, rebuilds = 0;
+    };
+
+    LazyFontAtlas() {}
+    LazyFontAtlas(const LazyFontAtlas &) = delete;
+    LazyFontAtlas &operator=(const LazyFontAtlas &) = delete;
+    ~LazyFontAtlas() { Shutdown(); }
+
+    // after ImGui_ImplOpenGL3_Init, before the first NewFrame. builds the atlas and creates the
+    // font texture right away so both can be timed; ImGui's default font when none was added
+    void Setup(bool lazyGlyphs)
+    {
+        ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+        if (atlas->ConfigData.empty()) atlas->AddFontDefault();
+        stats = Stats();
+        stats.lazy = lazyGlyphs;
+
+        float largest = 0.0f;
+        for (int i = 0; i < atlas->ConfigData.Size; i++)
+        {
+            ImFontConfig &cfg = atlas->ConfigData[i];
+            const ImWchar *ranges = cfg.GlyphRanges ? cfg.GlyphRanges : atlas->GetGlyphRangesDefault();
+            std::unique_ptr<Source> source(new Source());
+            source->config = i;
+            source->font = cfg.DstFont;
+            stbtt_InitFont(&source->info, (const unsigned char *)cfg.FontData,
+                           stbtt_GetFontOffsetForIndex((const unsigned char *)cfg.FontData, cfg.FontNo));
+            int top = 0;
+            for (const ImWchar *range = ranges; range[0] && range[1]; range += 2) top = std::max(top, (int)range[1]);
+            source->ranges.Create(top + 1);
+            source->requested.reset(new std::atomic<ImU32>[source->ranges.Storage.Size]);
+            for (int w = 0; w < source->ranges.Storage.Size; w++) source->requested[w] = 0;
+            for (const ImWchar *range = ranges; range[0] && range[1]; range += 2)
+                for (int c = range[0]; c <= (int)range[1]; c++)
+                    if (!source->ranges.TestBit(c) && stbtt_FindGlyphIndex(&source->info, c))
+                    {
+                        source->ranges.SetBit(c);
+                        stats.availableGlyphs++;
+                    }
+            if (lazyGlyphs)
+            {
+                const ImWchar eager[] = { (ImWchar)' ', (ImWchar)'.', (ImWchar)'?' };
+                for (ImWchar c : eager)
+                    if (c <= top && source->ranges.TestBit(c)) source->loaded.push_back(c);
+                bake(*source, cfg);
+            }
+            largest = std::max(largest, std::fabs(cfg.SizePixels) * (float)std::max(cfg.OversampleH, cfg.OversampleV));
+            sources.push_back(std::move(source));
+        }
+        if (lazyGlyphs)
+        {
+            // a few rows of the largest glyph, so small fonts don't pay for big pages. at most half
+            // the narrowest atlas Build picks, or the page rects won't pack
+            pageWidth = ImClamp(ImUpperPowerOfTwo((int)(largest * 8.0f)), 64, 256);
+            pageHeight = ImClamp(ImUpperPowerOfTwo((int)(largest * 4.0f)), 64, 256);
+            addPages(InitialPages);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        atlas->Build();
+        stats.buildMs = elapsedMs(start);
+        start = std::chrono::high_resolution_clock::now();
+        ImGui_ImplOpenGL3_CreateFontsTexture();
+        stats.uploadMs = elapsedMs(start);
+        measure();
+
+        if (lazyGlyphs)
+        {
+            resetPages();
+            atlas->GlyphMissingFn = &LazyFontAtlas::glyphMissing;
+            atlas->GlyphMissingUserData = this;
+            quit = false;
+            worker = std::thread(&LazyFontAtlas::workerLoop, this);
+        }
+        std::cout << "Font atlas (" << (lazyGlyphs ? "lazy" : "eager") << "): " << stats.bakedGlyphs << " of "
+                  << stats.availableGlyphs << " glyphs baked in " << stats.buildMs << " ms, " << stats.width << "x"
+                  << stats.height << " texture uploaded in " << stats.uploadMs << " ms, "
+                  << (stats.alphaBytes + stats.rgbaBytes + stats.pageBytes) / 1024.0f << " KB on the CPU, "
+                  << stats.textureBytes / 1024.0f << " KB on the GPU" << std::endl;
+    }
+
+    // before ImGui::NewFrame: brings in the glyphs the worker has finished; the ones it is still
+    // on wait for a later frame
+    void Update()
+    {
+        if (!stats.lazy) return;
+        std::vector<Glyph> glyphs;
+        bool idle;
+        bool grow = collect(glyphs, idle);
+        if (!glyphs.empty())
+        {
+            stats.placeholderFrames++;
+            integrate(glyphs);
+        }
+        // the glyphs that didn't fit are queued again for the new pages. Build moves the pages,
+        // so it waits until the worker isn't packing into them
+        if (grow && idle) rebuild();
+    }
+
+    // whether Update has anything to do this frame, without waiting for the worker
+    bool Pending()
+    {
+        if (!stats.lazy) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        return !ready.empty() || (!overflow.empty() && queue.empty() && !busy);
+    }
+
+    // stops the worker; before ImGui::DestroyContext, which owns the allocator it uses
+    void Shutdown()
+    {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        worker.join();
+        ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+        atlas->GlyphMissingFn = NULL;
+        atlas->GlyphMissingUserData = NULL;
+        for (Page &page : pages) stbtt_PackEnd(&page.pack);
+        pages.clear();
+    }
+
+    const Stats &GetStats() const { return stats; }
+
+    // changes whenever glyphs were added, for caches of rendered text
+    unsigned int Generation() const { return generation; }
+
+private:
+    static const int InitialPages = 2;
+    static const int MaxPages = 256;
+
+    // one per ImFontConfig
+    struct Source
+    {
+        int config;
+        ImFont *font;
+        stbtt_fontinfo info;
+        ImBitVector ranges;          // codepoints in the config's glyph ranges that the font file has
+        std::unique_ptr<std::atomic<ImU32>[]> requested; // like ranges: handed to the worker already
+        std::vector<ImWchar> loaded; // codepoints with a glyph in the atlas
+        std::vector<ImWchar> baked;  // ranges handed to Build, zero terminated
+    };
+
+    // a custom rect of the atlas that the worker packs glyphs into, with a copy of its pixels
+    struct Page
+    {
+        int rect;
+        int x = 0, y = 0;
+        std::vector<unsigned char> pixels;
+        stbtt_pack_context pack;
+        int glyphs = 0;
+        int dirtyMinX = 0, dirtyMinY = 0, dirtyMaxX = 0, dirtyMaxY = 0;
+    };
+
+    // rasterized, waiting for Update to add it to the font
+    struct Glyph
+    {
+        int source, page;
+        ImWchar codepoint;
+        stbrp_rect rect;
+        stbtt_packedchar packed;
+    };
+
+    enum RasterResult { Rasterized, Absent, NoRoom };
+
+    std::vector<std::unique_ptr<Source>> sources;
+    std::vector<Page> pages;
+    int pageWidth = 0, pageHeight = 0;
+    unsigned int generation = 0;
+    Stats stats;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::pair<int, ImWchar>> queue; // source, codepoint
+    std::vector<Glyph> ready;
+    std::vector<std::pair<int, ImWchar>> overflow; // didn't fit any page
+    bool busy = false, quit = false;
+    long long rasterNs = 0;
+    int absent = 0;
+
+    static float elapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // restricts the config's ranges to the loaded glyphs for the next Build
+    void bake(Source &source, ImFontConfig &cfg)
+    {
+        std::sort(source.loaded.begin(), source.loaded.end());
+        source.baked.clear();
+        for (ImWchar c : source.loaded)
+        {
+            if (!source.baked.empty() && source.baked.back() + 1 == c)
+                source.baked.back() = c;
+            else
+            {
+                source.baked.push_back(c);
+                source.baked.push_back(c);
+            }
+        }
+        source.baked.push_back(0);
+        cfg.GlyphRanges = source.baked.data();
+    }
+
+    void addPages(int count)
+    {
+        ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+        for (int i = 0; i < count; i++)
+        {
+            Page page;
+            page.rect = atlas->AddCustomRectRegular(pageWidth, pageHeight);
+            pages.push_back(std::move(page));
+        }
+    }
+
+    // after Build: the pages' new places in the atlas, emptied
+    void resetPages()
+    {
+        ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+        for (Page &page : pages)
+        {
+            const ImFontAtlasCustomRect *rect = atlas->GetCustomRectByIndex(page.rect);
+            IM_ASSERT(rect->IsPacked());
+            if (!page.pixels.empty()) stbtt_PackEnd(&page.pack);
+            page.x = rect->X;
+            page.y = rect->Y;
+            page.pixels.assign((size_t)pageWidth * pageHeight, 0);
+            stbtt_PackBegin(&page.pack, page.pixels.data(), pageWidth, pageHeight, 0, atlas->TexGlyphPadding, NULL);
+            page.glyphs = 0;
+            page.dirtyMaxX = page.dirtyMaxY = 0;
+        }
+    }
+
+    void measure()
+    {
+        ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+        stats.width = atlas->TexWidth;
+        stats.height = atlas->TexHeight;
+        size_t texels = (size_t)atlas->TexWidth * atlas->TexHeight;
+        stats.alphaBytes = atlas->TexPixelsAlpha8 ? texels : 0;
+        stats.rgbaBytes = atlas->TexPixelsRGBA32 ? texels * 4 : 0;
+        stats.pageBytes = pages.size() * (size_t)pageWidth * pageHeight;
+        stats.textureBytes = texels * 4;
+        stats.pages = (int)pages.size();
+        stats.bakedGlyphs = 0;
+        for (ImFont *font : atlas->Fonts) stats.bakedGlyphs += font->Glyphs.Size;
+        stats.bakedGlyphs -= atlas->Fonts.Size; // the tab glyph BuildLookupTable makes out of space
+    }
+
+    // ImFontAtlas::GlyphMissingFn, on whichever thread is building text. text asks again every
+    // frame until the glyph is in, so repeats are turned away by the bit alone, without the lock
+    static void glyphMissing(const ImFont *font, ImWchar c, void *userData)
+    {
+        LazyFontAtlas *self = (LazyFontAtlas *)userData;
+        for (size_t i = 0; i < self->sources.size(); i++)
+        {
+            const Source &source = *self->sources[i];
+            if (source.font != font || c >= source.ranges.Storage.Size * 32 || !source.ranges.TestBit(c)) continue;
+            std::atomic<ImU32> &word = source.requested[c >> 5];
+            ImU32 bit = (ImU32)1 << (c & 31);
+            if (word.load(std::memory_order_relaxed) & bit) return;
+            if (word.fetch_or(bit, std::memory_order_relaxed) & bit) return;
+            {
+                std::lock_guard<std::mutex> lock(self->mutex);
+                self->queue.push_back(std::make_pair((int)i, c));
+            }
+            self->wake.notify_one();
+            return;
+        }
+    }
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::pair<int, ImWchar> request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return quit || !queue.empty(); });
+                if (quit) return;
+                request = queue.front();
+                queue.pop_front();
+                busy = true;
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            Glyph glyph;
+            RasterResult result = rasterize(request.first, request.second, glyph);
+            long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                rasterNs += ns;
+                if (result == Rasterized) ready.push_back(glyph);
+                else if (result == NoRoom) overflow.push_back(request);
+                else absent++;
+                busy = false;
+            }
+        }
+    }
+
+    // into the first page with room for it. the config is only read, and a page's packer and the
+    // pixels of glyphs not yet handed over are only touched here while the worker runs
+    RasterResult rasterize(int sourceIndex, ImWchar c, Glyph &glyph)
+    {
+        Source &source = *sources[sourceIndex];
+        const ImFontConfig &cfg = ImGui::GetIO().Fonts->ConfigData[source.config];
+        int codepoint = c;
+        stbtt_pack_range range = {};
+        range.font_size = cfg.SizePixels;
+        range.array_of_unicode_codepoints = &codepoint;
+        range.num_chars = 1;
+        range.chardata_for_range = &glyph.packed;
+        for (size_t p = 0; p < pages.size(); p++)
+        {
+            Page &page = pages[p];
+            stbtt_PackSetOversampling(&page.pack, cfg.OversampleH, cfg.OversampleV);
+            stbrp_rect rect;
+            stbtt_PackFontRangesGatherRects(&page.pack, &source.info, &range, 1, &rect);
+            if (rect.w > pageWidth || rect.h > pageHeight)
+            {
+                std::cout << "ERROR::LAZY_FONT::GLYPH_TOO_LARGE: U+" << std::hex << (int)c << std::dec << std::endl;
+                return Absent;
+            }
+            stbtt_PackFontRangesPackRects(&page.pack, &rect, 1);
+            if (!rect.was_packed) continue;
+            stbtt_PackFontRangesRenderIntoRects(&page.pack, &source.info, &range, 1, &rect);
+            if (cfg.RasterizerMultiply != 1.0f)
+            {
+                unsigned char table[256];
+                ImFontAtlasBuildMultiplyCalcLookupTable(table, cfg.RasterizerMultiply);
+                ImFontAtlasBuildMultiplyRectAlpha8(table, page.pixels.data(), rect.x, rect.y, rect.w, rect.h, pageWidth);
+            }
+            glyph.source = sourceIndex;
+            glyph.page = (int)p;
+            glyph.codepoint = c;
+            glyph.rect = rect;
+            return Rasterized;
+        }
+        return NoRoom;
+    }
+
+    // takes what the worker rasterized so far, and whether it is idle. true when some glyphs
+    // found no room in the pages
+    bool collect(std::vector<Glyph> &glyphs, bool &idle)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        glyphs.clear();
+        glyphs.swap(ready);
+        idle = queue.empty() && !busy;
+        stats.rasterMs = rasterNs / 1.0e6f;
+        stats.absentGlyphs = absent;
+        stats.waitMs += elapsedMs(start);
+        return !overflow.empty();
+    }
+
+    // copies the glyphs into the atlas, registers them the way ImFontAtlasBuildWithStbTruetype
+    // does and uploads what changed, one rectangle per page
+    void integrate(std::vector<Glyph> &glyphs)
+    {
+        ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+        std::vector<ImFont *> fonts;
+        for (const Glyph &glyph : glyphs)
+        {
+            Source &source = *sources[glyph.source];
+            ImFont *font = source.font;
+            if (std::find(fonts.begin(), fonts.end(), font) == fonts.end())
+            {
+                // BuildLookupTable appends a tab glyph unless it's the last one already
+                if (!font->Glyphs.empty() && font->Glyphs.back().Codepoint == '\t') font->Glyphs.pop_back();
+                fonts.push_back(font);
+            }
+
+            Page &page = pages[glyph.page];
+            const stbrp_rect &rect = glyph.rect;
+            int atlasX = page.x + rect.x, atlasY = page.y + rect.y;
+            for (int y = 0; y < rect.h; y++)
+            {
+                const unsigned char *src = &page.pixels[(size_t)(rect.y + y) * pageWidth + rect.x];
+                size_t offset = (size_t)(atlasY + y) * atlas->TexWidth + atlasX;
+                memcpy(atlas->TexPixelsAlpha8 + offset, src, rect.w);
+                if (atlas->TexPixelsRGBA32)
+                    for (int x = 0; x < rect.w; x++) atlas->TexPixelsRGBA32[offset + x] = IM_COL32(255, 255, 255, (unsigned int)src[x]);
+            }
+            if (page.dirtyMaxX == 0)
+            {
+                page.dirtyMinX = rect.x;
+                page.dirtyMinY = rect.y;
+            }
+            page.dirtyMinX = std::min(page.dirtyMinX, (int)rect.x);
+            page.dirtyMinY = std::min(page.dirtyMinY, (int)rect.y);
+            page.dirtyMaxX = std::max(page.dirtyMaxX, (int)(rect.x + rect.w));
+            page.dirtyMaxY = std::max(page.dirtyMaxY, (int)(rect.y + rect.h));
+            if (page.glyphs++ == 0) stats.pagesUsed++;
+
+            const ImFontConfig &cfg = atlas->ConfigData[source.config];
+            stbtt_packedchar packed = glyph.packed;
+            packed.x0 += (unsigned short)page.x;
+            packed.x1 += (unsigned short)page.x;
+            packed.y0 += (unsigned short)page.y;
+            packed.y1 += (unsigned short)page.y;
+            stbtt_aligned_quad q;
+            float unusedX = 0.0f, unusedY = 0.0f;
+            stbtt_GetPackedQuad(&packed, atlas->TexWidth, atlas->TexHeight, 0, &unusedX, &unusedY, &q, 0);
+            const float offX = cfg.GlyphOffset.x, offY = cfg.GlyphOffset.y + IM_ROUND(font->Ascent);
+            font->AddGlyph(&cfg, glyph.codepoint, q.x0 + offX, q.y0 + offY, q.x1 + offX, q.y1 + offY, q.s0, q.t0, q.s1, q.t1,
+                           packed.xadvance);
+            source.loaded.push_back(glyph.codepoint);
+            stats.lazyGlyphs++;
+        }
+        for (ImFont *font : fonts) font->BuildLookupTable();
+
+        for (Page &page : pages)
+        {
+            if (page.dirtyMaxX == 0) continue;
+            int w = page.dirtyMaxX - page.dirtyMinX, h = page.dirtyMaxY - page.dirtyMinY;
+            ImGui_ImplOpenGL3_UpdateFontsTexture(page.x + page.dirtyMinX, page.y + page.dirtyMinY, w, h);
+            stats.uploads++;
+            stats.uploadBytes += (size_t)w * h * 4;
+            page.dirtyMaxX = page.dirtyMaxY = 0;
+        }
+        generation++;
+    }
+
+    // the pages are full: everything loaded so far becomes part of Build, with twice the pages
+    // for whatever comes next. the worker is idle and nothing builds text while this runs
+    void rebuild()
+    {
+        std::vector<std::pair<int, ImWchar>> retry;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            retry.swap(overflow);
+        }
+        if ((int)pages.size() >= MaxPages)
+        {
+            std::cout << "ERROR::LAZY_FONT::ATLAS_FULL: " << retry.size() << " glyphs left as placeholders" << std::endl;
+            return;
+        }
+
+        ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+        for (std::unique_ptr<Source> &source : sources) bake(*source, atlas->ConfigData[source->config]);
+        addPages(std::min((int)pages.size(), MaxPages - (int)pages.size()));
+        auto start = std::chrono::high_resolution_clock::now();
+        atlas->Build();
+        ImGui_ImplOpenGL3_DestroyFontsTexture();
+        ImGui_ImplOpenGL3_CreateFontsTexture();
+        float ms = elapsedMs(start);
+        resetPages();
+        Stats previous = stats;
+        measure();
+        stats.buildMs = previous.buildMs;
+        stats.uploadMs = previous.uploadMs;
+        stats.pagesUsed = 0;
+        stats.rebuilds++;
+        generation++;
+        std::cout << "Font atlas: pages full, rebuilt with " << stats.bakedGlyphs << " glyphs baked and " << pages.size()
+                  << " pages in " << ms << " ms, " << stats.width << "x" << stats.height << std::endl;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.insert(queue.end(), retry.begin(), retry.end());
+        }
+        wake.notify_one();
+    }
+};
+
+#endif
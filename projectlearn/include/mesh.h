@@ -6,8 +6,12 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "gl_extensions.h"
 #include "shader.h"
+#include "staging_buffer.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
 using namespace std;
@@ -53,6 +57,54 @@ struct Texture
     string path;
 };
 
+// one level of detail: a range of the index buffer over the shared vertices. error is how far
+// the surface may deviate from full detail, in model units (see mesh_simplify.h).
+// its meshlets are Mesh::meshlets[firstMeshlet, firstMeshlet + meshletCount)
+struct MeshLOD
+{
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error;
+    unsigned int firstMeshlet = 0;
+    unsigned int meshletCount = 0;
+};
+
+// up to MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles of one LOD's index
+// range, stored contiguously from firstIndex (see meshlet.h). the sphere and the normal cone
+// are in model space; coneCutoff is 1 when the triangles face too many ways to ever cull
+struct Meshlet
+{
+    unsigned int firstIndex;
+    unsigned int triangleCount;
+    unsigned int vertexCount;
+    float coneCutoff;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneAxis;
+    float padding;
+};
+
+// layout glDrawElementsIndirect and glMultiDrawElementsIndirect read
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    unsigned int baseVertex;
+    unsigned int baseInstance;
+};
+
+// 16-bit indices whenever every vertex is addressable with them: half the index memory and bandwidth
+inline GLenum IndexTypeFor(size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+inline size_t IndexSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
 class Mesh
 {
 public:
@@ -65,46 +117,92 @@ public:
     bool isGlass;
     bool isWater;
     aiString name;
-    unsigned int VAO;
+    // what the GPU buffers hold; vertices/indices may be left empty when the data was streamed
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    // lods[0] is full detail; indices holds every level's range back to back
+    vector<MeshLOD> lods;
+    int currentLod = 0;
+    // bounding sphere in model space, for LOD selection
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+    // clusters of every level, back to back (see MeshLOD); while drawVisibleMeshlets is set, Draw
+    // draws only visibleDraws, which MeshletCuller rewrites every frame for the current level
+    // and instance (and also uploads, with the model's other instances, to visibleDrawBuffer)
+    vector<Meshlet> meshlets;
+    bool drawVisibleMeshlets = false;
+    vector<DrawElementsIndirectCommand> visibleDraws;
+    unsigned int visibleDrawBuffer = 0;
+    size_t visibleDrawOffset = 0;
+    unsigned int VAO = 0;
+    // when set, Draw uses positions/normals written by the pre-skin pass (see skinning.h)
+    unsigned int skinnedVAO = 0;
+    unsigned int skinnedVBO = 0;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, Material mat, aiString name)
+    // constructor; upload = false keeps the data on the CPU only (house_bake has no GL context).
+    // without lods the whole index buffer is the only level
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, Material mat, aiString name,
+        vector<MeshLOD> lods = vector<MeshLOD>(), bool upload = true)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
         this->mat = mat;
         this->name = name;
-        bool condition1 = strcmp(name.C_Str(),"Lightbulb")==0;
-        bool condition2 = strcmp(name.C_Str(),"spotlight")==0;
-        bool condition3 = strcmp(name.C_Str(),"lampLight")==0;
-        bool condition4 = strcmp(name.C_Str(),"wallLight")==0;
-        bool condition5 = strcmp(name.C_Str(),"floorLight")==0;
-        if( strcmp(this->name.C_Str(),"light")==0 || condition1 || condition2 || condition3 || condition4 || condition5 )
-        {
-            // static int index = 1;
-            this->isBulb = true;
-            // std::cerr << index << std::endl; 
-            // ++index;
-        }
-        else this->isBulb = false;
+        this->vertexCount = (unsigned int)vertices.size();
+        this->indexCount = (unsigned int)indices.size();
+        this->lods = lods.empty() ? vector<MeshLOD>(1, MeshLOD{ 0, indexCount, 0.0f }) : lods;
+        computeBounds(this->vertices.data(), vertexCount);
+        classify();
 
-        if( strcmp(this->name.C_Str(),"glass")==0  ) this->isGlass = true;
-        else this->isGlass = false;
-
-        if( strcmp(this->name.C_Str(),"water")==0 ) this->isWater = true;
-        else this->isWater = false;
+        // now that we have all the required data, set the vertex buffers and its attribute pointers.
+        if (upload) setupMesh();
+    }
 
-        // std::cerr << textures.size() << std::endl;
+    // streamed from a mapped bundle: the arrays go through the staging ring into the buffers
+    // and are only kept on the CPU when keepVertices is set (the skinning passes read them)
+    // indexData holds indexCount indices of indexType, split into lods
+    Mesh(StagingRing &staging, const Vertex *vertexData, unsigned int vertexCount, const void *indexData, unsigned int indexCount,
+        GLenum indexType, vector<MeshLOD> lods, vector<Texture> textures, Material mat, aiString name, bool keepVertices = false)
+    {
+        if (keepVertices)
+        {
+            this->vertices.assign(vertexData, vertexData + vertexCount);
+            if (indexType == GL_UNSIGNED_SHORT)
+                this->indices.assign((const uint16_t *)indexData, (const uint16_t *)indexData + indexCount);
+            else
+                this->indices.assign((const unsigned int *)indexData, (const unsigned int *)indexData + indexCount);
+        }
+        this->textures = textures;
+        this->mat = mat;
+        this->name = name;
+        this->vertexCount = vertexCount;
+        this->indexCount = indexCount;
+        this->indexType = indexType;
+        this->lods = lods.empty() ? vector<MeshLOD>(1, MeshLOD{ 0, indexCount, 0.0f }) : lods;
+        computeBounds(vertexData, vertexCount);
+        classify();
 
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * IndexSize(indexType), NULL, GL_STATIC_DRAW);
+        setupAttributes();
+        glBindVertexArray(0);
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        staging.UploadBuffer(VBO, 0, vertexData, vertexCount * sizeof(Vertex));
+        staging.UploadBuffer(EBO, 0, indexData, indexCount * IndexSize(indexType));
     }
 
     // render the mesh
     void Draw(Shader &shader, bool isLighting, GLuint cubetex)
     {
+        if (drawVisibleMeshlets && visibleDraws.empty()) return;
         //enable gl blend
         if( isLighting && this->isGlass ) glEnable(GL_BLEND);
 
@@ -161,8 +259,14 @@ public:
             shader.setBool("isWater", isWater);
         }
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(skinnedVAO ? skinnedVAO : VAO);
+        if (drawVisibleMeshlets)
+            drawVisible();
+        else
+        {
+            const MeshLOD &lod = lods[currentLod];
+            glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(lod.indexCount), indexType, (void *)(lod.firstIndex * IndexSize(indexType)));
+        }
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
@@ -172,9 +276,122 @@ public:
         if( isLighting && this->isGlass ) glDisable(GL_BLEND);
     }
 
+    // allocates the transform feedback target for skinned position+normal and a VAO that
+    // reads them in place of the bind pose, with texture coords still coming from the mesh
+    void setupSkinnedBuffers()
+    {
+        if (skinnedVAO) return;
+        glGenVertexArrays(1, &skinnedVAO);
+        glGenBuffers(1, &skinnedVBO);
+
+        glBindVertexArray(skinnedVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, skinnedVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * 6 * sizeof(float), NULL, GL_DYNAMIC_COPY);
+        // skinned positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+        // skinned normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
+        // vertex texture coords
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBindVertexArray(0);
+    }
+
+    // frees the GPU buffers. Mesh is copied freely, so this is explicit and happens once, when
+    // the owning model is dropped while the GL context lives on (see world_stream.h)
+    void Release()
+    {
+        if (skinnedVAO) glDeleteVertexArrays(1, &skinnedVAO);
+        if (skinnedVBO) glDeleteBuffers(1, &skinnedVBO);
+        if (VAO) glDeleteVertexArrays(1, &VAO);
+        if (VBO) glDeleteBuffers(1, &VBO);
+        if (EBO) glDeleteBuffers(1, &EBO);
+        skinnedVAO = skinnedVBO = VAO = VBO = EBO = 0;
+    }
+
+    // picks the coarsest level whose error stays under threshold pixels, given the pixels per
+    // model unit at this mesh's distance. a level only changes once its error is hysteresis
+    // (a fraction of threshold) past the boundary, so meshes near a switch do not pop every frame;
+    // previous is the level picked last time. only reads the mesh, so it can run off the GL thread
+    int SelectLOD(float pixelsPerUnit, float threshold, float hysteresis, int previous) const
+    {
+        int lod = std::min(std::max(previous, 0), (int)lods.size() - 1);
+        while (lod + 1 < (int)lods.size() && lods[lod + 1].error * pixelsPerUnit <= threshold * (1.0f - hysteresis))
+            lod++;
+        while (lod > 0 && lods[lod].error * pixelsPerUnit > threshold * (1.0f + hysteresis))
+            lod--;
+        return lod;
+    }
+
 private:
     // render data
-    unsigned int VBO, EBO;
+    unsigned int VBO = 0, EBO = 0;
+    vector<GLsizei> drawCounts;
+    vector<const void *> drawOffsets;
+
+    // one call for every visible run of meshlets; without ARB_multi_draw_indirect the same
+    // ranges go through glMultiDrawElements from client memory
+    void drawVisible()
+    {
+        if (GLExt().multiDrawIndirect && visibleDrawBuffer)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, visibleDrawBuffer);
+            GLExt().MultiDrawElementsIndirect(GL_TRIANGLES, indexType, (const void *)visibleDrawOffset, (GLsizei)visibleDraws.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            return;
+        }
+        drawCounts.resize(visibleDraws.size());
+        drawOffsets.resize(visibleDraws.size());
+        for (size_t i = 0; i < visibleDraws.size(); i++)
+        {
+            drawCounts[i] = (GLsizei)visibleDraws[i].count;
+            drawOffsets[i] = (const void *)(visibleDraws[i].firstIndex * IndexSize(indexType));
+        }
+        glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(), (GLsizei)visibleDraws.size());
+    }
+
+    void computeBounds(const Vertex *data, unsigned int count)
+    {
+        if (!count) return;
+        glm::vec3 low = data[0].Position, high = data[0].Position;
+        for (unsigned int i = 1; i < count; i++)
+        {
+            low = glm::min(low, data[i].Position);
+            high = glm::max(high, data[i].Position);
+        }
+        boundsCenter = (low + high) * 0.5f;
+        boundsRadius = 0.0f;
+        for (unsigned int i = 0; i < count; i++)
+            boundsRadius = std::max(boundsRadius, glm::length(data[i].Position - boundsCenter));
+    }
+
+    // flags the shader needs, from the material name
+    void classify()
+    {
+        bool condition1 = strcmp(name.C_Str(),"Lightbulb")==0;
+        bool condition2 = strcmp(name.C_Str(),"spotlight")==0;
+        bool condition3 = strcmp(name.C_Str(),"lampLight")==0;
+        bool condition4 = strcmp(name.C_Str(),"wallLight")==0;
+        bool condition5 = strcmp(name.C_Str(),"floorLight")==0;
+        if( strcmp(this->name.C_Str(),"light")==0 || condition1 || condition2 || condition3 || condition4 || condition5 )
+        {
+            // static int index = 1;
+            this->isBulb = true;
+            // std::cerr << index << std::endl; 
+            // ++index;
+        }
+        else this->isBulb = false;
+
+        if( strcmp(this->name.C_Str(),"glass")==0  ) this->isGlass = true;
+        else this->isGlass = false;
+
+        if( strcmp(this->name.C_Str(),"water")==0 ) this->isWater = true;
+        else this->isWater = false;
+    }
 
     // initializes all the buffer objects/arrays
     void setupMesh()
@@ -193,8 +410,22 @@ private:
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        indexType = IndexTypeFor(vertices.size());
+        if (indexType == GL_UNSIGNED_SHORT)
+        {
+            vector<uint16_t> narrow(indices.begin(), indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW);
+        }
+        else
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+        setupAttributes();
+        glBindVertexArray(0);
+    }
 
+    // attribute layout of Vertex, for the bound VAO and GL_ARRAY_BUFFER
+    void setupAttributes()
+    {
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);
@@ -218,7 +449,6 @@ private:
         // weights
         glEnableVertexAttribArray(6);
         glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
     }
 };
 #endif
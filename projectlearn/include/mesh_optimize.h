@@ -0,0 +1,297 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "mesh.h"
+
+// load/bake time mesh optimization, in the order OptimizeMesh runs it:
+//   1. weld bitwise-identical vertices (assimp emits one vertex per face corner)
+//   2. reorder triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007)
+//   3. cut that order into clusters that each start well with a cold cache, and sort the
+//      clusters so outward-facing geometry on the outside of the mesh is drawn first (overdraw)
+//   4. renumber vertices in first-use order so vertex fetch walks memory forwards
+// all stages expect triangle lists.
+
+#define MESH_CACHE_SIZE 16
+
+struct MeshOptimizeStats
+{
+    unsigned int verticesBefore = 0;
+    unsigned int verticesAfter = 0;
+    unsigned int triangles = 0;
+    // average cache miss ratio: transformed vertices per triangle with a FIFO cache of MESH_CACHE_SIZE
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+    int clusters = 0;
+};
+
+inline float ComputeACMR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = MESH_CACHE_SIZE)
+{
+    if (indices.size() < 3) return 0.0f;
+    // FIFO: a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    unsigned int misses = 0;
+    for (unsigned int index : indices)
+        if (misses - loadedAt[index] >= cacheSize || loadedAt[index] == 0)
+            loadedAt[index] = ++misses;
+    return (float)misses / (float)(indices.size() / 3);
+}
+
+inline uint32_t HashVertexBytes(const Vertex &vertex)
+{
+    uint32_t words[sizeof(Vertex) / 4];
+    std::memcpy(words, &vertex, sizeof(words));
+    uint32_t hash = 2166136261u;
+    for (uint32_t word : words)
+    {
+        word *= 0xcc9e2d51u;
+        word = (word << 15) | (word >> 17);
+        hash = (hash ^ (word * 0x1b873593u)) * 16777619u;
+    }
+    return hash;
+}
+
+// merges vertices whose bytes are identical; returns the new vertex count
+inline size_t WeldVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    size_t tableSize = 1;
+    while (tableSize < vertices.size() * 2) tableSize *= 2;
+    std::vector<int> table(tableSize, -1);
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> unique;
+    unique.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        size_t slot = HashVertexBytes(vertices[i]) & (tableSize - 1);
+        while (table[slot] >= 0 && std::memcmp(&unique[table[slot]], &vertices[i], sizeof(Vertex)) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot] < 0)
+        {
+            table[slot] = (int)unique.size();
+            unique.push_back(vertices[i]);
+        }
+        remap[i] = (unsigned int)table[slot];
+    }
+    for (unsigned int &index : indices) index = remap[index];
+    vertices.swap(unique);
+    return vertices.size();
+}
+
+// Tipsify: fans around the most recently cached vertex that still has triangles left.
+// hardBoundaries receives the first triangle of every run that restarted from a vertex
+// outside the cache, where the cache is effectively cold anyway.
+inline void OptimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, std::vector<size_t> &hardBoundaries,
+    unsigned int cacheSize = MESH_CACHE_SIZE)
+{
+    size_t triangleCount = indices.size() / 3;
+    std::vector<unsigned int> live(vertexCount, 0), adjacencyStart(vertexCount + 1, 0), adjacency(indices.size());
+    for (unsigned int index : indices) live[index]++;
+    for (size_t v = 0; v < vertexCount; v++) adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+    {
+        std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    std::vector<unsigned int> cachedAt(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd, candidates, result;
+    result.reserve(indices.size());
+    unsigned int time = cacheSize + 1;
+    size_t cursor = 0;
+    hardBoundaries.assign(1, 0);
+
+    int fanning = vertexCount ? 0 : -1;
+    while (fanning >= 0)
+    {
+        candidates.clear();
+        for (unsigned int a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++)
+        {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = true;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cachedAt[v] > cacheSize) cachedAt[v] = time++;
+            }
+        }
+
+        // next fanning vertex: the candidate that stays cached longest while it is used up
+        int best = -1, bestPriority = -1;
+        for (unsigned int v : candidates)
+        {
+            if (!live[v]) continue;
+            int priority = 0;
+            if (time - cachedAt[v] + 2 * live[v] <= cacheSize) priority = (int)(time - cachedAt[v]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = (int)v;
+            }
+        }
+        if (best < 0)
+        {
+            while (!deadEnd.empty() && best < 0)
+            {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v]) best = (int)v;
+            }
+            if (best < 0)
+            {
+                while (cursor < vertexCount && !live[cursor]) cursor++;
+                if (cursor < vertexCount)
+                {
+                    best = (int)cursor;
+                    hardBoundaries.push_back(result.size() / 3);
+                }
+            }
+        }
+        fanning = best;
+    }
+    indices.swap(result);
+}
+
+// splits each hard cluster where a cold start costs little (the cluster so far is within
+// threshold of the cache optimized miss ratio), then orders the clusters outside-in
+inline int OptimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices,
+    const std::vector<size_t> &hardBoundaries, float threshold = 1.05f, unsigned int cacheSize = MESH_CACHE_SIZE)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) return 1;
+
+    std::vector<size_t> boundaries;
+    std::vector<unsigned int> loadedAt(vertices.size(), 0);
+    for (size_t h = 0; h < hardBoundaries.size(); h++)
+    {
+        size_t begin = hardBoundaries[h];
+        size_t end = h + 1 < hardBoundaries.size() ? hardBoundaries[h + 1] : triangleCount;
+        std::vector<unsigned int> span(indices.begin() + begin * 3, indices.begin() + end * 3);
+        float target = ComputeACMR(span, vertices.size(), cacheSize) * threshold;
+
+        // restart a cold cache simulation at each soft boundary
+        unsigned int misses = 0, clusterMisses = 0;
+        size_t clusterStart = begin;
+        boundaries.push_back(begin);
+        for (size_t t = begin; t < end; t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[t * 3 + k];
+                if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize || loadedAt[v] <= misses - clusterMisses)
+                {
+                    loadedAt[v] = ++misses;
+                    clusterMisses++;
+                }
+            }
+            if (t + 1 < end && (float)clusterMisses / (float)(t + 1 - clusterStart) <= target)
+            {
+                boundaries.push_back(t + 1);
+                clusterStart = t + 1;
+                clusterMisses = 0;
+            }
+        }
+    }
+
+    // mesh centroid, then per cluster: centroid and area-weighted normal
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    std::vector<float> sortKey(boundaries.size());
+    std::vector<glm::vec3> clusterCenter(boundaries.size(), glm::vec3(0.0f)), clusterNormal(boundaries.size(), glm::vec3(0.0f));
+    std::vector<float> clusterArea(boundaries.size(), 0.0f);
+    for (size_t c = 0; c < boundaries.size(); c++)
+    {
+        size_t end = c + 1 < boundaries.size() ? boundaries[c + 1] : triangleCount;
+        for (size_t t = boundaries[c]; t < end; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3 + 0]].Position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            clusterCenter[c] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormal[c] += normal;
+            clusterArea[c] += area;
+        }
+        meshCenter += clusterCenter[c];
+        meshArea += clusterArea[c];
+    }
+    if (meshArea > 0.0f) meshCenter /= meshArea;
+    for (size_t c = 0; c < boundaries.size(); c++)
+    {
+        glm::vec3 center = clusterArea[c] > 0.0f ? clusterCenter[c] / clusterArea[c] : meshCenter;
+        float length = glm::length(clusterNormal[c]);
+        sortKey[c] = length > 0.0f ? glm::dot(center - meshCenter, clusterNormal[c] / length) : 0.0f;
+    }
+
+    std::vector<size_t> order(boundaries.size());
+    for (size_t c = 0; c < order.size(); c++) order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+    {
+        size_t end = c + 1 < boundaries.size() ? boundaries[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + boundaries[c] * 3, indices.begin() + end * 3);
+    }
+    indices.swap(result);
+    return (int)boundaries.size();
+}
+
+// renumbers vertices in the order the index buffer first touches them; drops unused ones
+inline void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = (unsigned int)ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+inline MeshOptimizeStats OptimizeMesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    MeshOptimizeStats stats;
+    stats.verticesBefore = (unsigned int)vertices.size();
+    stats.triangles = (unsigned int)(indices.size() / 3);
+    stats.acmrBefore = ComputeACMR(indices, vertices.size());
+    if (indices.size() % 3 != 0 || indices.empty())
+    {
+        // points or lines: leave them alone
+        stats.verticesAfter = stats.verticesBefore;
+        stats.acmrAfter = stats.acmrBefore;
+        return stats;
+    }
+
+    WeldVertices(vertices, indices);
+    std::vector<size_t> hardBoundaries;
+    OptimizeVertexCache(indices, vertices.size(), hardBoundaries);
+    stats.clusters = OptimizeOverdraw(indices, vertices, hardBoundaries);
+    OptimizeVertexFetch(vertices, indices);
+
+    stats.verticesAfter = (unsigned int)vertices.size();
+    stats.acmrAfter = ComputeACMR(indices, vertices.size());
+    return stats;
+}
+
+#endif
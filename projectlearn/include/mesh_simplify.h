@@ -0,0 +1,350 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "job_system.h"
+#include "mesh.h"
+#include "mesh_optimize.h"
+
+// quadric error metric simplification (Garland & Heckbert) that collapses a vertex onto one of
+// its neighbours instead of computing new positions, so every LOD indexes the original vertex
+// buffer. a vertex split in two by a texture seam slides along the seam together with its twin,
+// border vertices only slide along the border, corners stay put, and a collapse is refused when
+// it would flip a triangle.
+
+#define MESH_MAX_LODS 4
+// smaller meshes get no coarser levels; they cost less to draw than to switch
+#define MESH_LOD_MIN_TRIANGLES 64
+
+struct Quadric
+{
+    // symmetric 4x4 as a2 ab ac ad b2 bc bd c2 cd d2, plus the total weight of its planes
+    double q[10] = {};
+    double weight = 0.0;
+
+    void AddPlane(const glm::vec3 &n, float d, double w)
+    {
+        double a = n.x, b = n.y, c = n.z, e = d;
+        q[0] += w * a * a; q[1] += w * a * b; q[2] += w * a * c; q[3] += w * a * e;
+        q[4] += w * b * b; q[5] += w * b * c; q[6] += w * b * e;
+        q[7] += w * c * c; q[8] += w * c * e;
+        q[9] += w * e * e;
+        weight += w;
+    }
+
+    void Add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; i++) q[i] += other.q[i];
+        weight += other.weight;
+    }
+
+    // weighted mean squared distance of p to the planes
+    float Error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double e = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                 + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                 + q[7] * z * z + 2 * q[8] * z
+                 + q[9];
+        return weight > 0.0 ? (float)std::max(0.0, e / weight) : 0.0f;
+    }
+};
+
+// returns a triangle list over the same vertices with at most targetIndexCount indices where the
+// surface allows it; error receives the geometric deviation reached, in model units
+inline std::vector<unsigned int> SimplifyIndices(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+    size_t targetIndexCount, float &error)
+{
+    enum Kind : uint8_t { Manifold, Border, Seam, Locked };
+    size_t vertexCount = vertices.size();
+    error = 0.0f;
+
+    // vertices sharing a position (texture or normal seams) form one group
+    std::vector<unsigned int> group(vertexCount), twin(vertexCount);
+    std::vector<uint8_t> groupSize(vertexCount, 0);
+    {
+        struct Key
+        {
+            float p[3];
+            bool operator==(const Key &o) const { return std::memcmp(p, o.p, sizeof(p)) == 0; }
+        };
+        struct KeyHash
+        {
+            size_t operator()(const Key &k) const
+            {
+                uint32_t w[3];
+                std::memcpy(w, k.p, sizeof(w));
+                return (w[0] * 73856093u) ^ (w[1] * 19349663u) ^ (w[2] * 83492791u);
+            }
+        };
+        std::unordered_map<Key, unsigned int, KeyHash> first;
+        first.reserve(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            Key key = { { vertices[v].Position.x, vertices[v].Position.y, vertices[v].Position.z } };
+            unsigned int g = first.insert({ key, (unsigned int)v }).first->second;
+            group[v] = g;
+            if (groupSize[g] < 255) groupSize[g]++;
+            // the other vertex of a two-vertex group, which is what a seam usually splits into
+            twin[v] = g;
+            twin[g] = (unsigned int)v;
+        }
+    }
+
+    // open edges, counted between position groups so seams are not mistaken for borders; an edge
+    // open between vertices but closed between groups runs along a seam. rebuilt for every pass,
+    // as collapses along borders and seams make new open edges
+    std::unordered_set<uint64_t> groupEdges, vertexEdges;
+    auto groupKey = [&](unsigned int a, unsigned int b) { return (uint64_t)group[a] << 32 | group[b]; };
+    auto vertexKey = [](unsigned int a, unsigned int b) { return (uint64_t)a << 32 | b; };
+    auto buildEdges = [&](const std::vector<unsigned int> &list)
+    {
+        groupEdges.clear();
+        vertexEdges.clear();
+        for (size_t i = 0; i < list.size(); i += 3)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = list[i + k], b = list[i + (k + 1) % 3];
+                groupEdges.insert(groupKey(a, b));
+                vertexEdges.insert(vertexKey(a, b));
+            }
+    };
+    auto isBorderEdge = [&](unsigned int a, unsigned int b)
+    {
+        return groupEdges.count(groupKey(b, a)) == 0 && groupEdges.count(groupKey(a, b)) != 0;
+    };
+    // either direction
+    auto isSeamEdge = [&](unsigned int a, unsigned int b)
+    {
+        bool ab = vertexEdges.count(vertexKey(a, b)) != 0, ba = vertexEdges.count(vertexKey(b, a)) != 0;
+        return ab != ba && groupEdges.count(groupKey(a, b)) != 0 && groupEdges.count(groupKey(b, a)) != 0;
+    };
+    buildEdges(indices);
+
+    std::vector<uint8_t> kind(vertexCount, Manifold);
+    std::vector<uint8_t> borderEdges(vertexCount, 0), seamEdges(vertexCount, 0);
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::vec3 &p0 = vertices[indices[i + 0]].Position;
+        const glm::vec3 &p1 = vertices[indices[i + 1]].Position;
+        const glm::vec3 &p2 = vertices[indices[i + 2]].Position;
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if (area <= 0.0f) continue;
+        normal = normal / area;
+        for (int k = 0; k < 3; k++)
+            quadrics[group[indices[i + k]]].AddPlane(normal, -glm::dot(normal, p0), area);
+
+        // a plane through each open edge, perpendicular to the face, keeps the outline in place
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+            if (!isBorderEdge(a, b)) continue;
+            glm::vec3 edge = vertices[b].Position - vertices[a].Position;
+            float length = glm::length(edge);
+            if (length <= 0.0f) continue;
+            glm::vec3 side = glm::cross(edge / length, normal);
+            double weight = 10.0 * length * length;
+            quadrics[group[a]].AddPlane(side, -glm::dot(side, vertices[a].Position), weight);
+            quadrics[group[b]].AddPlane(side, -glm::dot(side, vertices[b].Position), weight);
+            if (borderEdges[a] < 255) borderEdges[a]++;
+            if (borderEdges[b] < 255) borderEdges[b]++;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+            if (!isSeamEdge(a, b)) continue;
+            if (seamEdges[a] < 255) seamEdges[a]++;
+            if (seamEdges[b] < 255) seamEdges[b]++;
+        }
+    }
+    // a seam vertex is one of exactly two at its position, both in the middle of the seam (one
+    // seam edge in, one out, no border); where seams end, meet or touch a border it is a corner
+    auto onSeam = [&](unsigned int v) { return seamEdges[v] == 2 && borderEdges[v] == 0; };
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        if (groupSize[group[v]] == 2 && onSeam((unsigned int)v) && onSeam(twin[v])) kind[v] = Seam;
+        else if (groupSize[group[v]] > 1) kind[v] = Locked;
+        else if (borderEdges[v] == 2) kind[v] = Border;
+        else if (borderEdges[v] != 0) kind[v] = Locked;
+    }
+
+    std::vector<unsigned int> result = indices;
+    struct Collapse
+    {
+        unsigned int from, to;
+        float cost;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> collapseTo(vertexCount), triangleStart(vertexCount + 1), triangles;
+    std::vector<bool> touched(vertexCount);
+
+    // the vertex at position group g adjacent to v in the current result, or vertexCount
+    auto neighbourIn = [&](unsigned int v, unsigned int g)
+    {
+        for (unsigned int a = triangleStart[v]; a < triangleStart[v + 1]; a++)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int u = result[triangles[a] * 3 + k];
+                if (u != v && group[u] == g) return u;
+            }
+        return (unsigned int)vertexCount;
+    };
+    // whether moving from onto to turns a surviving triangle over; removed counts the ones it deletes
+    auto flips = [&](unsigned int from, unsigned int to, int &removed)
+    {
+        for (unsigned int a = triangleStart[from]; a < triangleStart[from + 1]; a++)
+        {
+            const unsigned int *t = &result[triangles[a] * 3];
+            if (group[t[0]] == group[to] || group[t[1]] == group[to] || group[t[2]] == group[to])
+            {
+                removed++;
+                continue;
+            }
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; k++)
+            {
+                p[k] = vertices[t[k]].Position;
+                q[k] = t[k] == from ? vertices[to].Position : p[k];
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            if (glm::dot(before, after) <= 0.0f) return true;
+        }
+        return false;
+    };
+
+    bool firstPass = true;
+    while (result.size() > targetIndexCount)
+    {
+        if (!firstPass) buildEdges(result);
+        firstPass = false;
+
+        // vertex -> triangles of the current result
+        std::fill(triangleStart.begin(), triangleStart.end(), 0);
+        for (unsigned int index : result) triangleStart[index + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) triangleStart[v + 1] += triangleStart[v];
+        triangles.resize(result.size());
+        {
+            std::vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) triangles[fill[result[i]]++] = (unsigned int)(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int from = result[i + k], to = result[i + (k + 1) % 3];
+                for (int direction = 0; direction < 2; direction++, std::swap(from, to))
+                {
+                    if (kind[from] == Locked) continue;
+                    if (kind[from] == Border && !isBorderEdge(from, to) && !isBorderEdge(to, from)) continue;
+                    if (kind[from] == Seam && !isSeamEdge(from, to)) continue;
+                    collapses.push_back({ from, to, quadrics[group[from]].Error(vertices[to].Position) });
+                }
+            }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        // cheapest first; a collapse freezes the ring around it for the rest of the pass, so
+        // the flip test below always sees final positions
+        for (size_t v = 0; v < vertexCount; v++) collapseTo[v] = (unsigned int)v;
+        std::fill(touched.begin(), touched.end(), false);
+        size_t trianglesLeft = result.size() / 3, targetTriangles = targetIndexCount / 3;
+        int applied = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (trianglesLeft <= targetTriangles) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            // a seam vertex takes its twin along, onto the target's vertex on the twin's side
+            unsigned int twinFrom = (unsigned int)vertexCount, twinTo = (unsigned int)vertexCount;
+            if (kind[collapse.from] == Seam)
+            {
+                twinFrom = twin[collapse.from];
+                twinTo = neighbourIn(twinFrom, group[collapse.to]);
+                if (twinTo == vertexCount || touched[twinFrom] || touched[twinTo] || !isSeamEdge(twinFrom, twinTo)) continue;
+            }
+
+            int removed = 0;
+            if (flips(collapse.from, collapse.to, removed)) continue;
+            if (twinFrom != vertexCount && flips(twinFrom, twinTo, removed)) continue;
+
+            for (unsigned int from : { collapse.from, twinFrom })
+            {
+                if (from == vertexCount) continue;
+                collapseTo[from] = from == collapse.from ? collapse.to : twinTo;
+                for (unsigned int a = triangleStart[from]; a < triangleStart[from + 1]; a++)
+                    for (int k = 0; k < 3; k++) touched[result[triangles[a] * 3 + k]] = true;
+            }
+            quadrics[group[collapse.to]].Add(quadrics[group[collapse.from]]);
+            error = std::max(error, collapse.cost);
+            trianglesLeft -= removed;
+            applied++;
+        }
+        if (!applied) break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = collapseTo[result[i]], b = collapseTo[result[i + 1]], c = collapseTo[result[i + 2]];
+            if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c]) continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    error = std::sqrt(error);
+    return result;
+}
+
+// appends up to MESH_MAX_LODS - 1 coarser index ranges (1/2, 1/4, 1/8 of the triangles) after the
+// full detail ones; stops early once a level no longer saves enough to be worth drawing. every
+// level is simplified from the full detail triangles, so they are built as parallel jobs and
+// the cutoff is applied afterwards, in level order
+inline std::vector<MeshLOD> GenerateLODs(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    std::vector<MeshLOD> lods;
+    lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+    if (indices.size() % 3 != 0 || indices.size() < 3 * MESH_LOD_MIN_TRIANGLES) return lods;
+
+    const std::vector<unsigned int> source = indices;
+    std::vector<std::vector<unsigned int>> levels(MESH_MAX_LODS - 1);
+    std::vector<float> errors(MESH_MAX_LODS - 1, 0.0f);
+    Jobs().ParallelFor(levels.size(), 1, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            size_t target = source.size() / 3 >> (i + 1);
+            levels[i] = SimplifyIndices(vertices, source, target * 3, errors[i]);
+            std::vector<size_t> boundaries;
+            if (!levels[i].empty()) OptimizeVertexCache(levels[i], vertices.size(), boundaries);
+        }
+    });
+
+    size_t previous = indices.size();
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        const std::vector<unsigned int> &lod = levels[i];
+        if (lod.empty() || lod.size() > previous * 85 / 100) break;
+        // errors only grow with the level, which the selection relies on
+        float error = std::max(errors[i], lods.back().error);
+        lods.push_back({ (unsigned int)indices.size(), (unsigned int)lod.size(), error });
+        indices.insert(indices.end(), lod.begin(), lod.end());
+        previous = lod.size();
+    }
+    return lods;
+}
+
+#endif
@@ -0,0 +1,561 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gl_extensions.h"
+#include "job_system.h"
+#include "mesh.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHLET_SSE 1
+#include <emmintrin.h>
+#endif
+
+// meshlets: each LOD's index range cut into small clusters that are culled on their own.
+// the builder packs triangles in index buffer order, which OptimizeMesh already made local
+// (vertex cache fans, then overdraw clusters), so each meshlet is a contiguous index range and
+// the visible ones are drawn straight out of the existing element buffer. the culler rejects
+// clusters outside the frustum or facing away from the camera, four at a time with SSE2, and
+// the meshes of a model on the job system.
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+inline void FinishMeshlet(Meshlet &meshlet, const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+{
+    const unsigned int *begin = &indices[meshlet.firstIndex];
+    size_t count = meshlet.triangleCount * 3;
+
+    glm::vec3 low = vertices[begin[0]].Position, high = low;
+    for (size_t i = 1; i < count; i++)
+    {
+        low = glm::min(low, vertices[begin[i]].Position);
+        high = glm::max(high, vertices[begin[i]].Position);
+    }
+    meshlet.center = (low + high) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (size_t i = 0; i < count; i++)
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertices[begin[i]].Position - meshlet.center));
+
+    // the cone axis averages the face normals; its cutoff is the sine of the widest angle any
+    // face makes with it, or 1 (never culled) once some face is 90 degrees or more away
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangleCount);
+    glm::vec3 sum(0.0f);
+    for (size_t i = 0; i < count; i += 3)
+    {
+        const glm::vec3 &p0 = vertices[begin[i + 0]].Position;
+        glm::vec3 normal = glm::cross(vertices[begin[i + 1]].Position - p0, vertices[begin[i + 2]].Position - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f) continue;
+        normals.push_back(normal / length);
+        sum += normals.back();
+    }
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    float sumLength = glm::length(sum);
+    if (normals.empty() || sumLength < 1e-6f) return;
+    meshlet.coneAxis = sum / sumLength;
+    float minDot = 1.0f;
+    for (const glm::vec3 &normal : normals) minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+    if (minDot > 0.0f) meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// clusters indexCount indices (a triangle list) from firstIndex on, in order
+inline std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+    unsigned int firstIndex, unsigned int indexCount)
+{
+    std::vector<Meshlet> meshlets;
+    if (indexCount < 3 || indexCount % 3 != 0) return meshlets;
+
+    // a vertex belongs to the open meshlet when its stamp is the meshlet's number
+    std::vector<unsigned int> stamp(vertices.size(), ~0u);
+    Meshlet current = {};
+    current.firstIndex = firstIndex;
+    unsigned int number = 0;
+    for (unsigned int i = firstIndex; i < firstIndex + indexCount; i += 3)
+    {
+        unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        unsigned int added = (stamp[a] != number) + (stamp[b] != number && b != a) + (stamp[c] != number && c != a && c != b);
+        if (current.triangleCount == MESHLET_MAX_TRIANGLES || current.vertexCount + added > MESHLET_MAX_VERTICES)
+        {
+            FinishMeshlet(current, vertices, indices);
+            meshlets.push_back(current);
+            current = {};
+            current.firstIndex = i;
+            number++;
+        }
+        for (int k = 0; k < 3; k++)
+            if (stamp[indices[i + k]] != number)
+            {
+                stamp[indices[i + k]] = number;
+                current.vertexCount++;
+            }
+        current.triangleCount++;
+    }
+    FinishMeshlet(current, vertices, indices);
+    meshlets.push_back(current);
+    return meshlets;
+}
+
+// the meshlets of every level back to back, each level's range recorded in its MeshLOD, so the
+// coarse levels of distant meshes are culled the same way as full detail
+inline std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, std::vector<MeshLOD> &lods)
+{
+    // the levels' ranges don't overlap, one job each
+    std::vector<std::vector<Meshlet>> levels(lods.size());
+    Jobs().ParallelFor(lods.size(), 1, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++) levels[i] = BuildMeshlets(vertices, indices, lods[i].firstIndex, lods[i].indexCount);
+    });
+    std::vector<Meshlet> meshlets;
+    for (size_t i = 0; i < lods.size(); i++)
+    {
+        lods[i].firstMeshlet = (unsigned int)meshlets.size();
+        lods[i].meshletCount = (unsigned int)levels[i].size();
+        meshlets.insert(meshlets.end(), levels[i].begin(), levels[i].end());
+    }
+    return meshlets;
+}
+
+class MeshletCuller
+{
+public:
+    struct Stats
+    {
+        int meshlets = 0;
+        int meshletsVisible = 0;
+        int frustumCulled = 0;
+        int backfaceCulled = 0;
+        // triangles the meshes would have drawn at their current LOD, and what is left after culling
+        unsigned int trianglesSubmitted = 0;
+        unsigned int trianglesVisible = 0;
+        int draws = 0;
+        float cullMs = 0.0f;
+
+        void Add(const Stats &other)
+        {
+            meshlets += other.meshlets;
+            meshletsVisible += other.meshletsVisible;
+            frustumCulled += other.frustumCulled;
+            backfaceCulled += other.backfaceCulled;
+            trianglesSubmitted += other.trianglesSubmitted;
+            trianglesVisible += other.trianglesVisible;
+            draws += other.draws;
+            cullMs += other.cullMs;
+        }
+    };
+
+#ifdef MESHLET_SSE
+    explicit MeshletCuller(bool simd = true) : simd(simd) {}
+#else
+    explicit MeshletCuller(bool simd = false) : simd(false) { (void)simd; }
+#endif
+
+    // the normal cone test assumes single-sided geometry; turn it off for meshes that are
+    // drawn without GL_CULL_FACE and seen from both sides
+    bool coneCulling = true;
+
+    MeshletCuller(const MeshletCuller &) = delete;
+    MeshletCuller &operator=(const MeshletCuller &) = delete;
+
+    ~MeshletCuller()
+    {
+        if (buffer) glDeleteBuffers(1, &buffer);
+    }
+
+    // the instances of a model drawn in one frame share one indirect buffer upload: BeginFrame,
+    // Cull every instance, Upload, then Apply each instance's draws right before drawing it
+    void BeginFrame()
+    {
+        commands.clear();
+        instances.clear();
+    }
+
+    // rewrites every mesh's visibleDraws for one instance and switches the meshes to draw them,
+    // appending the commands to the frame's. model must be rigid with uniform scale (the spheres
+    // and cones are tested in model space). no GL calls, the indirect buffer waits for Upload
+    const Stats &Cull(std::vector<Mesh> &meshes, const glm::mat4 &model, const glm::mat4 &viewProjection,
+        const glm::vec3 &cameraPosition)
+    {
+        auto start = std::chrono::steady_clock::now();
+        // a mesh whose meshlets were replaced since the last call (new storage or a new count) gets
+        // its bounds rebuilt, not only a model whose mesh count changed
+        if (bounds.size() != meshes.size()) bounds.resize(meshes.size());
+        for (size_t m = 0; m < meshes.size(); m++)
+            if (bounds[m].source != meshes[m].meshlets.data() || bounds[m].count != meshes[m].meshlets.size())
+                prepare(meshes[m], bounds[m]);
+        stats = Stats();
+
+        // frustum planes of viewProjection * model are already in model space (Gribb & Hartmann)
+        glm::mat4 clip = viewProjection * model;
+        for (int p = 0; p < 6; p++)
+        {
+            int row = p / 2;
+            float sign = p % 2 ? -1.0f : 1.0f;
+            glm::vec4 plane;
+            for (int c = 0; c < 4; c++) plane[c] = clip[c][3] + sign * clip[c][row];
+            float length = glm::length(glm::vec3(plane));
+            planes[p] = length > 0.0f ? plane / length : plane;
+        }
+        glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+        // every mesh writes only its own visibleDraws and results, so meshes are culled in any
+        // order on any thread; the commands are gathered in mesh order afterwards
+        if (results.size() != meshes.size()) results.resize(meshes.size());
+        Jobs().ParallelFor(meshes.size(), 4, [&](size_t first, size_t last)
+        {
+            for (size_t m = first; m < last; m++) cullMesh(meshes[m], m, camera);
+        });
+
+        lastCulled = results.size();
+        for (size_t m = 0; m < meshes.size(); m++)
+        {
+            Mesh &mesh = meshes[m];
+            stats.Add(results[m].stats);
+            if (results[m].tested) lastCulled = m;
+            mesh.visibleDrawOffset = commands.size() * sizeof(DrawElementsIndirectCommand);
+            mesh.visibleDrawBuffer = 0;
+            instances.push_back({ mesh.drawVisibleMeshlets, commands.size(), mesh.visibleDraws.size() });
+            commands.insert(commands.end(), mesh.visibleDraws.begin(), mesh.visibleDraws.end());
+        }
+
+        stats.cullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+
+    // every command culled since BeginFrame in one go, orphaning last frame's storage so the
+    // driver hands out fresh memory while that frame still draws
+    void Upload()
+    {
+        if (!GLExt().multiDrawIndirect || commands.empty()) return;
+        if (!buffer) glGenBuffers(1, &buffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // points the meshes at what Cull found for the instance-th call since BeginFrame
+    void Apply(size_t instance, std::vector<Mesh> &meshes)
+    {
+        for (size_t m = 0; m < meshes.size(); m++)
+        {
+            const MeshDraws &draws = instances[instance * meshes.size() + m];
+            Mesh &mesh = meshes[m];
+            mesh.drawVisibleMeshlets = draws.meshlets;
+            mesh.visibleDraws.assign(commands.begin() + draws.first, commands.begin() + draws.first + draws.count);
+            mesh.visibleDrawOffset = draws.first * sizeof(DrawElementsIndirectCommand);
+            mesh.visibleDrawBuffer = GLExt().multiDrawIndirect ? buffer : 0;
+        }
+    }
+
+    // back to drawing whole meshes
+    void Disable(std::vector<Mesh> &meshes)
+    {
+        for (Mesh &mesh : meshes) mesh.drawVisibleMeshlets = false;
+    }
+
+    bool UsesSIMD() const { return simd; }
+    const Stats &GetStats() const { return stats; }
+    // per meshlet of the last culled mesh, for comparing the scalar and SIMD paths
+    const std::vector<uint8_t> &GetVisible() const
+    {
+        static const std::vector<uint8_t> none;
+        return lastCulled < results.size() ? results[lastCulled].visible : none;
+    }
+
+private:
+    // meshlet spheres and cones in separate arrays, padded with 3 entries that every plane rejects
+    // so a 4-wide load from any meshlet, where a level's range starts anywhere, stays inside
+    struct MeshletBounds
+    {
+        const Meshlet *source = nullptr;
+        size_t count = 0;
+        std::vector<float> x, y, z, radius, axisX, axisY, axisZ, cutoff;
+    };
+
+    // what culling one mesh found, kept per mesh so the meshes can be culled in parallel
+    struct MeshResult
+    {
+        std::vector<uint8_t> visible;
+        Stats stats;
+        bool tested = false; // its meshlets were tested, not skipped with the whole mesh
+    };
+
+    bool simd;
+    std::vector<MeshletBounds> bounds;
+    glm::vec4 planes[6];
+    std::vector<MeshResult> results;
+    size_t lastCulled = 0;
+    // one mesh of one culled instance: whether it draws meshlets, and its commands
+    struct MeshDraws
+    {
+        bool meshlets;
+        size_t first, count;
+    };
+
+    std::vector<DrawElementsIndirectCommand> commands; // every instance's since BeginFrame
+    std::vector<MeshDraws> instances;                  // per instance, per mesh
+    GLuint buffer = 0;
+    Stats stats;
+
+    void prepare(const Mesh &mesh, MeshletBounds &soa)
+    {
+        soa.source = mesh.meshlets.data();
+        soa.count = mesh.meshlets.size();
+        size_t padded = soa.count + 3;
+        for (std::vector<float> *array : { &soa.x, &soa.y, &soa.z, &soa.axisX, &soa.axisY, &soa.axisZ, &soa.cutoff })
+            array->assign(padded, 0.0f);
+        soa.radius.assign(padded, -1e30f);
+        for (size_t i = 0; i < soa.count; i++)
+        {
+            const Meshlet &meshlet = mesh.meshlets[i];
+            soa.x[i] = meshlet.center.x;
+            soa.y[i] = meshlet.center.y;
+            soa.z[i] = meshlet.center.z;
+            soa.radius[i] = meshlet.radius;
+            soa.axisX[i] = meshlet.coneAxis.x;
+            soa.axisY[i] = meshlet.coneAxis.y;
+            soa.axisZ[i] = meshlet.coneAxis.z;
+            soa.cutoff[i] = meshlet.coneCutoff;
+        }
+    }
+
+    void cullMesh(Mesh &mesh, size_t m, const glm::vec3 &camera)
+    {
+        MeshResult &result = results[m];
+        Stats &meshStats = result.stats;
+        meshStats = Stats();
+        result.tested = false;
+        const MeshLOD &lod = mesh.lods[mesh.currentLod];
+        meshStats.trianglesSubmitted = lod.indexCount / 3;
+        mesh.visibleDraws.clear();
+        // meshes loaded without per-level meshlets still cull at full detail only
+        mesh.drawVisibleMeshlets = lod.meshletCount != 0 && lod.firstMeshlet + lod.meshletCount <= mesh.meshlets.size();
+        if (!mesh.drawVisibleMeshlets)
+        {
+            meshStats.trianglesVisible = lod.indexCount / 3;
+            return;
+        }
+        meshStats.meshlets = (int)lod.meshletCount;
+
+        // whole mesh first: most of the house is either entirely in view or entirely out
+        if (!sphereInFrustum(mesh.boundsCenter, mesh.boundsRadius))
+        {
+            meshStats.frustumCulled = (int)lod.meshletCount;
+            return;
+        }
+
+        const MeshletBounds &soa = bounds[m];
+        size_t first = lod.firstMeshlet, last = first + lod.meshletCount;
+        std::vector<uint8_t> &visible = result.visible;
+        visible.resize(lod.meshletCount);
+        result.tested = true;
+#ifdef MESHLET_SSE
+        if (simd) cullSSE(soa, first, last, camera, visible.data(), meshStats);
+        else
+#endif
+            cullScalar(soa, first, last, camera, visible.data(), meshStats);
+
+        // neighbouring meshlets are neighbouring index ranges: merge visible runs into one draw
+        for (size_t i = 0; i < lod.meshletCount; i++)
+        {
+            if (!visible[i]) continue;
+            const Meshlet &meshlet = mesh.meshlets[first + i];
+            meshStats.meshletsVisible++;
+            meshStats.trianglesVisible += meshlet.triangleCount;
+            if (!mesh.visibleDraws.empty() && i > 0 && visible[i - 1])
+                mesh.visibleDraws.back().count += meshlet.triangleCount * 3;
+            else
+                mesh.visibleDraws.push_back({ meshlet.triangleCount * 3, 1, meshlet.firstIndex, 0, 0 });
+        }
+        meshStats.draws = (int)mesh.visibleDraws.size();
+    }
+
+    bool sphereInFrustum(const glm::vec3 &center, float radius) const
+    {
+        for (const glm::vec4 &plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+        return true;
+    }
+
+    // backfacing when the whole sphere sees only the back of the cone:
+    // dot(center - camera, axis) >= cutoff * |center - camera| + radius.
+    // tests meshlets [first, last); visible[0] is meshlet first
+    void cullScalar(const MeshletBounds &soa, size_t first, size_t last, const glm::vec3 &camera, uint8_t *visible, Stats &stats) const
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            glm::vec3 center(soa.x[i], soa.y[i], soa.z[i]);
+            if (!sphereInFrustum(center, soa.radius[i]))
+            {
+                visible[i - first] = 0;
+                stats.frustumCulled++;
+                continue;
+            }
+            glm::vec3 toCenter = center - camera;
+            float along = glm::dot(toCenter, glm::vec3(soa.axisX[i], soa.axisY[i], soa.axisZ[i]));
+            bool backfacing = coneCulling && along >= soa.cutoff[i] * glm::length(toCenter) + soa.radius[i];
+            visible[i - first] = !backfacing;
+            if (backfacing) stats.backfaceCulled++;
+        }
+    }
+
+#ifdef MESHLET_SSE
+    void cullSSE(const MeshletBounds &soa, size_t first, size_t last, const glm::vec3 &camera, uint8_t *visible, Stats &stats) const
+    {
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++)
+        {
+            planeX[p] = _mm_set1_ps(planes[p].x);
+            planeY[p] = _mm_set1_ps(planes[p].y);
+            planeZ[p] = _mm_set1_ps(planes[p].z);
+            planeW[p] = _mm_set1_ps(planes[p].w);
+        }
+        __m128 cameraX = _mm_set1_ps(camera.x), cameraY = _mm_set1_ps(camera.y), cameraZ = _mm_set1_ps(camera.z);
+        __m128 zero = _mm_setzero_ps();
+
+        for (size_t i = first; i < last; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(&soa.x[i]), y = _mm_loadu_ps(&soa.y[i]), z = _mm_loadu_ps(&soa.z[i]);
+            __m128 radius = _mm_loadu_ps(&soa.radius[i]);
+            __m128 negativeRadius = _mm_sub_ps(zero, radius);
+
+            __m128 outside = zero;
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                    _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+            }
+
+            __m128 dx = _mm_sub_ps(x, cameraX), dy = _mm_sub_ps(y, cameraY), dz = _mm_sub_ps(z, cameraZ);
+            __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&soa.axisX[i])), _mm_mul_ps(dy, _mm_loadu_ps(&soa.axisY[i]))),
+                _mm_mul_ps(dz, _mm_loadu_ps(&soa.axisZ[i])));
+            __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            __m128 backfacing = _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&soa.cutoff[i]), distance), radius));
+            // frustum rejection wins, the same as the scalar path
+            backfacing = coneCulling ? _mm_andnot_ps(outside, backfacing) : zero;
+
+            int outsideMask = _mm_movemask_ps(outside), backfacingMask = _mm_movemask_ps(backfacing);
+            size_t lanes = std::min<size_t>(4, last - i);
+            for (size_t lane = 0; lane < lanes; lane++)
+            {
+                bool isOutside = (outsideMask >> lane) & 1, isBackfacing = (backfacingMask >> lane) & 1;
+                visible[i - first + lane] = !isOutside && !isBackfacing;
+                stats.frustumCulled += isOutside;
+                stats.backfaceCulled += isBackfacing;
+            }
+        }
+    }
+#endif
+};
+
+// --bench-meshlets: culls the meshes from a ring of viewpoints outside the model and a few
+// inside it, and reports triangles submitted against triangles left, per view and in total,
+// with the time of the scalar and (when built in) SSE culler. nothing is drawn, so it runs
+// on meshes loaded without a GL context
+inline void RunMeshletBenchmark(std::vector<Mesh> &meshes, const std::string &label)
+{
+    size_t meshletCount = 0, meshletVertices = 0, meshletTriangles = 0;
+    glm::vec3 low(1e30f), high(-1e30f);
+    for (Mesh &mesh : meshes)
+    {
+        mesh.currentLod = 0;
+        const MeshLOD &lod = mesh.lods[0];
+        for (unsigned int i = lod.firstMeshlet; i < lod.firstMeshlet + lod.meshletCount && i < mesh.meshlets.size(); i++)
+        {
+            meshletVertices += mesh.meshlets[i].vertexCount;
+            meshletTriangles += mesh.meshlets[i].triangleCount;
+        }
+        meshletCount += lod.meshletCount;
+        low = glm::min(low, mesh.boundsCenter - glm::vec3(mesh.boundsRadius));
+        high = glm::max(high, mesh.boundsCenter + glm::vec3(mesh.boundsRadius));
+    }
+    if (!meshletCount)
+    {
+        std::cout << label << ": no meshlets" << std::endl;
+        return;
+    }
+    glm::vec3 center = (low + high) * 0.5f;
+    float radius = glm::length(high - low) * 0.5f;
+    std::cout << label << ": " << meshes.size() << " meshes, " << meshletCount << " meshlets, " << (float)meshletVertices / meshletCount
+              << " vertices and " << (float)meshletTriangles / meshletCount << " triangles per meshlet" << std::endl;
+
+    struct View
+    {
+        glm::vec3 eye, target;
+    };
+    std::vector<View> views;
+    for (float distance : { 1.5f, 3.0f })
+        for (int step = 0; step < 8; step++)
+        {
+            float angle = glm::radians(45.0f * step);
+            glm::vec3 offset(std::sin(angle), 0.35f, std::cos(angle));
+            views.push_back({ center + glm::normalize(offset) * radius * distance, center });
+        }
+    for (int step = 0; step < 4; step++)
+    {
+        float angle = glm::radians(90.0f * step);
+        views.push_back({ center, center + glm::vec3(std::sin(angle), 0.0f, std::cos(angle)) });
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, radius * 10.0f);
+    MeshletCuller scalar(false), simd;
+    const int repeats = 200;
+    unsigned long long totalSubmitted = 0, totalVisible = 0;
+    bool agree = true;
+    for (size_t v = 0; v < views.size(); v++)
+    {
+        glm::mat4 viewProjection = projection * glm::lookAt(views[v].eye, views[v].target, glm::vec3(0.0f, 1.0f, 0.0f));
+        float scalarMs = 0.0f, simdMs = 0.0f;
+        std::vector<DrawElementsIndirectCommand> reference;
+        for (int r = 0; r < repeats; r++)
+        {
+            scalar.BeginFrame();
+            scalarMs += scalar.Cull(meshes, glm::mat4(1.0f), viewProjection, views[v].eye).cullMs;
+        }
+        for (const Mesh &mesh : meshes) reference.insert(reference.end(), mesh.visibleDraws.begin(), mesh.visibleDraws.end());
+        for (int r = 0; r < repeats; r++)
+        {
+            simd.BeginFrame();
+            simdMs += simd.Cull(meshes, glm::mat4(1.0f), viewProjection, views[v].eye).cullMs;
+        }
+        size_t at = 0;
+        for (const Mesh &mesh : meshes)
+            for (const DrawElementsIndirectCommand &draw : mesh.visibleDraws)
+            {
+                agree = agree && at < reference.size() && reference[at].firstIndex == draw.firstIndex && reference[at].count == draw.count;
+                at++;
+            }
+        agree = agree && at == reference.size();
+
+        const MeshletCuller::Stats &stats = simd.GetStats();
+        totalSubmitted += stats.trianglesSubmitted;
+        totalVisible += stats.trianglesVisible;
+        std::cout << "  view " << v << (v >= 16 ? " (inside)" : "") << ": " << stats.trianglesSubmitted << " -> " << stats.trianglesVisible
+                  << " triangles (" << 100.0f * stats.trianglesVisible / std::max(stats.trianglesSubmitted, 1u) << "%), meshlets "
+                  << stats.meshletsVisible << "/" << stats.meshlets << " (" << stats.frustumCulled << " frustum, "
+                  << stats.backfaceCulled << " backface), " << stats.draws << " draws, scalar " << scalarMs * 1000.0f / repeats
+                  << " us" << (simd.UsesSIMD() ? ", SSE2 " : ", scalar again ") << simdMs * 1000.0f / repeats << " us" << std::endl;
+    }
+    std::cout << "  total: " << totalSubmitted << " -> " << totalVisible << " triangles ("
+              << 100.0f * totalVisible / std::max(totalSubmitted, 1ull) << "%), scalar and SIMD "
+              << (agree ? "agree" : "DISAGREE") << std::endl;
+    scalar.Disable(meshes);
+    simd.Disable(meshes);
+}
+
+#endif
@@ -15,6 +15,13 @@
 #include "stb_image.h"
 #include "mesh.h"
 #include "shader.h"
+#include "gl_extensions.h"
+#include "bundle.h"
+#include "texture_compress.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+#include "meshlet.h"
+#include "job_system.h"
 
 #include <string>
 #include <fstream>
@@ -24,12 +31,74 @@
 #include <math.h>
 #include <vector>
 #include <algorithm>
+#include <chrono>
 #include "animdata.h"
 
 
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromBundle(const Bundle &bundle, uint32_t entry, StagingRing &staging);
+
+// checks every record of a model entry against the entries it points into, so loaders can walk it
+// without further bounds checks. Bundle::Open has already checked each entry lies inside the file
+inline bool ValidateBundleModel(const Bundle &bundle, int index)
+{
+    const BundleEntry &entry = bundle.Entry(index);
+    const uint8_t *data = bundle.Data(entry);
+    auto fail = [&](const char *what) {
+        std::cout << "ERROR::BUNDLE::BAD_MODEL: " << entry.name << ": " << what << std::endl;
+        return false;
+    };
+    if (entry.size < sizeof(BundleModel)) return fail("truncated header");
+    const BundleModel *header = (const BundleModel *)data;
+    // 64-bit sums, so huge counts cannot wrap past the size check
+    uint64_t lightCount = (uint64_t)header->bulbCount + header->pointBulbCount;
+    uint64_t recordBytes = sizeof(BundleModel) + header->meshCount * (uint64_t)sizeof(BundleMesh)
+        + lightCount * sizeof(BundleLight) + header->boneCount * (uint64_t)sizeof(BundleBone);
+    if (recordBytes > entry.size) return fail("counts exceed the entry");
+
+    auto sized = [&](uint32_t at, BundleEntryType type, uint64_t bytes) {
+        return at < bundle.EntryCount() && bundle.Entry(at).type == type && bundle.Entry(at).size >= bytes;
+    };
+    const BundleMesh *meshRecords = (const BundleMesh *)(data + sizeof(BundleModel));
+    for (uint32_t i = 0; i < header->meshCount; i++)
+    {
+        const BundleMesh &record = meshRecords[i];
+        if (record.indexSize != 2 && record.indexSize != 4) return fail("bad index size");
+        if (!sized(record.vertexEntry, BundleEntryType::Vertices, record.vertexCount * (uint64_t)sizeof(Vertex)))
+            return fail("vertex entry");
+        if (!sized(record.indexEntry, BundleEntryType::Indices, record.indexCount * (uint64_t)record.indexSize))
+            return fail("index entry");
+        if (record.meshletCount && !sized(record.meshletEntry, BundleEntryType::Meshlets, record.meshletCount * (uint64_t)sizeof(Meshlet)))
+            return fail("meshlet entry");
+        const Meshlet *meshlets = record.meshletCount ? (const Meshlet *)bundle.Data(record.meshletEntry) : nullptr;
+        for (uint32_t m = 0; m < record.meshletCount; m++)
+            if ((uint64_t)meshlets[m].firstIndex + meshlets[m].triangleCount * 3ull > record.indexCount)
+                return fail("meshlet range");
+        if (record.textureCount > BUNDLE_MAX_MESH_TEXTURES) return fail("texture count");
+        for (uint32_t t = 0; t < record.textureCount; t++)
+        {
+            uint32_t texture = record.textureEntries[t];
+            if (!sized(texture, BundleEntryType::Texture, sizeof(BundleTexture))) return fail("texture entry");
+            const BundleEntry &textureEntry = bundle.Entry(texture);
+            const BundleTexture *textureHeader = (const BundleTexture *)bundle.Data(textureEntry);
+            if (sizeof(BundleTexture) + textureHeader->mipCount * (uint64_t)sizeof(BundleMip) > textureEntry.size)
+                return fail("texture mip count");
+            const BundleMip *mips = (const BundleMip *)(bundle.Data(textureEntry) + sizeof(BundleTexture));
+            for (uint32_t level = 0; level < textureHeader->mipCount; level++)
+                if (mips[level].offset > textureEntry.size || mips[level].size > textureEntry.size - mips[level].offset)
+                    return fail("texture mip range");
+        }
+        // no LODs is fine (the mesh falls back to its full index range); bad ranges are not
+        if (record.lodCount > BUNDLE_MAX_MESH_LODS) return fail("LOD count");
+        for (uint32_t l = 0; l < record.lodCount; l++)
+            if ((uint64_t)record.lods[l].firstIndex + record.lods[l].indexCount > record.indexCount
+                || (uint64_t)record.lods[l].firstMeshlet + record.lods[l].meshletCount > record.meshletCount)
+                return fail("LOD range");
+    }
+    return true;
+}
 
 struct Bulbs {
     glm::vec3 Color;
@@ -53,15 +122,121 @@ public:
     // int MAX_BULBS = 5;
     vector<Bulbs>bulbs;
     vector<Bulbs>pointBulbs;
+    // one per mesh when loaded from source (see mesh_optimize.h)
+    vector<MeshOptimizeStats> optimizeStats;
+    // stages of a load from source: the assimp parse and the serial node walk, the parallel
+    // conversion (with welding, LODs and meshlets), then textures and buffers
+    float parseMs = 0.0f, convertMs = 0.0f, uploadMs = 0.0f;
     string directory;
     bool gammaCorrection;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // upload = false only reads the data (meshes get no buffers, textures keep id 0), for house_bake
+    Model(string const &path, bool gamma = false, bool upload = true) : gammaCorrection(gamma), m_Upload(upload)
     {
         loadModel(path);
     }
 
+    // loads a model baked by house_bake: vertex, index and texture data are copied once, from the
+    // mapped file into the staging ring, and each entry's pages are released once uploaded, so
+    // only the asset in flight is resident. keepVertices keeps CPU copies for the skinning passes
+    Model(const Bundle &bundle, string const &name, StagingRing &staging, bool keepVertices = false) : gammaCorrection(false)
+    {
+        int index = bundle.Find(BundleEntryType::Model, name);
+        if (index < 0)
+        {
+            cout << "ERROR::BUNDLE::MODEL_NOT_FOUND: " << name << endl;
+            return;
+        }
+        if (!ValidateBundleModel(bundle, index)) return;
+        const uint8_t *data = bundle.Data(index);
+        const BundleModel *header = (const BundleModel *)data;
+        const BundleMesh *meshRecords = (const BundleMesh *)(data + sizeof(BundleModel));
+        const BundleLight *lights = (const BundleLight *)(meshRecords + header->meshCount);
+        const BundleBone *bones = (const BundleBone *)(lights + header->bulbCount + header->pointBulbCount);
+
+        // several meshes share a texture entry; upload each one once
+        std::map<uint32_t, Texture> uploaded;
+        meshes.reserve(header->meshCount);
+        for (uint32_t i = 0; i < header->meshCount; i++)
+        {
+            const BundleMesh &record = meshRecords[i];
+            const BundleEntry &vertexEntry = bundle.Entry(record.vertexEntry);
+            const BundleEntry &indexEntry = bundle.Entry(record.indexEntry);
+            bundle.Prefetch(vertexEntry);
+            bundle.Prefetch(indexEntry);
+
+            vector<Texture> textures;
+            for (uint32_t t = 0; t < record.textureCount; t++)
+            {
+                uint32_t entry = record.textureEntries[t];
+                auto found = uploaded.find(entry);
+                if (found == uploaded.end())
+                {
+                    Texture texture;
+                    texture.id = TextureFromBundle(bundle, entry, staging);
+                    bundle.Release(bundle.Entry(entry));
+                    texture.path = bundle.Entry(entry).name;
+                    found = uploaded.insert({ entry, texture }).first;
+                    textures_loaded.push_back(texture);
+                }
+                Texture texture = found->second;
+                texture.type = record.textureTypes[t];
+                textures.push_back(texture);
+            }
+
+            Material mat;
+            mat.Ka = glm::vec4(record.material.Ka[0], record.material.Ka[1], record.material.Ka[2], record.material.Ka[3]);
+            mat.Kd = glm::vec4(record.material.Kd[0], record.material.Kd[1], record.material.Kd[2], record.material.Kd[3]);
+            mat.Ks = glm::vec4(record.material.Ks[0], record.material.Ks[1], record.material.Ks[2], record.material.Ks[3]);
+            mat.shininess = record.material.shininess;
+            mat.transparency = record.material.transparency;
+            mat.hasTexture = record.material.hasTexture != 0;
+
+            vector<MeshLOD> lods;
+            for (uint32_t l = 0; l < record.lodCount; l++)
+                lods.push_back({ record.lods[l].firstIndex, record.lods[l].indexCount, record.lods[l].error,
+                    record.lods[l].firstMeshlet, record.lods[l].meshletCount });
+
+            meshes.push_back(Mesh(staging, (const Vertex *)bundle.Data(vertexEntry), record.vertexCount, bundle.Data(indexEntry),
+                record.indexCount, record.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, lods, textures, mat, aiString(record.name), keepVertices));
+            if (record.meshletCount)
+            {
+                const BundleEntry &meshletEntry = bundle.Entry(record.meshletEntry);
+                const Meshlet *meshlets = (const Meshlet *)bundle.Data(meshletEntry);
+                meshes.back().meshlets.assign(meshlets, meshlets + record.meshletCount);
+                bundle.Release(meshletEntry);
+            }
+            bundle.Release(vertexEntry);
+            bundle.Release(indexEntry);
+        }
+
+        for (uint32_t i = 0; i < header->bulbCount + header->pointBulbCount; i++)
+        {
+            const BundleLight &light = lights[i];
+            Bulbs bulb = {};
+            bulb.ambient = glm::vec3(light.ambient[0], light.ambient[1], light.ambient[2]);
+            bulb.diffuse = glm::vec3(light.diffuse[0], light.diffuse[1], light.diffuse[2]);
+            bulb.specular = glm::vec3(light.specular[0], light.specular[1], light.specular[2]);
+            bulb.position = glm::vec3(light.position[0], light.position[1], light.position[2]);
+            bulb.normal = glm::vec3(light.normal[0], light.normal[1], light.normal[2]);
+            bulb.angle = light.angle;
+            bulb.constant = light.constant;
+            bulb.linear = light.linear;
+            bulb.exp = light.exp;
+            (i < header->bulbCount ? bulbs : pointBulbs).push_back(bulb);
+        }
+
+        for (uint32_t i = 0; i < header->boneCount; i++)
+        {
+            BoneInfo info;
+            info.id = bones[i].id;
+            std::memcpy(&info.offset, bones[i].offset, sizeof(bones[i].offset));
+            m_BoneInfoMap[bones[i].name] = info;
+            m_BoneCounter = std::max(m_BoneCounter, info.id + 1);
+        }
+    }
+
     // draws the model, and thus all its meshes
     void Draw(Shader &shader, bool isLighting, GLuint cubetex)
     {
@@ -112,15 +287,116 @@ public:
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader, isLighting, cubetex);
     }
+    // frees the buffers and textures of every mesh; the model draws nothing afterwards
+    void Release()
+    {
+        for (Mesh &mesh : meshes) mesh.Release();
+        for (Texture &texture : textures_loaded)
+            if (texture.id) glDeleteTextures(1, &texture.id);
+        meshes.clear();
+        textures_loaded.clear();
+    }
+
+    // chooses every mesh's level of detail for this frame from its projected error: pixelsPerUnit
+    // is how many pixels one model unit covers at the mesh's nearest point. fovY in radians.
+    // returns the triangles that will be drawn; fullTriangles gets the count at full detail.
+    // with lods (one per mesh) the levels picked last time are read from it and this frame's are
+    // written back, and the meshes are not touched; without it the meshes' currentLod is used
+    unsigned int SelectLODs(const glm::mat4 &model, const glm::vec3 &cameraPos, float fovY, float viewportHeight,
+        float pixelError, float hysteresis, bool enabled, unsigned int &fullTriangles, int *lods = nullptr)
+    {
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        float pixelsPerWorldUnit = viewportHeight / (2.0f * tan(fovY * 0.5f));
+        unsigned int drawn = 0;
+        fullTriangles = 0;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            Mesh &mesh = meshes[i];
+            int &lod = lods ? lods[i] : mesh.currentLod;
+            if (enabled)
+            {
+                glm::vec3 center = glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f));
+                float distance = std::max(glm::length(center - cameraPos) - mesh.boundsRadius * scale, 0.1f);
+                lod = mesh.SelectLOD(pixelsPerWorldUnit * scale / distance, pixelError, hysteresis, lod);
+            }
+            else
+                lod = 0;
+            drawn += mesh.lods[lod].indexCount / 3;
+            fullTriangles += mesh.lods[0].indexCount / 3;
+        }
+        return drawn;
+    }
+
+    // the levels SelectLODs wrote to lods become what the meshes draw; on the GL thread
+    void SetLODs(const int *lods)
+    {
+        for (size_t i = 0; i < meshes.size(); i++) meshes[i].currentLod = lods[i];
+    }
+    // ACMR and vertex counts before/after OptimizeMesh, per mesh or just the totals
+    void PrintOptimizeReport(const string &label, bool perMesh) const
+    {
+        MeshOptimizeStats total;
+        float missesBefore = 0.0f, missesAfter = 0.0f;
+        // large enough for LODs, but simplification could not save enough (seam or border corners, mostly)
+        vector<string> withoutLODs;
+        for (size_t i = 0; i < optimizeStats.size(); i++)
+        {
+            const MeshOptimizeStats &s = optimizeStats[i];
+            if (perMesh)
+                cout << "  " << meshes[i].name.C_Str() << ": " << s.verticesBefore << " -> " << s.verticesAfter << " vertices, "
+                     << s.triangles << " triangles, ACMR " << s.acmrBefore << " -> " << s.acmrAfter << ", " << s.clusters
+                     << " overdraw clusters, " << (IndexTypeFor(s.verticesAfter) == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices" << endl;
+            if (perMesh && meshes[i].lods.size() > 1)
+            {
+                cout << "    LODs:";
+                for (const MeshLOD &lod : meshes[i].lods)
+                    cout << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+                cout << endl;
+            }
+            if (meshes[i].lods.size() <= 1 && s.triangles >= MESH_LOD_MIN_TRIANGLES)
+                withoutLODs.push_back(meshes[i].name.C_Str());
+            total.verticesBefore += s.verticesBefore;
+            total.verticesAfter += s.verticesAfter;
+            total.triangles += s.triangles;
+            missesBefore += s.acmrBefore * s.triangles;
+            missesAfter += s.acmrAfter * s.triangles;
+        }
+        if (total.triangles)
+            cout << label << ": " << optimizeStats.size() << " meshes, " << total.verticesBefore << " -> " << total.verticesAfter
+                 << " vertices, ACMR " << missesBefore / total.triangles << " -> " << missesAfter / total.triangles << endl;
+        if (perMesh && !withoutLODs.empty())
+        {
+            cout << "  no LODs (" << withoutLODs.size() << " meshes):";
+            for (const string &name : withoutLODs) cout << " " << name;
+            cout << endl;
+        }
+    }
     auto& GetBoneInfoMap() { return m_BoneInfoMap; }
 	int& GetBoneCount() { return m_BoneCounter; }
     
 private:
     std::map<string, BoneInfo> m_BoneInfoMap;
 	int m_BoneCounter = 0;
+    bool m_Upload = true;
+
+    // a mesh between reading it from assimp and creating its buffers
+    struct PendingMesh
+    {
+        aiMesh *source;
+        vector<int> boneIds; // model bone id of each of source's bones
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        Material mat;
+        aiString name;
+        MeshOptimizeStats optimizeStats;
+        vector<MeshLOD> lods;
+        vector<Meshlet> meshlets;
+    };
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
+        auto start = std::chrono::steady_clock::now();
         // read file via ASSIMP
         Assimp::Importer importer;
        // const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices  |aiProcess_SortByPType | aiProcess_FlipUVs);
@@ -134,12 +410,46 @@ private:
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        // process ASSIMP's root node recursively: materials, lights and bone ids, in node order
+        vector<PendingMesh> pending;
+        processNode(scene->mRootNode, scene, pending);
+        auto parsed = std::chrono::steady_clock::now();
+
+        // the rest of the CPU work touches nothing but its own mesh: one job per mesh, no GL calls.
+        // within a mesh, conversion splits big meshes into ranges and the LOD levels and their
+        // meshlets are jobs of their own; OptimizeMesh stays serial per mesh
+        Jobs().ParallelFor(pending.size(), 1, [&pending](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; i++)
+            {
+                PendingMesh &mesh = pending[i];
+                convertMesh(mesh);
+                // weld, then reorder for the vertex cache, overdraw and fetch (bone weights must be in by now)
+                mesh.optimizeStats = OptimizeMesh(mesh.vertices, mesh.indices);
+                // coarser index ranges over the same vertices, appended to indices
+                mesh.lods = GenerateLODs(mesh.vertices, mesh.indices);
+                // every level's range clustered for culling
+                mesh.meshlets = BuildMeshlets(mesh.vertices, mesh.indices, mesh.lods);
+            }
+        });
+        auto converted = std::chrono::steady_clock::now();
+
+        // textures and buffers, in node order on this thread, which has the context
+        meshes.reserve(meshes.size() + pending.size());
+        for (PendingMesh &mesh : pending)
+        {
+            vector<Texture> textures = loadMeshTextures(scene->mMaterials[mesh.source->mMaterialIndex]);
+            optimizeStats.push_back(mesh.optimizeStats);
+            meshes.push_back(Mesh(mesh.vertices, mesh.indices, textures, mesh.mat, mesh.name, mesh.lods, m_Upload));
+            meshes.back().meshlets.swap(mesh.meshlets);
+        }
+        parseMs = std::chrono::duration<float, std::milli>(parsed - start).count();
+        convertMs = std::chrono::duration<float, std::milli>(converted - parsed).count();
+        uploadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - converted).count();
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    void processNode(aiNode *node, const aiScene *scene, vector<PendingMesh> &pending)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -147,89 +457,29 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            pending.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, pending);
         }
 
     }
-    void SetVertexBoneDataToDefault(Vertex& vertex)
-	{
-		for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
-		{
-			vertex.m_BoneIDs[i] = -1;
-			vertex.m_Weights[i] = 0.0f;
-		}
-	}
-
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // everything that reads or adds to the model's shared state (lights, bone ids) and so has to
+    // go in node order. it is cheap; the vertex data is converted afterwards, by convertMesh
+    PendingMesh processMesh(aiMesh *mesh, const aiScene *scene)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-        glm::vec3 position; //for light bulbs
-        glm::vec3 normal;
-
-        // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
-        {
-            Vertex vertex;
-            SetVertexBoneDataToDefault(vertex);
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            position = vector;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                normal = vector;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-            {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x; 
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
-            }
-            else
-            {
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-            }
-
-            vertices.push_back(vertex);
-        }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        PendingMesh result;
+        result.source = mesh;
+        // the last vertex stands for the whole mesh when it is a light bulb
+        glm::vec3 position = glm::vec3(0.0f); //for light bulbs
+        if (mesh->mNumVertices > 0)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);        
+            const aiVector3D &last = mesh->mVertices[mesh->mNumVertices - 1];
+            position = glm::vec3(last.x, last.y, last.z);
         }
+
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         aiString meshName = material->GetName();
@@ -353,16 +603,100 @@ private:
         material->Get(AI_MATKEY_COLOR_SPECULAR, color);
         mat.Ks = glm::vec4(color.r,color.g,color.b,transparency);
 
+        if( material->GetTextureCount(aiTextureType_DIFFUSE)==0 )mat.hasTexture = false;
+        else mat.hasTexture = true;
+
+        // bone ids are handed out in the order meshes are processed, so they are stable from run to run
+        result.boneIds.resize(mesh->mNumBones);
+        for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex)
+            result.boneIds[boneIndex] = registerBone(mesh->mBones[boneIndex]);
+        result.mat = mat;
+        result.name = meshName;
+        return result;
+    }
+
+    // vertices, indices and bone weights of a mesh from processMesh, written straight into
+    // buffers sized up front. reads only the aiMesh, so any number of meshes convert at once;
+    // the vertex and triangle loops of big meshes are split across the job system as well
+    static void convertMesh(PendingMesh &pending)
+    {
+        const aiMesh *mesh = pending.source;
+        vector<Vertex> &vertices = pending.vertices;
+        vector<unsigned int> &indices = pending.indices;
+
+        // zeroed so absent attributes do not keep otherwise identical vertices apart when welding
+        Vertex blank = Vertex();
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++) blank.m_BoneIDs[i] = -1;
+        vertices.assign(mesh->mNumVertices, blank);
+        bool normals = mesh->HasNormals();
+        // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+        // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+        const aiVector3D *uvs = mesh->mTextureCoords[0];
+        Jobs().ParallelFor(mesh->mNumVertices, 16384, [&](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; i++)
+            {
+                Vertex &vertex = vertices[i];
+                vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+                if (normals) vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+                if (uvs)
+                {
+                    vertex.TexCoords = glm::vec2(uvs[i].x, uvs[i].y);
+                    vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                    vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+                }
+            }
+        });
+
+        // faces are triangles after aiProcess_Triangulate, apart from stray points and lines; only
+        // when there are some does every face's first index have to be counted
+        size_t indexCount = 0;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++) indexCount += mesh->mFaces[i].mNumIndices;
+        indices.resize(indexCount);
+        if (indexCount == (size_t)mesh->mNumFaces * 3)
+        {
+            Jobs().ParallelFor(mesh->mNumFaces, 32768, [&](size_t first, size_t last)
+            {
+                for (size_t i = first; i < last; i++)
+                {
+                    const unsigned int *face = mesh->mFaces[i].mIndices;
+                    indices[i * 3] = face[0];
+                    indices[i * 3 + 1] = face[1];
+                    indices[i * 3 + 2] = face[2];
+                }
+            });
+        }
+        else
+        {
+            size_t at = 0;
+            for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+                for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++) indices[at++] = mesh->mFaces[i].mIndices[j];
+        }
+
+        // a vertex takes its influences in bone order, so the scatter stays serial within the mesh
+        for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex)
+        {
+            const aiBone *bone = mesh->mBones[boneIndex];
+            int boneID = pending.boneIds[boneIndex];
+            for (unsigned int weightIndex = 0; weightIndex < bone->mNumWeights; ++weightIndex)
+            {
+                unsigned int vertexId = bone->mWeights[weightIndex].mVertexId;
+                assert(vertexId < vertices.size());
+                SetVertexBoneData(vertices[vertexId], boneID, bone->mWeights[weightIndex].mWeight);
+            }
+        }
+    }
+
+    // diffuse, specular, normal and height maps of a mesh's material, loaded on first use
+    vector<Texture> loadMeshTextures(aiMaterial *material)
+    {
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
         // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
         // Same applies to other texture as the following list summarizes:
         // diffuse: texture_diffuseN
         // specular: texture_specularN
         // normal: texture_normalN
-
-        if( material->GetTextureCount(aiTextureType_DIFFUSE)==0 )mat.hasTexture = false;
-        else mat.hasTexture = true;
-
+        vector<Texture> textures;
         // 1. diffuse maps
         vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
@@ -375,11 +709,10 @@ private:
         // 4. height maps
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-        ExtractBoneWeightForVertices(vertices,mesh,scene);
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures, mat, meshName);
+        return textures;
     }
-    void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
+
+    static void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
 	{
 		for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
 		{
@@ -392,40 +725,21 @@ private:
 		}
 	}
 
-    void ExtractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene)
+    // the model's id for a bone, added to the bone map the first time the bone is seen
+    int registerBone(const aiBone *bone)
 	{
 		auto& boneInfoMap = m_BoneInfoMap;
 		int& boneCount = m_BoneCounter;
 
-		for (int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex)
-		{
-			int boneID = -1;
-			std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
-			if (boneInfoMap.find(boneName) == boneInfoMap.end())
-			{
-				BoneInfo newBoneInfo;
-				newBoneInfo.id = boneCount;
-				newBoneInfo.offset = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
-				boneInfoMap[boneName] = newBoneInfo;
-				boneID = boneCount;
-				boneCount++;
-			}
-			else
-			{
-				boneID = boneInfoMap[boneName].id;
-			}
-			assert(boneID != -1);
-			auto weights = mesh->mBones[boneIndex]->mWeights;
-			int numWeights = mesh->mBones[boneIndex]->mNumWeights;
-
-			for (int weightIndex = 0; weightIndex < numWeights; ++weightIndex)
-			{
-				int vertexId = weights[weightIndex].mVertexId;
-				float weight = weights[weightIndex].mWeight;
-				assert(vertexId <= vertices.size());
-				SetVertexBoneData(vertices[vertexId], boneID, weight);
-			}
-		}
+		std::string boneName = bone->mName.C_Str();
+		auto found = boneInfoMap.find(boneName);
+		if (found != boneInfoMap.end())
+			return found->second.id;
+		BoneInfo newBoneInfo;
+		newBoneInfo.id = boneCount;
+		newBoneInfo.offset = AssimpGLMHelpers::ConvertMatrixToGLMFormat(bone->mOffsetMatrix);
+		boneInfoMap[boneName] = newBoneInfo;
+		return boneCount++;
 	}
 
 
@@ -452,7 +766,7 @@ private:
             if(!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                texture.id = m_Upload ? TextureFromFile(str.C_Str(), this->directory) : 0;
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture);
@@ -503,4 +817,46 @@ inline unsigned int TextureFromFile(const char *path, const string &directory, b
 
     return textureID;
 }
+
+// uploads a baked texture entry with all of its mips; BC1/BC3 go to the driver as they are
+inline unsigned int TextureFromBundle(const Bundle &bundle, uint32_t entry, StagingRing &staging)
+{
+    const uint8_t *data = bundle.Data(entry);
+    const BundleTexture *header = (const BundleTexture *)data;
+    const BundleMip *mips = (const BundleMip *)(data + sizeof(BundleTexture));
+    TextureFormat format = (TextureFormat)header->format;
+    bundle.Prefetch(bundle.Entry(entry));
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    for (uint32_t level = 0; level < header->mipCount; level++)
+    {
+        const BundleMip &mip = mips[level];
+        const uint8_t *pixels = data + mip.offset;
+        if (format == TextureFormat::RGBA8)
+            staging.UploadPixels(pixels, mip.size, [&](const void *source)
+            {
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, source);
+            });
+        else if (GLExt().textureCompressionS3TC)
+            staging.UploadPixels(pixels, mip.size, [&](const void *source)
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D, level,
+                    format == TextureFormat::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                    mip.width, mip.height, 0, (GLsizei)mip.size, source);
+            });
+        else
+        {
+            std::vector<uint8_t> rgba = DecompressImage(pixels, mip.width, mip.height, format);
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->mipCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
 #endif
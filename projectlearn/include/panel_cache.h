@@ -0,0 +1,196 @@
+#ifndef PANEL_CACHE_H
+#define PANEL_CACHE_H
+
+#include <glad/glad.h>
+
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "imgui_impl_opengl3.h"
+
+#include <cstdint>
+
+// retained mode for an ImGui window whose contents only change when its inputs do. while the
+// window is idle none of its contents are submitted: no widgets are built and nothing of it is
+// generated or uploaded. instead the last image of the window, rendered into a texture once, is
+// the only thing in an undecorated window of the same name, so it keeps its place among the
+// other windows. the window is built live again as soon as the hash of the state
+// it displays changes, the mouse comes near it or one of its widgets is active. build the window
+// with ImGuiWindowFlags_NoFocusOnAppearing, or it takes the focus every time it comes back live
+class PanelCache
+{
+public:
+    struct Stats
+    {
+        bool cached = false;
+        int captures = 0;
+        int cachedFrames = 0, liveFrames = 0;
+        int vertices = 0, indices = 0; // skipped every cached frame
+    };
+
+    bool enabled = true;
+
+    explicit PanelCache(const char *windowName) : name(windowName) {}
+
+    // fold everything the window displays into this frame's state hash, before Begin
+    void Hash(const void *data, size_t size)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    template <typename T> void Hash(const T &value) { Hash(&value, sizeof(T)); }
+
+    // after ImGui::NewFrame. true when the window has to be built this frame, otherwise its cached
+    // image has been submitted in its place
+    bool Begin()
+    {
+        ImGuiIO &io = ImGui::GetIO();
+        Hash(io.DisplaySize);
+        Hash(io.DisplayFramebufferScale);
+        frameHash = hash;
+        hash = 14695981039346656037ull;
+
+        // a few pixels of slack for the resize grips, which reach outside the window
+        ImVec2 mouse = io.MousePos;
+        bool nearMouse = mouse.x >= rectMin.x - 8.0f && mouse.y >= rectMin.y - 8.0f &&
+                         mouse.x <= rectMax.x + 8.0f && mouse.y <= rectMax.y + 8.0f;
+        stable = frameHash == lastHash ? stable + 1 : 0;
+        lastHash = frameHash;
+        if (!enabled || !texture || nearMouse || frameHash != capturedHash)
+        {
+            stats.cached = false;
+            stats.liveFrames++;
+            return live = true;
+        }
+
+        // the same window, so its z-order and focus order stay what they were; the image covers
+        // its decorations too, so the window draws none of its own
+        ImGui::SetNextWindowPos(rectMin);
+        ImGui::SetNextWindowSize(ImVec2(rectMax.x - rectMin.x, rectMax.y - rectMin.y));
+        ImGui::Begin(name, NULL, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_NoInputs |
+                     ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoNav);
+        ImDrawList *list = ImGui::GetWindowDrawList();
+        list->PushClipRect(rectMin, rectMax, false);
+        list->AddCallback(premultipliedBlend, NULL);
+        list->AddImage((ImTextureID)(intptr_t)texture, rectMin, rectMax, ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+        list->AddCallback(ImDrawCallback_ResetRenderState, NULL);
+        list->PopClipRect();
+        ImGui::End();
+        stats.cached = true;
+        stats.cachedFrames++;
+        return live = false;
+    }
+
+    // after ImGui::Render. renders the window into the texture once it has settled: its state
+    // unchanged for a couple of frames (auto-sizing takes two), not hovered, focused or active
+    void Capture()
+    {
+        if (!Settled()) return;
+        ImGuiWindow *window = ImGui::FindWindowByName(name);
+        lists.resize(0);
+        collect(window);
+        ImDrawData data;
+        data.Valid = true;
+        data.CmdLists = lists.Data;
+        data.CmdListsCount = lists.Size;
+        for (ImDrawList *list : lists)
+        {
+            data.TotalVtxCount += list->VtxBuffer.Size;
+            data.TotalIdxCount += list->IdxBuffer.Size;
+        }
+        data.DisplayPos = window->Pos;
+        data.DisplaySize = window->Size;
+        data.FramebufferScale = ImGui::GetIO().DisplayFramebufferScale;
+        int textureWidth = (int)(data.DisplaySize.x * data.FramebufferScale.x);
+        int textureHeight = (int)(data.DisplaySize.y * data.FramebufferScale.y);
+        if (textureWidth <= 0 || textureHeight <= 0) return;
+
+        GLint lastFramebuffer;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &lastFramebuffer);
+        resize(textureWidth, textureHeight);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, transparent);
+        ImGui_ImplOpenGL3_RenderExtraDrawData(&data);
+        glBindFramebuffer(GL_FRAMEBUFFER, lastFramebuffer);
+
+        rectMin = window->Pos;
+        rectMax = ImVec2(window->Pos.x + window->Size.x, window->Pos.y + window->Size.y);
+        capturedHash = frameHash;
+        stats.captures++;
+        stats.vertices = data.TotalVtxCount;
+        stats.indices = data.TotalIdxCount;
+    }
+
+    // after ImGui::Render, whether Capture would render the window. it only reads ImGui's state,
+    // so a render thread is only bothered when there is something to capture
+    bool Settled() const
+    {
+        if (!live || !enabled || stable < 2) return false;
+        ImGuiContext &g = *ImGui::GetCurrentContext();
+        ImGuiWindow *window = ImGui::FindWindowByName(name);
+        if (!window || !window->Active || window->Hidden || window->Collapsed) return false;
+        if (g.HoveredWindow && g.HoveredWindow->RootWindow == window) return false;
+        if (g.ActiveIdWindow && g.ActiveIdWindow->RootWindow == window) return false;
+        if (g.NavWindow && g.NavWindow->RootWindow == window) return false;
+        if (g.MovingWindow && g.MovingWindow->RootWindow == window) return false;
+        return true;
+    }
+
+    // forget the image, e.g. when something the hash doesn't cover changed
+    void Invalidate() { capturedHash = 0; }
+
+    // needs the context, call before it goes away
+    void Release()
+    {
+        if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+        if (texture) glDeleteTextures(1, &texture);
+        framebuffer = texture = 0;
+        width = height = 0;
+    }
+
+    const Stats &GetStats() const { return stats; }
+
+private:
+    const char *name;
+    uint64_t hash = 14695981039346656037ull, frameHash = 0, lastHash = 0, capturedHash = 0;
+    int stable = 0;
+    bool live = true;
+    ImVec2 rectMin = ImVec2(0.0f, 0.0f), rectMax = ImVec2(0.0f, 0.0f);
+    GLuint framebuffer = 0, texture = 0;
+    int width = 0, height = 0;
+    ImVector<ImDrawList *> lists;
+    Stats stats;
+
+    // the texture holds premultiplied colour: the window was blended onto transparent black
+    static void premultipliedBlend(const ImDrawList *, const ImDrawCmd *)
+    {
+        glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    // the window's own list, then its child windows in submission order like ImGui::Render does
+    void collect(ImGuiWindow *window)
+    {
+        if (window->DrawList->VtxBuffer.Size) lists.push_back(window->DrawList);
+        for (ImGuiWindow *child : window->DC.ChildWindows)
+            if (child->Active && !child->Hidden) collect(child);
+    }
+
+    void resize(int newWidth, int newHeight)
+    {
+        if (texture && newWidth == width && newHeight == height) return;
+        Release();
+        width = newWidth;
+        height = newHeight;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    }
+};
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include "imgui.h"
+#include "imgui_impl_opengl3.h"
+
+#include <Animator.h>
+#include <meshlet.h>
+#include <world_stream.h>
+#include <ui_stress.h>
+#include <frame_pacing.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a copy of ImGui's draw data that outlives the frame it was built in, so it can be drawn while
+// ImGui builds the next one. the lists keep their buffers from frame to frame
+class DrawDataCopy
+{
+public:
+    DrawDataCopy() { data.Clear(); }
+    DrawDataCopy(const DrawDataCopy &) = delete;
+    DrawDataCopy &operator=(const DrawDataCopy &) = delete;
+
+    ~DrawDataCopy()
+    {
+        for (ImDrawList *list : lists) IM_DELETE(list);
+    }
+
+    // after ImGui::Render (and anything merged into its draw data), on the main thread
+    void Copy(const ImDrawData *source)
+    {
+        data.Clear();
+        if (!source || !source->Valid) return;
+        while (lists.Size < source->CmdListsCount) lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+        for (int i = 0; i < source->CmdListsCount; i++)
+        {
+            const ImDrawList *from = source->CmdLists[i];
+            ImDrawList *to = lists[i];
+            copy(to->CmdBuffer, from->CmdBuffer);
+            copy(to->IdxBuffer, from->IdxBuffer);
+            copy(to->VtxBuffer, from->VtxBuffer);
+            to->Flags = from->Flags;
+        }
+        data = *source;
+        data.CmdLists = lists.Data;
+    }
+
+    // never NULL; empty when nothing was copied
+    ImDrawData *Get() { return &data; }
+
+private:
+    ImVector<ImDrawList *> lists;
+    ImDrawData data;
+
+    // unlike ImVector's assignment, keeps the capacity
+    template <typename T> static void copy(ImVector<T> &to, const ImVector<T> &from)
+    {
+        to.resize(from.Size);
+        if (from.Size) memcpy(to.Data, from.Data, (size_t)from.Size * sizeof(T));
+    }
+};
+
+// what drawing a frame measured, handed back to the main thread for the UI
+struct FrameResults
+{
+    unsigned int staticTriangles = 0, staticFullTriangles = 0;
+    unsigned int characterTriangles = 0, characterFullTriangles = 0;
+    int instancesDrawn = 0, instances = 0; // inside the frustum, and in the scene
+    MeshletCuller::Stats cull;
+    WorldStreamer::Stats stream;
+    ImGui_ImplOpenGL3_RenderStats ui = {};
+    int uiFlags = 0;
+    float uiRenderMs = 0.0f, uiGpuMs = 0.0f;
+    bool uiComparing = false, uiHasResults = false;
+    int uiComparisonMode = 0;
+    UIBenchmark::Result uiResults[3];
+};
+
+// one scene instance inside the frustum, with the level of detail of every mesh of its model
+// already picked
+struct DrawItem
+{
+    int model = 0; // index into the scene's models
+    glm::mat4 transform = glm::mat4(1.0f);
+    size_t firstLod = 0; // the levels, one per mesh, start here in FramePacket::lods
+    unsigned int triangles = 0, fullTriangles = 0;
+};
+
+// everything the render thread needs to draw a frame. the main thread fills it in, and once it
+// is submitted nothing else touches it until it has been drawn. the arrays keep their capacity
+// from frame to frame
+struct FramePacket
+{
+    // camera, already interpolated
+    glm::mat4 view = glm::mat4(1.0f), projection = glm::mat4(1.0f);
+    glm::vec3 viewPosition = glm::vec3(0.0f), cameraVelocity = glm::vec3(0.0f);
+    float fovY = 0.0f; // radians
+    int framebufferWidth = 0, framebufferHeight = 0;
+
+    // sun light
+    glm::vec3 lightPosition = glm::vec3(0.0f), lightDirection = glm::vec3(0.0f), lightColor = glm::vec3(1.0f);
+    glm::vec3 ambient = glm::vec3(0.0f), diffuse = glm::vec3(0.0f), specular = glm::vec3(0.0f);
+
+    // draw items, culled and LOD-selected on the main thread; instances counts the ones culled too
+    std::vector<DrawItem> staticItems, characterItems;
+    std::vector<int> lods;
+    int instances = 0;
+
+    // the character's bone palette, in whichever form the skinning mode uses
+    SkinningMode skinning = SkinningMode::Linear;
+    std::vector<glm::mat4> boneMatrices;
+    std::vector<DualQuat> boneDualQuats;
+    float paletteScale = 1.0f;
+
+    // LOD, culling and streaming settings as the UI left them
+    bool meshLOD = true;
+    float lodPixelError = 1.0f, lodHysteresis = 0.25f;
+    bool meshletCulling = true, coneCulling = false;
+    StreamBudget streamBudget;
+
+    // the UI, overlays included
+    DrawDataCopy ui;
+    float uiBuildMs = 0.0f;
+    int uiWidgets = 0;
+
+    FramePacer::Mark pacing;
+
+    // GL work recorded while the frame was built (settings the UI changed), run in order before
+    // it is drawn
+    std::vector<std::function<void()>> commands;
+
+    // filled in by the draw
+    FrameResults results;
+};
+
+// owns the GL context on a thread of its own and draws the frames the main thread hands it, so
+// input, simulation and UI of one frame overlap the GL submission of the one before. the main
+// thread fills a packet (Acquire), hands it over (Submit) and goes on with the next frame. the
+// packets are a ring of three, and Acquire waits while more than maxFramesAhead submitted ones
+// haven't been drawn: more smooths over uneven frames, fewer keeps the picture closer to the
+// input. GL work that can't wait for a packet (font and panel cache uploads) goes through
+// Invoke, which runs it after everything submitted so far while the main thread waits. without
+// the thread Submit and Invoke run right away on the calling thread, which keeps the context,
+// so both modes take the same path through the frame
+class RenderThread
+{
+public:
+    typedef std::function<void(FramePacket &)> DrawFunction;
+    static const int PacketCount = 3;
+
+    struct Stats
+    {
+        bool threaded = false;
+        int framesAhead = 0;        // submitted and not drawn yet, when the last packet was acquired
+        long long frames = 0;       // drawn
+        float drawMs = 0.0f;        // drawing the last frame, swap included
+        float idleMs = 0.0f;        // render thread waiting for it
+        float acquireWaitMs = 0.0f; // main thread waiting for a free packet, this frame
+        float invokeWaitMs = 0.0f;  // main thread waiting in Invoke, this frame
+        int invokes = 0;
+    };
+
+    // 0 draws every frame before the next one starts
+    int maxFramesAhead = 1;
+
+    RenderThread(GLFWwindow *window, bool threaded, DrawFunction draw) : window(window), threaded(threaded), draw(draw)
+    {
+        stats.threaded = threaded;
+    }
+
+    ~RenderThread() { Stop(); }
+
+    // once everything is loaded: the context moves to the render thread
+    void Start()
+    {
+        if (!threaded || thread.joinable()) return;
+        glfwMakeContextCurrent(NULL);
+        quit = false;
+        thread = std::thread(&RenderThread::loop, this);
+    }
+
+    // at the top of the frame: the packet to build it into
+    FramePacket &Acquire()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        FramePacket &packet = packets[next];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            int limit = std::min(std::max(maxFramesAhead, 0), PacketCount - 1);
+            stats.framesAhead = ahead;
+            finished.wait(lock, [this, limit] { return ahead <= limit; });
+            stats.acquireWaitMs = elapsedMs(start);
+            stats.invokeWaitMs = 0.0f;
+            stats.invokes = 0;
+        }
+        packet.commands.clear();
+        return packet;
+    }
+
+    // the packet from Acquire is complete and belongs to the render thread from here on
+    void Submit()
+    {
+        FramePacket &packet = packets[next];
+        next = (next + 1) % PacketCount;
+        if (!threaded || !thread.joinable())
+        {
+            drawPacket(packet);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(Work{ &packet, nullptr });
+            ahead++;
+        }
+        wake.notify_one();
+    }
+
+    // runs job with the context once the frames submitted so far are drawn, and waits for it
+    void Invoke(std::function<void()> job)
+    {
+        if (!threaded || !thread.joinable())
+        {
+            job();
+            return;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        unsigned long long ticket = ++jobsQueued;
+        queue.push_back(Work{ nullptr, std::move(job) });
+        wake.notify_one();
+        finished.wait(lock, [this, ticket] { return jobsDone >= ticket; });
+        stats.invokeWaitMs += elapsedMs(start);
+        stats.invokes++;
+    }
+
+    // draws what was submitted, then the context comes back to the calling thread
+    void Stop()
+    {
+        if (!thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        thread.join();
+        glfwMakeContextCurrent(window);
+    }
+
+    // of the last frame drawn
+    FrameResults Results()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return results;
+    }
+
+    Stats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    // a packet to draw or a job to run
+    struct Work
+    {
+        FramePacket *packet;
+        std::function<void()> job;
+    };
+
+    GLFWwindow *window;
+    bool threaded;
+    DrawFunction draw;
+    FramePacket packets[PacketCount];
+    int next = 0; // the packet Acquire hands out
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    std::deque<Work> queue;
+    int ahead = 0;
+    unsigned long long jobsQueued = 0, jobsDone = 0;
+    bool quit = false;
+    float idleMs = 0.0f; // since the last frame was drawn, render thread only
+    FrameResults results;
+    Stats stats;
+
+    static float elapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    void drawPacket(FramePacket &packet)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::function<void()> &command : packet.commands) command();
+        draw(packet);
+        float ms = elapsedMs(start);
+        std::lock_guard<std::mutex> lock(mutex);
+        results = packet.results;
+        stats.drawMs = ms;
+        stats.idleMs = idleMs;
+        stats.frames++;
+        idleMs = 0.0f;
+    }
+
+    void loop()
+    {
+        glfwMakeContextCurrent(window);
+        Jobs().RegisterThread("render");
+        for (;;)
+        {
+            Work work;
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return quit || !queue.empty(); });
+                if (queue.empty()) break; // quitting, with everything drawn
+                work = std::move(queue.front());
+                queue.pop_front();
+                idleMs += elapsedMs(start);
+            }
+            if (work.packet)
+            {
+                drawPacket(*work.packet);
+                std::lock_guard<std::mutex> lock(mutex);
+                ahead--;
+            }
+            else
+            {
+                work.job();
+                std::lock_guard<std::mutex> lock(mutex);
+                jobsDone++;
+            }
+            finished.notify_all();
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+};
+
+#endif
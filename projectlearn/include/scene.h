@@ -0,0 +1,509 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// instances one model may have, grids included; more than this is a typo in a grid, not a scene
+// this renderer can draw (large worlds go through world_stream.h instead)
+#define SCENE_MAX_INSTANCES 65536
+
+// a parsed JSON value: as much of JSON as scene files need (no \u escapes outside ASCII)
+struct JsonValue
+{
+    enum Type { Null, Bool, Number, String, Array, Object };
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;                             // Array
+    std::vector<std::pair<std::string, JsonValue>> members;   // Object, in file order
+    int line = 0;
+
+    const JsonValue *Find(const std::string &key) const
+    {
+        for (const std::pair<std::string, JsonValue> &member : members)
+            if (member.first == key) return &member.second;
+        return nullptr;
+    }
+};
+
+// recursive descent over the whole file; on failure Error says what and where
+class JsonReader
+{
+public:
+    bool Parse(const std::string &text, JsonValue &root)
+    {
+        this->text = &text;
+        at = 0;
+        line = 1;
+        error.clear();
+        if (!value(root, 0)) return false;
+        skipSpace();
+        if (at != text.size()) return fail("trailing characters");
+        return true;
+    }
+
+    const std::string &Error() const { return error; }
+
+private:
+    const std::string *text = nullptr;
+    size_t at = 0;
+    int line = 1;
+    std::string error;
+
+    bool fail(const std::string &what)
+    {
+        if (error.empty()) error = "line " + std::to_string(line) + ": " + what;
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (at < text->size())
+        {
+            char c = (*text)[at];
+            if (c == '\n') line++;
+            else if (c != ' ' && c != '\t' && c != '\r') return;
+            at++;
+        }
+    }
+
+    bool literal(const char *word)
+    {
+        size_t length = strlen(word);
+        if (text->compare(at, length, word) != 0) return false;
+        at += length;
+        return true;
+    }
+
+    bool value(JsonValue &out, int depth)
+    {
+        if (depth > 64) return fail("nested too deeply");
+        skipSpace();
+        if (at >= text->size()) return fail("unexpected end of file");
+        out.line = line;
+        char c = (*text)[at];
+        if (c == '{') return object(out, depth);
+        if (c == '[') return array(out, depth);
+        if (c == '"')
+        {
+            out.type = JsonValue::String;
+            return string(out.string);
+        }
+        if (literal("true")) { out.type = JsonValue::Bool; out.boolean = true; return true; }
+        if (literal("false")) { out.type = JsonValue::Bool; out.boolean = false; return true; }
+        if (literal("null")) { out.type = JsonValue::Null; return true; }
+        return number(out);
+    }
+
+    // JSON's grammar only, checked before strtod sees it: strtod alone also takes inf, nan, hex
+    // and a leading '+'
+    bool number(JsonValue &out)
+    {
+        const char *start = text->c_str() + at;
+        const char *p = start;
+        auto digits = [&p]
+        {
+            const char *first = p;
+            while (*p >= '0' && *p <= '9') p++;
+            return p != first;
+        };
+        if (*p == '-') p++;
+        if (*p == '0') p++;
+        else if (!digits()) return fail(std::string("unexpected '") + *start + "'");
+        if (*p == '.')
+        {
+            p++;
+            if (!digits()) return fail("expected digits after '.'");
+        }
+        if (*p == 'e' || *p == 'E')
+        {
+            p++;
+            if (*p == '+' || *p == '-') p++;
+            if (!digits()) return fail("expected digits in the exponent");
+        }
+        out.number = strtod(std::string(start, p).c_str(), nullptr);
+        if (!std::isfinite(out.number)) return fail("number out of range");
+        out.type = JsonValue::Number;
+        at += p - start;
+        return true;
+    }
+
+    bool object(JsonValue &out, int depth)
+    {
+        out.type = JsonValue::Object;
+        at++;
+        skipSpace();
+        if (at < text->size() && (*text)[at] == '}') { at++; return true; }
+        for (;;)
+        {
+            skipSpace();
+            std::string key;
+            if (at >= text->size() || (*text)[at] != '"') return fail("expected a key");
+            if (!string(key)) return false;
+            skipSpace();
+            if (at >= text->size() || (*text)[at] != ':') return fail("expected ':' after \"" + key + "\"");
+            at++;
+            out.members.emplace_back(key, JsonValue());
+            if (!value(out.members.back().second, depth + 1)) return false;
+            skipSpace();
+            if (at < text->size() && (*text)[at] == ',') { at++; continue; }
+            if (at < text->size() && (*text)[at] == '}') { at++; return true; }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    bool array(JsonValue &out, int depth)
+    {
+        out.type = JsonValue::Array;
+        at++;
+        skipSpace();
+        if (at < text->size() && (*text)[at] == ']') { at++; return true; }
+        for (;;)
+        {
+            out.items.emplace_back();
+            if (!value(out.items.back(), depth + 1)) return false;
+            skipSpace();
+            if (at < text->size() && (*text)[at] == ',') { at++; continue; }
+            if (at < text->size() && (*text)[at] == ']') { at++; return true; }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool string(std::string &out)
+    {
+        at++; // opening quote
+        while (at < text->size())
+        {
+            char c = (*text)[at++];
+            if (c == '"') return true;
+            if (c == '\n') return fail("unterminated string");
+            if (c != '\\') { out += c; continue; }
+            if (at >= text->size()) break;
+            char escape = (*text)[at++];
+            switch (escape)
+            {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u':
+                if (at + 4 > text->size()) return fail("bad \\u escape");
+                out += (char)strtol(text->substr(at, 4).c_str(), nullptr, 16);
+                at += 4;
+                break;
+            default: out += escape; break; // \" \\ \/
+            }
+        }
+        return fail("unterminated string");
+    }
+};
+
+// what a scene file loads and where it puts it. the file is JSON:
+//   {
+//     "shaders": "../shaders",                       directory of the renderer's programs
+//     "skybox": "../models/textures/Cubemaps",       directory of right.jpg, left.jpg, ...
+//     "camera": { "position": [0, 0, -35] },
+//     "models": [ { "name": "house", "path": "../models/house.obj", "bundle": "house", "animated": false } ],
+//     "animations": [ { "name": "sitting", "path": "../models/Sitting.dae", "model": "character" } ],
+//     "instances": [ { "model": "house", "position": [0, 0, 1], "rotation": [0, 90, 0], "scale": 1,
+//                      "grid": { "rows": 4, "columns": 4, "spacing": 40 } } ],
+//     "sun": { "position": [0, 200, 100], "direction": [1, 1, 1], "color": [1, 1, 1],
+//              "ambient": 0.55, "diffuse": 0.25, "specular": 0 }
+//   }
+// relative paths are taken from the scene file's directory. "bundle" is the entry name used with
+// --bundle (the model's name by default). rotation is in degrees, applied z, then x, then y. an
+// instance with a grid is repeated rows x columns times, centred on its position, which is how
+// benchmark scenes get thousands of instances. everything but the models and instances has a
+// default (the directories are the ones above); unknown keys are reported and skipped
+struct SceneModel
+{
+    std::string name, path, bundleName;
+    bool animated = false;
+};
+
+struct SceneAnimation
+{
+    std::string name, path;
+    int model = -1;
+};
+
+struct SceneSun
+{
+    glm::vec3 position = glm::vec3(0.0f, 200.0f, 100.0f);
+    glm::vec3 direction = glm::vec3(1.0f);
+    glm::vec3 color = glm::vec3(1.0f);
+    float ambient = 0.55f, diffuse = 0.25f, specular = 0.0f;
+};
+
+class Scene
+{
+public:
+    std::string path;
+    std::string shaderDirectory, skyboxDirectory;
+    glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, -35.0f);
+    std::vector<SceneModel> models;
+    std::vector<SceneAnimation> animations;
+    // instance transforms grouped by model, in file order: one contiguous array per model
+    std::vector<std::vector<glm::mat4>> instances;
+    SceneSun sun;
+
+    bool Load(const std::string &scenePath)
+    {
+        path = scenePath;
+        std::ifstream file(scenePath);
+        if (!file)
+        {
+            std::cout << "ERROR::SCENE::CANNOT_OPEN: " << scenePath << std::endl;
+            return false;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        JsonValue root;
+        JsonReader reader;
+        if (!reader.Parse(contents.str(), root))
+        {
+            std::cout << "ERROR::SCENE::PARSE: " << scenePath << ", " << reader.Error() << std::endl;
+            return false;
+        }
+        size_t slash = scenePath.find_last_of("/\\");
+        directory = slash == std::string::npos ? "" : scenePath.substr(0, slash + 1);
+        errors = 0;
+        read(root);
+        return errors == 0;
+    }
+
+    int FindModel(const std::string &name) const
+    {
+        for (size_t i = 0; i < models.size(); i++)
+            if (models[i].name == name) return (int)i;
+        return -1;
+    }
+
+    size_t InstanceCount() const
+    {
+        size_t count = 0;
+        for (const std::vector<glm::mat4> &transforms : instances) count += transforms.size();
+        return count;
+    }
+
+private:
+    std::string directory;
+    int errors = 0;
+
+    void report(const char *kind, const std::string &where, const JsonValue &value, const std::string &what)
+    {
+        std::cout << "ERROR::SCENE::" << kind << ": " << path << ":" << value.line << " " << where << ": " << what << std::endl;
+        errors++;
+    }
+
+    // keys other than known are most likely typos; they are reported but don't fail the load
+    void checkKeys(const JsonValue &object, const std::string &where, std::initializer_list<const char *> known)
+    {
+        for (const std::pair<std::string, JsonValue> &member : object.members)
+        {
+            bool found = false;
+            for (const char *key : known) found = found || member.first == key;
+            if (!found)
+                std::cout << "ERROR::SCENE::UNKNOWN_KEY: " << path << ":" << member.second.line << " " << where << ": \""
+                          << member.first << "\" is ignored" << std::endl;
+        }
+    }
+
+    std::string resolve(const std::string &file) const
+    {
+        if (file.empty() || file[0] == '/' || file.find(':') != std::string::npos) return file;
+        return directory + file;
+    }
+
+    bool readString(const JsonValue &object, const char *key, const std::string &where, std::string &out, bool required = false)
+    {
+        const JsonValue *value = object.Find(key);
+        if (!value)
+        {
+            if (required) report("MISSING", where, object, std::string("\"") + key + "\" is required");
+            return false;
+        }
+        if (value->type != JsonValue::String)
+        {
+            report("BAD_VALUE", where + "." + key, *value, "expected a string");
+            return false;
+        }
+        out = value->string;
+        return true;
+    }
+
+    void readFloat(const JsonValue &object, const char *key, const std::string &where, float &out)
+    {
+        const JsonValue *value = object.Find(key);
+        if (!value) return;
+        if (value->type != JsonValue::Number) return report("BAD_VALUE", where + "." + key, *value, "expected a number");
+        out = (float)value->number;
+    }
+
+    void readInt(const JsonValue &object, const char *key, const std::string &where, int &out)
+    {
+        float number = (float)out;
+        readFloat(object, key, where, number);
+        out = (int)number;
+    }
+
+    void readBool(const JsonValue &object, const char *key, const std::string &where, bool &out)
+    {
+        const JsonValue *value = object.Find(key);
+        if (!value) return;
+        if (value->type != JsonValue::Bool) return report("BAD_VALUE", where + "." + key, *value, "expected true or false");
+        out = value->boolean;
+    }
+
+    // [x, y, z]; a single number is taken for all three where allowScalar
+    void readVec3(const JsonValue &object, const char *key, const std::string &where, glm::vec3 &out, bool allowScalar = false)
+    {
+        const JsonValue *value = object.Find(key);
+        if (!value) return;
+        if (allowScalar && value->type == JsonValue::Number)
+        {
+            out = glm::vec3((float)value->number);
+            return;
+        }
+        bool ok = value->type == JsonValue::Array && value->items.size() == 3;
+        for (size_t i = 0; ok && i < 3; i++) ok = value->items[i].type == JsonValue::Number;
+        if (!ok) return report("BAD_VALUE", where + "." + key, *value, allowScalar ? "expected a number or 3 numbers" : "expected 3 numbers");
+        out = glm::vec3((float)value->items[0].number, (float)value->items[1].number, (float)value->items[2].number);
+    }
+
+    const JsonValue *readArray(const JsonValue &root, const char *key, bool required)
+    {
+        const JsonValue *value = root.Find(key);
+        if (!value)
+        {
+            if (required) report("MISSING", "scene", root, std::string("\"") + key + "\" is required");
+            return nullptr;
+        }
+        if (value->type != JsonValue::Array)
+        {
+            report("BAD_VALUE", key, *value, "expected an array");
+            return nullptr;
+        }
+        return value;
+    }
+
+    void read(const JsonValue &root)
+    {
+        if (root.type != JsonValue::Object) return report("BAD_VALUE", "scene", root, "expected an object");
+        checkKeys(root, "scene", { "shaders", "skybox", "camera", "models", "animations", "instances", "sun" });
+        // by default the scene sits in res/scenes, next to res/shaders and res/models
+        shaderDirectory = resolve("../shaders");
+        skyboxDirectory = resolve("../models/textures/Cubemaps");
+        if (readString(root, "shaders", "scene", shaderDirectory)) shaderDirectory = resolve(shaderDirectory);
+        if (readString(root, "skybox", "scene", skyboxDirectory)) skyboxDirectory = resolve(skyboxDirectory);
+        if (const JsonValue *camera = root.Find("camera"))
+        {
+            checkKeys(*camera, "camera", { "position" });
+            readVec3(*camera, "position", "camera", cameraPosition);
+        }
+
+        if (const JsonValue *list = readArray(root, "models", true))
+            for (size_t i = 0; i < list->items.size(); i++)
+            {
+                const JsonValue &entry = list->items[i];
+                std::string where = "models[" + std::to_string(i) + "]";
+                checkKeys(entry, where, { "name", "path", "bundle", "animated" });
+                SceneModel model;
+                readString(entry, "name", where, model.name, true);
+                if (readString(entry, "path", where, model.path, true)) model.path = resolve(model.path);
+                if (!readString(entry, "bundle", where, model.bundleName)) model.bundleName = model.name;
+                readBool(entry, "animated", where, model.animated);
+                if (FindModel(model.name) >= 0) report("DUPLICATE", where, entry, "model \"" + model.name + "\" is already defined");
+                models.push_back(model);
+            }
+        instances.assign(models.size(), std::vector<glm::mat4>());
+
+        if (const JsonValue *list = readArray(root, "animations", false))
+            for (size_t i = 0; i < list->items.size(); i++)
+            {
+                const JsonValue &entry = list->items[i];
+                std::string where = "animations[" + std::to_string(i) + "]";
+                checkKeys(entry, where, { "name", "path", "model" });
+                SceneAnimation animation;
+                std::string model;
+                readString(entry, "name", where, animation.name, true);
+                if (readString(entry, "path", where, animation.path, true)) animation.path = resolve(animation.path);
+                if (readString(entry, "model", where, model, true) && (animation.model = FindModel(model)) < 0)
+                    report("BAD_VALUE", where + ".model", entry, "no model named \"" + model + "\"");
+                animations.push_back(animation);
+            }
+
+        if (const JsonValue *list = readArray(root, "instances", true))
+            for (size_t i = 0; i < list->items.size(); i++)
+                readInstance(list->items[i], "instances[" + std::to_string(i) + "]");
+
+        if (const JsonValue *light = root.Find("sun"))
+        {
+            checkKeys(*light, "sun", { "position", "direction", "color", "ambient", "diffuse", "specular" });
+            readVec3(*light, "position", "sun", sun.position);
+            readVec3(*light, "direction", "sun", sun.direction);
+            readVec3(*light, "color", "sun", sun.color);
+            readFloat(*light, "ambient", "sun", sun.ambient);
+            readFloat(*light, "diffuse", "sun", sun.diffuse);
+            readFloat(*light, "specular", "sun", sun.specular);
+        }
+    }
+
+    void readInstance(const JsonValue &entry, const std::string &where)
+    {
+        checkKeys(entry, where, { "model", "position", "rotation", "scale", "grid" });
+        std::string name;
+        if (!readString(entry, "model", where, name, true)) return;
+        int model = FindModel(name);
+        if (model < 0) return report("BAD_VALUE", where + ".model", entry, "no model named \"" + name + "\"");
+
+        glm::vec3 position(0.0f), rotation(0.0f), scale(1.0f);
+        readVec3(entry, "position", where, position);
+        readVec3(entry, "rotation", where, rotation);
+        readVec3(entry, "scale", where, scale, true);
+        glm::mat4 local(1.0f);
+        local = glm::rotate(local, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+        local = glm::rotate(local, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+        local = glm::rotate(local, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+        local = glm::scale(local, scale);
+
+        int rows = 1, columns = 1;
+        float spacing = 0.0f;
+        const JsonValue *grid = entry.Find("grid");
+        if (grid)
+        {
+            checkKeys(*grid, where + ".grid", { "rows", "columns", "spacing" });
+            readInt(*grid, "rows", where + ".grid", rows);
+            readInt(*grid, "columns", where + ".grid", columns);
+            readFloat(*grid, "spacing", where + ".grid", spacing);
+            if (rows < 1 || columns < 1) return report("BAD_VALUE", where + ".grid", *grid, "rows and columns must be at least 1");
+        }
+        std::vector<glm::mat4> &transforms = instances[model];
+        if ((size_t)rows * columns > SCENE_MAX_INSTANCES - transforms.size())
+            return report("BAD_VALUE", grid ? where + ".grid" : where, grid ? *grid : entry, "more than " + std::to_string(SCENE_MAX_INSTANCES) +
+                          " instances of \"" + name + "\"");
+        transforms.reserve(transforms.size() + (size_t)rows * columns);
+        for (int r = 0; r < rows; r++)
+            for (int c = 0; c < columns; c++)
+            {
+                glm::vec3 offset((c - (columns - 1) * 0.5f) * spacing, 0.0f, (r - (rows - 1) * 0.5f) * spacing);
+                transforms.push_back(glm::translate(glm::mat4(1.0f), position + offset) * local);
+            }
+    }
+};
+
+#endif
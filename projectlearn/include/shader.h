@@ -4,71 +4,60 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gl_extensions.h"
+
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 class Shader
 {
 public:
     unsigned int ID;
+    // kept so the program can be rebuilt when the files change (see shader_reload.h)
+    std::string vertexPath;
+    std::string fragmentPath;
+    // outputs captured with transform feedback (vertex-only programs, see skinning.h)
+    std::vector<std::string> feedbackVaryings;
+    // startup bookkeeping: how long this program took to become usable, and how long a
+    // full compile+link of the same sources took (measured now, or remembered by the cache)
+    float loadMs = 0.0f;
+    float compileMs = 0.0f;
+    bool fromCache = false;
+
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        build();
+    }
+    // vertex-only program whose outputs are written to a buffer instead of being rasterized;
+    // the varyings are captured interleaved, in the order given
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const std::vector<std::string>& feedbackVaryings)
+        : vertexPath(vertexPath), feedbackVaryings(feedbackVaryings)
+    {
+        build();
+    }
 
+    // where linked program binaries are kept between runs; change before creating any Shader
+    // ------------------------------------------------------------------------
+    static std::string& CacheDirectory()
+    {
+        static std::string directory = "shader_cache";
+        return directory;
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -136,9 +125,224 @@ public:
     }
 
 private:
+    friend class ShaderReloader;
+
+    // takes ownership of a program that finished linking elsewhere and releases the old one.
+    // only called from the thread that owns the context, between frames
+    void adopt(GLuint program, const std::string &vertexCode, const std::string &fragmentCode, float compileTime)
+    {
+        glDeleteProgram(ID);
+        ID = program;
+        compileMs = compileTime;
+        fromCache = false;
+        saveBinary(cacheKey(vertexCode, fragmentCode));
+    }
+
+    // reads the sources, then links from the binary cache or compiles from scratch
+    void build()
+    {
+        auto start = std::chrono::steady_clock::now();
+        // 1. retrieve the vertex/fragment source code from filePath
+        std::string vertexCode = readSource(vertexPath.c_str());
+        std::string fragmentCode = fragmentPath.empty() ? std::string() : readSource(fragmentPath.c_str());
+
+        // 2. try the program binary cache before paying for a compile
+        uint64_t key = cacheKey(vertexCode, fragmentCode);
+        ID = glCreateProgram();
+        fromCache = loadBinary(key);
+        if (!fromCache)
+        {
+            auto compileStart = std::chrono::steady_clock::now();
+            compile(vertexCode, fragmentCode);
+            compileMs = elapsedMs(compileStart);
+            saveBinary(key);
+        }
+        loadMs = elapsedMs(start);
+    }
+
+    struct BinaryHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+        float compileMs;
+    };
+    static const uint32_t BINARY_MAGIC = 0x4250484D; // "MHPB"
+    static const uint32_t BINARY_VERSION = 1;
+
+    static std::string readSource(const char* path)
+    {
+        std::ifstream file;
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try 
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+        }
+        return std::string();
+    }
+
+    static float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 64-bit FNV-1a over both sources and the driver identity, so editing a shader or
+    // updating the driver produces a different key and the stale binary is never touched
+    uint64_t cacheKey(const std::string &vertexCode, const std::string &fragmentCode) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const char *data, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= (unsigned char)data[i];
+                hash *= 1099511628211ull;
+            }
+            hash ^= 0xff; // separator, so "ab"+"c" and "a"+"bc" hash differently
+            hash *= 1099511628211ull;
+        };
+        mix(vertexCode.data(), vertexCode.size());
+        mix(fragmentCode.data(), fragmentCode.size());
+        for (const std::string &varying : feedbackVaryings)
+            mix(varying.data(), varying.size());
+        const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (GLenum name : strings)
+        {
+            const char *value = reinterpret_cast<const char *>(glGetString(name));
+            if (value) mix(value, std::strlen(value));
+        }
+        return hash;
+    }
+
+    static std::string cachePath(uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+        return CacheDirectory() + name;
+    }
+
+    void compile(const std::string &vertexCode, const std::string &fragmentCode)
+    {
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        unsigned int vertex, fragment = 0;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        if (!fragmentCode.empty())
+        {
+            fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fShaderCode, NULL);
+            glCompileShader(fragment);
+            checkCompileErrors(fragment, "FRAGMENT");
+        }
+        // shader Program
+        if (GLExt().programBinary)
+            GLExt().ProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(ID, vertex);
+        if (fragment) glAttachShader(ID, fragment);
+        setFeedbackVaryings(ID);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDetachShader(ID, vertex);
+        glDeleteShader(vertex);
+        if (fragment)
+        {
+            glDetachShader(ID, fragment);
+            glDeleteShader(fragment);
+        }
+    }
+
+    // must happen before linking
+    void setFeedbackVaryings(GLuint program) const
+    {
+        if (feedbackVaryings.empty()) return;
+        std::vector<const char *> names;
+        for (const std::string &varying : feedbackVaryings)
+            names.push_back(varying.c_str());
+        glTransformFeedbackVaryings(program, (GLsizei)names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+
+    bool loadBinary(uint64_t key)
+    {
+        if (!GLExt().programBinary) return false;
+        std::ifstream file(cachePath(key), std::ios::binary);
+        if (!file) return false;
+
+        BinaryHeader header;
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+        if (header.magic != BINARY_MAGIC || header.version != BINARY_VERSION || header.key != key || header.length == 0)
+            return false;
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size())) return false;
+
+        GLExt().ProgramBinary(ID, header.format, binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            // the driver rejected its own binary (e.g. silent driver update); start from a
+            // fresh program object and let the caller recompile and overwrite the entry
+            glDeleteProgram(ID);
+            ID = glCreateProgram();
+            return false;
+        }
+        compileMs = header.compileMs;
+        return true;
+    }
+
+    void saveBinary(uint64_t key)
+    {
+        if (!GLExt().programBinary) return;
+        GLint success = 0, length = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!success || length <= 0) return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        GLExt().GetProgramBinary(ID, length, &written, &format, binary.data());
+        if (written <= 0) return;
+
+#ifdef _WIN32
+        _mkdir(CacheDirectory().c_str());
+#else
+        mkdir(CacheDirectory().c_str(), 0755);
+#endif
+        // write to a temporary name first so a crash never leaves a truncated entry behind
+        std::string path = cachePath(key);
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file) return;
+            BinaryHeader header = { BINARY_MAGIC, BINARY_VERSION, key, format, (uint32_t)written, compileMs };
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(binary.data(), written);
+            if (!file) return;
+        }
+        std::remove(path.c_str());
+        std::rename(temporary.c_str(), path.c_str());
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -160,6 +364,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
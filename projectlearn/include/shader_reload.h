@@ -0,0 +1,382 @@
+#ifndef SHADER_RELOAD_H
+#define SHADER_RELOAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "gl_extensions.h"
+#include "shader.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+// reports which watched files changed since the last call to Changes().
+// linux uses inotify on the parent directories (editors usually save by writing a temporary
+// file and renaming it over the original, which a watch on the file itself would miss);
+// every other platform falls back to comparing modification times twice a second.
+class ShaderWatcher
+{
+public:
+    ShaderWatcher()
+    {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            std::cout << "ERROR::SHADER_WATCHER::INOTIFY_INIT_FAILED, falling back to polling" << std::endl;
+#endif
+    }
+
+    ~ShaderWatcher()
+    {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    void Add(const std::string &path)
+    {
+        if (files.count(path)) return;
+        files[path] = modificationTime(path);
+#ifdef __linux__
+        if (fd < 0) return;
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+        int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd < 0)
+            std::cout << "ERROR::SHADER_WATCHER::CANNOT_WATCH: " << directory << std::endl;
+        else
+            directories[wd] = directory;
+#endif
+    }
+
+    // never blocks; returns every watched path touched since the previous call
+    std::set<std::string> Changes()
+    {
+        std::set<std::string> changed;
+#ifdef __linux__
+        if (fd >= 0)
+        {
+            alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *ptr = buffer; ptr < buffer + length;)
+                {
+                    const inotify_event *event = reinterpret_cast<const inotify_event *>(ptr);
+                    auto dir = directories.find(event->wd);
+                    if (dir != directories.end() && event->len > 0)
+                    {
+                        std::string path = dir->second + "/" + event->name;
+                        if (files.count(path)) changed.insert(path);
+                    }
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+            return changed;
+        }
+#endif
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastPoll < std::chrono::milliseconds(500)) return changed;
+        lastPoll = now;
+        for (auto &file : files)
+        {
+            long long time = modificationTime(file.first);
+            if (time != file.second)
+            {
+                file.second = time;
+                changed.insert(file.first);
+            }
+        }
+        return changed;
+    }
+
+private:
+    std::map<std::string, long long> files;
+    std::chrono::steady_clock::time_point lastPoll;
+#ifdef __linux__
+    int fd = -1;
+    std::map<int, std::string> directories;
+#endif
+
+    static long long modificationTime(const std::string &path)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) return 0;
+        return (long long)info.st_mtime;
+    }
+};
+
+// rebuilds watched shaders when their sources change, without ever stalling the frame loop.
+// with KHR_parallel_shader_compile the driver compiles on its own threads and Poll() checks
+// GL_COMPLETION_STATUS_KHR; otherwise a worker thread owning a hidden context that shares
+// objects with the main window does the blocking compile+link and signals a fence.
+// either way the new program only replaces Shader::ID after it linked successfully, so a
+// typo in lighting.fs leaves the last good program on screen.
+class ShaderReloader
+{
+public:
+    ShaderReloader(GLFWwindow *mainWindow)
+    {
+        parallel = GLExt().parallelShaderCompile;
+        if (parallel) return;
+
+        // windows (and their contexts) have to be created on the main thread
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        workerWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, mainWindow);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!workerWindow)
+        {
+            std::cout << "ERROR::SHADER_RELOADER::SHARED_CONTEXT_FAILED, shaders will not hot-reload" << std::endl;
+            return;
+        }
+        worker = std::thread(&ShaderReloader::workerLoop, this);
+    }
+
+    ~ShaderReloader()
+    {
+        Shutdown();
+    }
+
+    // joins the worker and releases pending programs; must run before glfwTerminate
+    void Shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+        if (workerWindow) glfwDestroyWindow(workerWindow);
+        workerWindow = nullptr;
+        for (Build &build : building)
+        {
+            if (build.fence) glDeleteSync(build.fence);
+            if (build.program) glDeleteProgram(build.program);
+        }
+        for (Build &build : finished)
+        {
+            if (build.fence) glDeleteSync(build.fence);
+            if (build.program) glDeleteProgram(build.program);
+        }
+        building.clear();
+        finished.clear();
+    }
+
+    void Watch(Shader &shader)
+    {
+        shaders.push_back(&shader);
+        watcher.Add(shader.vertexPath);
+        if (!shader.fragmentPath.empty())
+            watcher.Add(shader.fragmentPath);
+    }
+
+    // call once per frame on the thread that owns the main context
+    void Poll()
+    {
+        for (const std::string &path : watcher.Changes())
+            for (Shader *shader : shaders)
+                if (shader->vertexPath == path || shader->fragmentPath == path)
+                    dirty.insert(shader);
+
+        // start at most one build per shader; edits that land mid-build are picked up afterwards
+        for (auto it = dirty.begin(); it != dirty.end();)
+        {
+            if (inFlight.count(*it)) { ++it; continue; }
+            start(*it);
+            it = dirty.erase(it);
+        }
+
+        if (parallel)
+            pollParallel();
+        else
+            pollWorker();
+    }
+
+private:
+    struct Build
+    {
+        Shader *shader = nullptr;
+        std::string vertexCode;
+        std::string fragmentCode;
+        GLuint vertex = 0, fragment = 0, program = 0;
+        GLsync fence = 0;
+        bool success = false;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    ShaderWatcher watcher;
+    std::vector<Shader *> shaders;
+    std::set<Shader *> dirty;
+    std::set<Shader *> inFlight;
+    bool parallel = false;
+
+    // parallel-compile builds, and worker builds whose fence has not signalled yet
+    std::vector<Build> building;
+
+    // worker handoff
+    GLFWwindow *workerWindow = nullptr;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Build> queued;
+    std::vector<Build> finished;
+    bool quit = false;
+
+    void start(Shader *shader)
+    {
+        Build build;
+        build.shader = shader;
+        build.vertexCode = Shader::readSource(shader->vertexPath.c_str());
+        if (!shader->fragmentPath.empty())
+            build.fragmentCode = Shader::readSource(shader->fragmentPath.c_str());
+        build.started = std::chrono::steady_clock::now();
+        // a half-written file shows up as empty; the next write event will retry
+        if (build.vertexCode.empty() || (!shader->fragmentPath.empty() && build.fragmentCode.empty())) return;
+
+        if (parallel)
+        {
+            submit(build);
+            building.push_back(build);
+            inFlight.insert(shader);
+        }
+        else if (workerWindow)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued.push_back(build);
+            }
+            wake.notify_one();
+            inFlight.insert(shader);
+        }
+    }
+
+    // issues compile and link; with parallel compile these calls return immediately
+    static void submit(Build &build)
+    {
+        const char *vShaderCode = build.vertexCode.c_str();
+        const char *fShaderCode = build.fragmentCode.c_str();
+        build.vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(build.vertex, 1, &vShaderCode, NULL);
+        glCompileShader(build.vertex);
+        if (!build.fragmentCode.empty())
+        {
+            build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(build.fragment, 1, &fShaderCode, NULL);
+            glCompileShader(build.fragment);
+        }
+        build.program = glCreateProgram();
+        if (GLExt().programBinary)
+            GLExt().ProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(build.program, build.vertex);
+        if (build.fragment) glAttachShader(build.program, build.fragment);
+        build.shader->setFeedbackVaryings(build.program);
+        glLinkProgram(build.program);
+    }
+
+    // only valid once the link has completed, otherwise the status queries block
+    static void collect(Build &build)
+    {
+        bool vertexOk = build.shader->checkCompileErrors(build.vertex, "VERTEX");
+        bool fragmentOk = !build.fragment || build.shader->checkCompileErrors(build.fragment, "FRAGMENT");
+        build.success = vertexOk && fragmentOk && build.shader->checkCompileErrors(build.program, "PROGRAM");
+        glDetachShader(build.program, build.vertex);
+        glDeleteShader(build.vertex);
+        if (build.fragment)
+        {
+            glDetachShader(build.program, build.fragment);
+            glDeleteShader(build.fragment);
+        }
+        build.vertex = build.fragment = 0;
+    }
+
+    void finish(Build &build)
+    {
+        inFlight.erase(build.shader);
+        if (build.success)
+        {
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - build.started).count();
+            build.shader->adopt(build.program, build.vertexCode, build.fragmentCode, ms);
+            std::cout << "Reloaded shader " << build.shader->vertexPath << " " << build.shader->fragmentPath
+                      << " (" << ms << " ms)" << std::endl;
+        }
+        else
+        {
+            glDeleteProgram(build.program);
+            std::cout << "ERROR::SHADER_RELOADER::KEEPING_PREVIOUS_PROGRAM for " << build.shader->vertexPath << std::endl;
+        }
+        build.program = 0;
+    }
+
+    void pollParallel()
+    {
+        for (size_t i = 0; i < building.size();)
+        {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(building[i].program, GL_COMPLETION_STATUS_KHR, &complete);
+            if (!complete) { i++; continue; }
+            collect(building[i]);
+            finish(building[i]);
+            building.erase(building.begin() + i);
+        }
+    }
+
+    void pollWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Build &build : finished) building.push_back(build);
+            finished.clear();
+        }
+        for (size_t i = 0; i < building.size();)
+        {
+            // a zero timeout turns the fence into a non-blocking query
+            GLenum state = glClientWaitSync(building[i].fence, 0, 0);
+            if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) { i++; continue; }
+            glDeleteSync(building[i].fence);
+            building[i].fence = 0;
+            finish(building[i]);
+            building.erase(building.begin() + i);
+        }
+    }
+
+    void workerLoop()
+    {
+        glfwMakeContextCurrent(workerWindow);
+        for (;;)
+        {
+            Build build;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return quit || !queued.empty(); });
+                if (quit) break;
+                build = queued.front();
+                queued.pop_front();
+            }
+            submit(build);
+            collect(build);
+            // objects are shared, but the main context may only use them once this context's
+            // commands have executed; the fence tells it when
+            build.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(build);
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+};
+
+#endif
@@ -0,0 +1,324 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "model.h"
+#include "Animator.h"
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+// skins an animated model once per frame. skinning.vs runs over every vertex as GL_POINTS
+// with rasterization disabled and transform feedback writes the model-space position and
+// normal into each mesh's skinnedVBO. afterwards the model draws like static geometry, so
+// shadow, depth and colour passes all reuse the same result instead of re-skinning.
+class SkinningPass
+{
+public:
+    static const int MAX_BONES = 100; // must match skinning.vs
+    Shader shader;
+
+    SkinningPass(const char *vertexPath)
+        : shader(vertexPath, std::vector<std::string>{ "skinnedPosition", "skinnedNormal" })
+    {
+        lookupUniforms();
+    }
+
+    // allocates the feedback buffers; the model draws skinned from then on
+    void Prepare(Model &model)
+    {
+        for (Mesh &mesh : model.meshes)
+            mesh.setupSkinnedBuffers();
+    }
+
+    // linear blend skinning, for a pass built from skinning.vs
+    void Run(Model &model, Span<glm::mat4> bones)
+    {
+        // no pose yet: the skinned buffers keep what they hold
+        if (bones.empty()) return;
+        shader.use();
+        lookupUniforms();
+        // one upload for the whole palette instead of a glUniform call per bone
+        glUniformMatrix4fv(bonesLocation, clampBones(bones.size()), GL_FALSE, &bones[0][0][0]);
+        skin(model);
+    }
+
+    // dual quaternion skinning, for a pass built from skinning_dq.vs; half the bytes per bone
+    void Run(Model &model, Span<DualQuat> bones, float scale)
+    {
+        if (bones.empty()) return;
+        shader.use();
+        lookupUniforms();
+        glUniform4fv(dualQuatLocation, 2 * clampBones(bones.size()), &bones[0].real[0]);
+        glUniform1f(scaleLocation, scale);
+        skin(model);
+    }
+
+private:
+    GLint bonesLocation = -1;
+    GLint dualQuatLocation = -1;
+    GLint scaleLocation = -1;
+    GLuint boundProgram = 0;
+
+    // the program may have been hot-reloaded since the last frame
+    void lookupUniforms()
+    {
+        if (boundProgram == shader.ID) return;
+        bonesLocation = glGetUniformLocation(shader.ID, "finalBonesMatrices");
+        dualQuatLocation = glGetUniformLocation(shader.ID, "finalBonesDQ");
+        scaleLocation = glGetUniformLocation(shader.ID, "boneScale");
+        boundProgram = shader.ID;
+    }
+
+    static GLsizei clampBones(size_t count)
+    {
+        return (GLsizei)(count < (size_t)MAX_BONES ? count : (size_t)MAX_BONES);
+    }
+
+    void skin(Model &model)
+    {
+        glEnable(GL_RASTERIZER_DISCARD);
+        for (Mesh &mesh : model.meshes)
+        {
+            if (!mesh.skinnedVBO) continue;
+            glBindVertexArray(mesh.VAO);
+            glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, mesh.skinnedVBO);
+            glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)mesh.vertexCount);
+            glEndTransformFeedback();
+        }
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+    }
+};
+
+// normal matrix for a model matrix, computed once per draw instead of once per vertex
+inline glm::mat3 NormalMatrix(const glm::mat4 &model)
+{
+    return glm::transpose(glm::inverse(glm::mat3(model)));
+}
+
+// CPU mirrors of skinning.vs and skinning_dq.vs, used to check one against the other
+inline glm::vec3 SkinLinear(const Vertex &vertex, Span<glm::mat4> bones)
+{
+    glm::vec4 total(0.0f);
+    float totalWeight = 0.0f;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        int id = vertex.m_BoneIDs[i];
+        if (id == -1) continue;
+        if (id >= SkinningPass::MAX_BONES || id >= (int)bones.size()) return vertex.Position;
+        total += bones[id] * glm::vec4(vertex.Position, 1.0f) * vertex.m_Weights[i];
+        totalWeight += vertex.m_Weights[i];
+    }
+    return totalWeight == 0.0f ? vertex.Position : glm::vec3(total);
+}
+
+inline glm::vec3 SkinDualQuat(const Vertex &vertex, Span<DualQuat> bones, float scale)
+{
+    glm::vec4 real(0.0f), dual(0.0f), pivot(0.0f);
+    bool hasPivot = false;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        int id = vertex.m_BoneIDs[i];
+        if (id == -1) continue;
+        if (id >= SkinningPass::MAX_BONES || id >= (int)bones.size()) return vertex.Position;
+        if (!hasPivot) { pivot = bones[id].real; hasPivot = true; }
+        float w = glm::dot(bones[id].real, pivot) < 0.0f ? -vertex.m_Weights[i] : vertex.m_Weights[i];
+        real += bones[id].real * w;
+        dual += bones[id].dual * w;
+    }
+    float len = glm::length(real);
+    if (len == 0.0f) return vertex.Position;
+    real /= len;
+    dual /= len;
+    glm::vec3 rv(real), dv(dual), p = vertex.Position * scale;
+    glm::vec3 rotated = p + 2.0f * glm::cross(rv, glm::cross(rv, p) + real.w * p);
+    glm::vec3 translation = 2.0f * (real.w * dv - dual.w * rv + glm::cross(rv, dv));
+    return rotated + translation;
+}
+
+// correctness check of the dual quaternion path against linear blend skinning over a whole
+// clip. vertices driven by a single bone must agree to float precision (both are then exact
+// rigid transforms); blended vertices legitimately differ near joints, so their deviation is
+// only reported. returns false when the rigid vertices disagree, or when the animator had to
+// fall back to linear skinning because the skeleton's scale isn't uniform.
+inline bool ValidateDualQuaternionSkinning(const std::vector<Vertex> &vertices, Animation &clip, int samples = 64)
+{
+    Animator linear(&clip), dualQuat(&clip);
+    dualQuat.SetSkinningMode(SkinningMode::DualQuaternion);
+
+    glm::vec3 low(1e30f), high(-1e30f);
+    for (const Vertex &vertex : vertices)
+    {
+        low = glm::min(low, vertex.Position);
+        high = glm::max(high, vertex.Position);
+    }
+    float size = glm::length(high - low);
+    if (size <= 0.0f) size = 1.0f;
+
+    // step in seconds so both animators visit the same key times
+    float step = clip.GetDuration() / clip.GetTicksPerSecond() / samples;
+    float rigidError = 0.0f, blendedError = 0.0f, blendedSquares = 0.0f;
+    size_t blendedCount = 0;
+    for (int s = 0; s < samples; s++)
+    {
+        linear.UpdateAnimation(step);
+        dualQuat.UpdateAnimation(step);
+        if (dualQuat.GetSkinningMode() != SkinningMode::DualQuaternion)
+        {
+            std::cout << "DQS vs LBS: dual quaternions fell back to linear skinning at sample " << s << " -> FAIL" << std::endl;
+            return false;
+        }
+        Span<glm::mat4> matrices = linear.GetFinalBoneMatrices();
+        Span<DualQuat> dqs = dualQuat.GetFinalBoneDualQuats();
+        float scale = dualQuat.GetPaletteScale();
+        for (const Vertex &vertex : vertices)
+        {
+            float error = glm::length(SkinLinear(vertex, matrices) - SkinDualQuat(vertex, dqs, scale)) / size;
+            int influences = 0;
+            float weight = 0.0f;
+            for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+                if (vertex.m_BoneIDs[i] != -1 && vertex.m_Weights[i] > 0.0f)
+                {
+                    influences++;
+                    weight += vertex.m_Weights[i];
+                }
+            // linear skinning does not renormalize weights, so only single bones weighted exactly 1 are rigid;
+            // anything less scales the vertex towards the origin and would be measured as error
+            if (influences == 1 && weight == 1.0f)
+                rigidError = std::max(rigidError, error);
+            else
+            {
+                blendedError = std::max(blendedError, error);
+                blendedSquares += error * error;
+                blendedCount++;
+            }
+        }
+    }
+
+    const float tolerance = 1e-4f; // relative to the model's bounding box diagonal
+    bool pass = rigidError <= tolerance;
+    std::cout << "DQS vs LBS over " << samples << " samples: rigid vertices max error " << rigidError * 100.0f
+              << "% of model size, blended vertices max " << blendedError * 100.0f << "% rms "
+              << (blendedCount ? std::sqrt(blendedSquares / blendedCount) * 100.0f : 0.0f) << "% -> "
+              << (pass ? "PASS" : "FAIL") << std::endl;
+    return pass;
+}
+
+// every vertex of the model's meshes
+inline bool ValidateDualQuaternionSkinning(Model &model, Animation &clip, int samples = 64)
+{
+    std::vector<Vertex> vertices;
+    for (const Mesh &mesh : model.meshes) vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    return ValidateDualQuaternionSkinning(vertices, clip, samples);
+}
+
+// --validate-skinning-synthetic: the same check without a window or any files, on a chain of
+// bones bending back and forth under a static root scaled to centimetres, skinning a tube
+// whose rings are rigid mid-bone and blended across the joints. a second run stretches one
+// bone along a single axis, which the animator must notice and hand back to linear skinning.
+// returns false when either goes wrong
+inline bool RunSkinningSelfTest()
+{
+    const int boneCount = 6, keys = 9, ringSides = 8, ringsPerBone = 8;
+    const float rootScale = 0.01f;
+
+    auto run = [&](bool stretch)
+    {
+        // root (static, scaled) -> bone0 -> bone1 -> ..., each bone one unit above its parent
+        aiNode root("root");
+        root.mTransformation.a1 = root.mTransformation.b2 = root.mTransformation.c3 = rootScale;
+        aiNode *parent = &root;
+        for (int b = 0; b < boneCount; b++)
+        {
+            aiNode *node = new aiNode("bone" + std::to_string(b));
+            node->mTransformation.b4 = b == 0 ? 0.0f : 1.0f;
+            node->mParent = parent;
+            parent->mNumChildren = 1;
+            parent->mChildren = new aiNode *[1]{ node };
+            parent = node;
+        }
+
+        // aiAnimation frees its channels, and they their keys
+        aiAnimation animation;
+        animation.mDuration = keys - 1;
+        animation.mTicksPerSecond = 1.0;
+        animation.mNumChannels = boneCount;
+        animation.mChannels = new aiNodeAnim *[boneCount];
+        for (int b = 0; b < boneCount; b++)
+        {
+            aiNodeAnim *channel = new aiNodeAnim();
+            channel->mNodeName = aiString("bone" + std::to_string(b));
+            channel->mNumPositionKeys = channel->mNumRotationKeys = channel->mNumScalingKeys = keys;
+            channel->mPositionKeys = new aiVectorKey[keys];
+            channel->mRotationKeys = new aiQuatKey[keys];
+            channel->mScalingKeys = new aiVectorKey[keys];
+            for (int k = 0; k < keys; k++)
+            {
+                channel->mPositionKeys[k].mTime = channel->mRotationKeys[k].mTime = channel->mScalingKeys[k].mTime = k;
+                channel->mPositionKeys[k].mValue = aiVector3D(0.0f, b == 0 ? 0.0f : 1.0f, 0.0f);
+                float angle = 0.7f * std::sin(k * 0.8f + b);
+                glm::quat q = glm::angleAxis(angle, glm::normalize(glm::vec3(0.3f * b, 0.2f, 1.0f)));
+                channel->mRotationKeys[k].mValue = aiQuaternion(q.w, q.x, q.y, q.z);
+                float stretched = stretch && b == boneCount / 2 && k % 2 ? 1.5f : 1.0f;
+                channel->mScalingKeys[k].mValue = aiVector3D(1.0f, stretched, 1.0f);
+            }
+            animation.mChannels[b] = channel;
+        }
+
+        // offsets leave the root's scale in the palette, as a centimetre rig's do
+        std::map<std::string, BoneInfo> boneInfoMap;
+        int ids = 0;
+        for (int b = 0; b < boneCount; b++)
+        {
+            BoneInfo &info = boneInfoMap["bone" + std::to_string(b)];
+            info.id = ids++;
+            info.offset = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -(float)b, 0.0f));
+        }
+        Animation clip(&animation, &root, boneInfoMap, ids);
+
+        std::vector<Vertex> vertices;
+        for (int b = 0; b < boneCount; b++)
+            for (int r = 0; r < ringsPerBone; r++)
+            {
+                float along = (r + 0.5f) / ringsPerBone; // 0 at the joint with the parent, 1 at the child's
+                for (int side = 0; side < ringSides; side++)
+                {
+                    Vertex vertex = {};
+                    float around = 6.2831853f * side / ringSides;
+                    vertex.Position = glm::vec3(0.3f * std::cos(around), b + along, 0.3f * std::sin(around));
+                    for (int i = 0; i < MAX_BONE_INFLUENCE; i++) vertex.m_BoneIDs[i] = -1;
+                    vertex.m_BoneIDs[0] = b;
+                    vertex.m_Weights[0] = 1.0f;
+                    // the quarter next to the parent is shared with it, up to half each at the joint
+                    if (b > 0 && along < 0.25f)
+                    {
+                        vertex.m_BoneIDs[1] = b - 1;
+                        vertex.m_Weights[1] = 0.5f - 2.0f * along;
+                        vertex.m_Weights[0] = 1.0f - vertex.m_Weights[1];
+                    }
+                    vertices.push_back(vertex);
+                }
+            }
+
+        std::cout << "  " << boneCount << " bones, " << vertices.size() << " vertices" << (stretch ? ", one bone stretched: " : ": ");
+        return ValidateDualQuaternionSkinning(vertices, clip);
+    };
+
+    std::cout << "Skinning self test, synthetic skeleton scaled by " << rootScale << std::endl;
+    bool uniform = run(false);
+    bool fellBack = !run(true);
+    std::cout << "  uniform scale " << (uniform ? "validated" : "FAILED") << ", non-uniform scale "
+              << (fellBack ? "fell back to linear" : "NOT DETECTED") << std::endl;
+    return uniform && fellBack;
+}
+
+#endif
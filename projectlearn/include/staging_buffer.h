@@ -0,0 +1,188 @@
+#ifndef STAGING_BUFFER_H
+#define STAGING_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+
+#include "gl_extensions.h"
+
+// ring of GPU-visible staging memory for uploads straight out of a mapped bundle. the source
+// is copied once, from the file mapping into the ring, and the GPU copies it on into the
+// destination buffer or texture. with ARB_buffer_storage the ring stays persistently mapped;
+// otherwise every write maps its range unsynchronized. either way the driver does no
+// tracking of its own, so each range carries a fence and is only rewritten after it signals.
+
+class StagingRing
+{
+public:
+    struct Stats
+    {
+        size_t bytesStaged = 0;
+        size_t bytesDirect = 0; // too large for the ring, handed to the driver as-is
+        int uploads = 0;
+        int fenceWaits = 0;
+        float waitMs = 0.0f;
+    };
+
+    explicit StagingRing(size_t capacity = 16 << 20) : capacity(capacity)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        persistent = GLExt().bufferStorage;
+        if (persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GLExt().BufferStorage(GL_COPY_READ_BUFFER, capacity, NULL, flags);
+            mapped = (uint8_t *)glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity, flags);
+            if (!mapped)
+            {
+                std::cout << "ERROR::STAGING::PERSISTENT_MAP_FAILED" << std::endl;
+                // storage is immutable now, start over with a plain buffer
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                persistent = false;
+            }
+        }
+        if (!persistent)
+            glBufferData(GL_COPY_READ_BUFFER, capacity, NULL, GL_STREAM_COPY);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    StagingRing(const StagingRing &) = delete;
+    StagingRing &operator=(const StagingRing &) = delete;
+
+    ~StagingRing()
+    {
+        Finish();
+        if (persistent)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+    // copies bytes from src into dst at dstOffset, in pieces of at most half the ring
+    void UploadBuffer(GLuint dst, size_t dstOffset, const void *src, size_t bytes)
+    {
+        const uint8_t *from = (const uint8_t *)src;
+        size_t piece = capacity / 2;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+        while (bytes)
+        {
+            size_t count = bytes < piece ? bytes : piece;
+            size_t offset = stage(from, count);
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, dstOffset, count);
+            retire(offset, count);
+            from += count;
+            dstOffset += count;
+            bytes -= count;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // pixel uploads: submit(pixels) issues the glTexImage/glCompressedTexImage call, with pixels
+    // an offset into the ring while it is bound as the unpack buffer
+    template <typename Submit>
+    void UploadPixels(const void *src, size_t bytes, Submit submit)
+    {
+        if (bytes > capacity / 2)
+        {
+            stats.bytesDirect += bytes;
+            submit(src);
+            return;
+        }
+        size_t offset = stage((const uint8_t *)src, bytes);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        submit((const void *)(uintptr_t)offset);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        retire(offset, bytes);
+    }
+
+    // blocks until every upload so far has been consumed by the GPU
+    void Finish()
+    {
+        while (!inFlight.empty()) waitOldest();
+    }
+
+    bool IsPersistent() const { return persistent; }
+    size_t Capacity() const { return capacity; }
+    const Stats &GetStats() const { return stats; }
+
+private:
+    struct Range
+    {
+        size_t begin, end;
+        GLsync fence;
+    };
+
+    size_t capacity;
+    GLuint buffer = 0;
+    uint8_t *mapped = nullptr;
+    bool persistent = false;
+    size_t head = 0;
+    std::deque<Range> inFlight;
+    Stats stats;
+
+    // reserves room at the head, waiting for the GPU where it still reads, and writes src there
+    size_t stage(const uint8_t *src, size_t bytes)
+    {
+        size_t offset = (head + 63) & ~size_t(63);
+        if (offset + bytes > capacity) offset = 0;
+        while (overlapsInFlight(offset, offset + bytes)) waitOldest();
+        head = offset + bytes;
+
+        if (persistent)
+            std::memcpy(mapped + offset, src, bytes);
+        else
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            void *range = glMapBufferRange(GL_COPY_READ_BUFFER, offset, bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (range) std::memcpy(range, src, bytes);
+            else std::cout << "ERROR::STAGING::MAP_FAILED" << std::endl;
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+        stats.bytesStaged += bytes;
+        stats.uploads++;
+        return offset;
+    }
+
+    void retire(size_t offset, size_t bytes)
+    {
+        inFlight.push_back({ offset, offset + bytes, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+    }
+
+    bool overlapsInFlight(size_t begin, size_t end) const
+    {
+        for (const Range &range : inFlight)
+            if (begin < range.end && range.begin < end) return true;
+        return false;
+    }
+
+    // fences signal in submission order, so the oldest range is always the next one free
+    void waitOldest()
+    {
+        Range range = inFlight.front();
+        inFlight.pop_front();
+        if (glClientWaitSync(range.fence, 0, 0) != GL_ALREADY_SIGNALED)
+        {
+            auto start = std::chrono::steady_clock::now();
+            while (glClientWaitSync(range.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+            stats.fenceWaits++;
+            stats.waitMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        glDeleteSync(range.fence);
+    }
+};
+
+#endif
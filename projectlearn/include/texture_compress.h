@@ -0,0 +1,260 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+// BC1 (DXT1) and BC3 (DXT5) block compression for the asset baker. this is the quick
+// bounding-box encoder: endpoints are the inset min/max of each 4x4 block along the box
+// diagonal that follows the block's colour correlation, then every texel picks the nearest
+// palette entry. good enough for albedo maps at a small fraction of a real encoder's cost.
+
+enum class TextureFormat : uint32_t
+{
+    RGBA8 = 0,
+    BC1 = 1, // opaque, 8 bytes per 4x4 block
+    BC3 = 2  // with alpha, 16 bytes per 4x4 block
+};
+
+struct CompressedMip
+{
+    uint32_t width, height;
+    std::vector<uint8_t> data;
+};
+
+inline uint16_t PackRGB565(int r, int g, int b)
+{
+    return (uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+inline void UnpackRGB565(uint16_t c, int rgb[3])
+{
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// block is 16 texels of RGBA8, row by row
+inline void CompressColorBlock(const uint8_t block[64], uint8_t out[8])
+{
+    int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 }, mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+        {
+            low[c] = std::min(low[c], (int)block[i * 4 + c]);
+            high[c] = std::max(high[c], (int)block[i * 4 + c]);
+            mean[c] += block[i * 4 + c];
+        }
+
+    // red and blue run against green in the block: use the anti-diagonal for that channel
+    int covRG = 0, covBG = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int g = block[i * 4 + 1] * 16 - mean[1];
+        covRG += (block[i * 4 + 0] * 16 - mean[0]) * g;
+        covBG += (block[i * 4 + 2] * 16 - mean[2]) * g;
+    }
+    if (covRG < 0) std::swap(low[0], high[0]);
+    if (covBG < 0) std::swap(low[2], high[2]);
+
+    // pull the endpoints in a little; the extremes are rarely the best fit
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (high[c] - low[c]) / 16;
+        high[c] -= inset;
+        low[c] += inset;
+    }
+
+    uint16_t c0 = PackRGB565(high[0], high[1], high[2]);
+    uint16_t c1 = PackRGB565(low[0], low[1], low[2]);
+    // four-colour mode needs c0 > c1; swapping the endpoints swaps the palette with them
+    if (c0 < c1) std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int palette[4][3];
+        UnpackRGB565(c0, palette[0]);
+        UnpackRGB565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = block[i * 4 + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) { bestDistance = distance; best = p; }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++) out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+inline void CompressAlphaBlock(const uint8_t block[64], uint8_t out[8])
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int)block[i * 4 + 3]);
+        a1 = std::min(a1, (int)block[i * 4 + 3]);
+    }
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        // eight-value mode (a0 > a1): endpoints then six evenly spaced steps
+        int palette[8] = { a0, a1 };
+        for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 8; p++)
+            {
+                int d = std::abs(block[i * 4 + 3] - palette[p]);
+                if (d < bestDistance) { bestDistance = d; best = p; }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int i = 0; i < 6; i++) out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// rgba is width x height RGBA8; partial edge blocks repeat the last row/column
+inline std::vector<uint8_t> CompressImage(const uint8_t *rgba, uint32_t width, uint32_t height, TextureFormat format)
+{
+    size_t blockBytes = format == TextureFormat::BC3 ? 16 : 8;
+    uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    std::vector<uint8_t> out(blocksX * blocksY * blockBytes);
+    uint8_t block[64];
+    uint8_t *dst = out.data();
+    for (uint32_t by = 0; by < blocksY; by++)
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            for (uint32_t y = 0; y < 4; y++)
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t sx = std::min(bx * 4 + x, width - 1), sy = std::min(by * 4 + y, height - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, rgba + (sy * width + sx) * 4, 4);
+                }
+            if (format == TextureFormat::BC3)
+            {
+                CompressAlphaBlock(block, dst);
+                dst += 8;
+            }
+            CompressColorBlock(block, dst);
+            dst += 8;
+        }
+    return out;
+}
+
+// back to RGBA8, for drivers without S3TC support
+inline std::vector<uint8_t> DecompressImage(const uint8_t *blocks, uint32_t width, uint32_t height, TextureFormat format)
+{
+    std::vector<uint8_t> rgba(width * height * 4, 255);
+    uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    for (uint32_t by = 0; by < blocksY; by++)
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            int alpha[8] = { 255, 255, 255, 255, 255, 255, 255, 255 };
+            uint64_t alphaIndices = 0;
+            if (format == TextureFormat::BC3)
+            {
+                alpha[0] = blocks[0];
+                alpha[1] = blocks[1];
+                if (alpha[0] > alpha[1])
+                    for (int p = 1; p < 7; p++) alpha[p + 1] = ((7 - p) * alpha[0] + p * alpha[1]) / 7;
+                else
+                {
+                    for (int p = 1; p < 5; p++) alpha[p + 1] = ((5 - p) * alpha[0] + p * alpha[1]) / 5;
+                    alpha[6] = 0;
+                    alpha[7] = 255;
+                }
+                for (int i = 0; i < 6; i++) alphaIndices |= (uint64_t)blocks[2 + i] << (8 * i);
+                blocks += 8;
+            }
+
+            uint16_t c0 = blocks[0] | blocks[1] << 8, c1 = blocks[2] | blocks[3] << 8;
+            int palette[4][4];
+            UnpackRGB565(c0, palette[0]);
+            UnpackRGB565(c1, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                if (c0 > c1 || format == TextureFormat::BC3)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                else
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+            uint32_t indices = blocks[4] | blocks[5] << 8 | blocks[6] << 16 | (uint32_t)blocks[7] << 24;
+            blocks += 8;
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x >= width || y >= height) continue;
+                uint8_t *dst = &rgba[(y * width + x) * 4];
+                const int *colour = palette[(indices >> (2 * i)) & 3];
+                dst[0] = (uint8_t)colour[0];
+                dst[1] = (uint8_t)colour[1];
+                dst[2] = (uint8_t)colour[2];
+                dst[3] = (uint8_t)alpha[(alphaIndices >> (3 * i)) & 7];
+            }
+        }
+    return rgba;
+}
+
+// full mip chain, each level a 2x2 box filter of the one above
+inline std::vector<CompressedMip> CompressMipChain(std::vector<uint8_t> rgba, uint32_t width, uint32_t height, TextureFormat format)
+{
+    std::vector<CompressedMip> mips;
+    for (;;)
+    {
+        CompressedMip mip;
+        mip.width = width;
+        mip.height = height;
+        mip.data = format == TextureFormat::RGBA8 ? rgba : CompressImage(rgba.data(), width, height, format);
+        mips.push_back(std::move(mip));
+        if (width == 1 && height == 1) break;
+
+        uint32_t nextWidth = std::max(1u, width / 2), nextHeight = std::max(1u, height / 2);
+        std::vector<uint8_t> next(nextWidth * nextHeight * 4);
+        for (uint32_t y = 0; y < nextHeight; y++)
+            for (uint32_t x = 0; x < nextWidth; x++)
+                for (int c = 0; c < 4; c++)
+                {
+                    uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                    uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                    int sum = rgba[(y0 * width + x0) * 4 + c] + rgba[(y0 * width + x1) * 4 + c]
+                            + rgba[(y1 * width + x0) * 4 + c] + rgba[(y1 * width + x1) * 4 + c];
+                    next[(y * nextWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+                }
+        rgba.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return mips;
+}
+
+#endif
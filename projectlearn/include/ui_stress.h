@@ -0,0 +1,214 @@
+#ifndef UI_STRESS_H
+#define UI_STRESS_H
+
+#include <glad/glad.h>
+
+#include "imgui.h"
+#include "imgui_impl_opengl3.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// a debug panel blown up to thousands of widgets, to measure what the UI costs per frame and to
+// compare the OpenGL backend's upload modes (see ImGui_ImplOpenGL3_SetFlags) on the same load
+
+// fills a window with count widgets. once the grid reaches the bottom of the window it starts
+// over from the top, slightly offset, so every widget stays visible and produces geometry
+// instead of being clipped away like it would in a scrolling list
+inline void DrawUIStressWindow(int count)
+{
+    static float values[64];
+    static bool checks[64];
+
+    ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(520.0f, 380.0f), ImGuiCond_FirstUseEver);
+    ImGui::Begin("UI stress");
+    const ImVec2 origin = ImGui::GetCursorPos();
+    const ImVec2 region = ImGui::GetContentRegionAvail();
+    const float cellWidth = 100.0f, cellHeight = ImGui::GetFrameHeightWithSpacing();
+    const int columns = std::max(1, (int)(region.x / cellWidth));
+    const int rows = std::max(1, (int)(region.y / cellHeight));
+    for (int i = 0; i < count; i++)
+    {
+        int cell = i % (columns * rows), layer = i / (columns * rows);
+        ImGui::SetCursorPos(ImVec2(origin.x + (cell % columns) * cellWidth + (float)(layer % 8),
+                                   origin.y + (cell / columns) * cellHeight + (float)(layer % 8)));
+        ImGui::PushID(i);
+        ImGui::SetNextItemWidth(cellWidth - 8.0f);
+        switch (i % 4)
+        {
+        case 0: ImGui::Button("Button"); break;
+        case 1: ImGui::SliderFloat("##value", &values[i % 64], 0.0f, 1.0f); break;
+        case 2: ImGui::Checkbox("Check", &checks[i % 64]); break;
+        default: ImGui::Text("Item %d", i); break;
+        }
+        ImGui::PopID();
+    }
+    ImGui::End();
+}
+
+// times building the stress window and rendering the whole UI, CPU side around
+// ImGui_ImplOpenGL3_RenderDrawData and GPU side with timer queries read back a few frames late.
+// a comparison renders the same load for a while in each backend mode and prints the averages
+class UIBenchmark
+{
+public:
+    struct Result
+    {
+        const char *mode = "";
+        float buildMs = 0.0f, renderMs = 0.0f, gpuMs = 0.0f;
+        float vertices = 0.0f, drawCalls = 0.0f, uploads = 0.0f, uploadKB = 0.0f;
+        int fenceWaits = 0;
+    };
+
+    int widgets = 0;
+
+    // needs the context, call before it goes away
+    void Release()
+    {
+        if (queries[0]) glDeleteQueries(QueryCount, queries);
+        queries[0] = 0;
+    }
+
+    void Build()
+    {
+        if (widgets <= 0)
+        {
+            buildMs = 0.0f;
+            return;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        DrawUIStressWindow(widgets);
+        buildMs = smooth(buildMs, elapsedMs(start));
+    }
+
+    // with what Build measured for the frame and the widget count it built, which came from the
+    // main thread when the UI renders on a render thread
+    void Render(ImDrawData *drawData, float frameBuildMs, int frameWidgets)
+    {
+        if (!queries[0]) glGenQueries(QueryCount, queries);
+        GLuint query = queries[frame % QueryCount];
+        float frameGpuMs = 0.0f;
+        if (frame >= QueryCount) // collect what this query measured QueryCount frames ago
+        {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            frameGpuMs = nanoseconds / 1.0e6f;
+            gpuMs = smooth(gpuMs, frameGpuMs);
+        }
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        auto start = std::chrono::high_resolution_clock::now();
+        ImGui_ImplOpenGL3_RenderDrawData(drawData);
+        float ms = elapsedMs(start);
+        glEndQuery(GL_TIME_ELAPSED);
+        renderMs = smooth(renderMs, ms);
+        frame++;
+
+        if (comparing >= 0) sample(ms, frameGpuMs, frameBuildMs, frameWidgets);
+    }
+
+    // framesPerMode frames each with the per-list upload, the ring buffer, and the ring buffer
+    // with the minimal state contract, after which the original flags are restored
+    void StartComparison(int framesPerMode = 300)
+    {
+        if (comparing >= 0) return;
+        savedFlags = ImGui_ImplOpenGL3_GetFlags();
+        perMode = framesPerMode;
+        comparing = 0;
+        beginMode();
+    }
+
+    bool Comparing() const { return comparing >= 0; }
+    int ComparisonMode() const { return comparing; }
+    const Result *GetResults() const { return results; }
+    bool HasResults() const { return finished; }
+    float BuildMs() const { return buildMs; }
+    float RenderMs() const { return renderMs; }
+    float GpuMs() const { return gpuMs; }
+
+private:
+    static const int QueryCount = 4;
+    static const int ModeCount = 3;
+    static const int WarmupFrames = 30;
+
+    GLuint queries[QueryCount] = {};
+    unsigned long long frame = 0;
+    float buildMs = 0.0f, renderMs = 0.0f, gpuMs = 0.0f;
+
+    int comparing = -1, perMode = 0, sampled = 0, savedFlags = 0;
+    bool finished = false;
+    Result results[ModeCount], sum;
+
+    static int modeFlags(int mode)
+    {
+        const int flags[ModeCount] = { ImGui_ImplOpenGL3_Flags_None, ImGui_ImplOpenGL3_Flags_RingBuffer,
+                                       ImGui_ImplOpenGL3_Flags_RingBuffer | ImGui_ImplOpenGL3_Flags_MinimalStateBackup };
+        return flags[mode];
+    }
+
+    static const char *modeName(int mode)
+    {
+        const char *names[ModeCount] = { "per-list upload", "ring buffer", "ring buffer, minimal state" };
+        return names[mode];
+    }
+
+    static float elapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    static float smooth(float average, float sample)
+    {
+        return average == 0.0f ? sample : average * 0.95f + sample * 0.05f;
+    }
+
+    void beginMode()
+    {
+        ImGui_ImplOpenGL3_SetFlags(modeFlags(comparing));
+        sum = Result();
+        sampled = -WarmupFrames;
+    }
+
+    void sample(float ms, float frameGpuMs, float frameBuildMs, int frameWidgets)
+    {
+        if (sampled++ < 0) return;
+        const ImGui_ImplOpenGL3_RenderStats *stats = ImGui_ImplOpenGL3_GetRenderStats();
+        sum.buildMs += frameBuildMs;
+        sum.renderMs += ms;
+        sum.gpuMs += frameGpuMs;
+        sum.vertices += (float)stats->VtxCount;
+        sum.drawCalls += (float)stats->DrawCalls;
+        sum.uploads += (float)stats->BufferUploads;
+        sum.uploadKB += stats->UploadBytes / 1024.0f;
+        sum.fenceWaits += stats->FenceWaits;
+        if (sampled < perMode) return;
+
+        Result &result = results[comparing];
+        float n = (float)perMode;
+        result.mode = modeName(comparing);
+        result.buildMs = sum.buildMs / n;
+        result.renderMs = sum.renderMs / n;
+        result.gpuMs = sum.gpuMs / n;
+        result.vertices = sum.vertices / n;
+        result.drawCalls = sum.drawCalls / n;
+        result.uploads = sum.uploads / n;
+        result.uploadKB = sum.uploadKB / n;
+        result.fenceWaits = sum.fenceWaits;
+        std::cout << "UI " << frameWidgets << " widgets, " << result.mode << ": render " << result.renderMs << " ms CPU, "
+                  << result.gpuMs << " ms GPU, build " << result.buildMs << " ms, " << result.vertices << " vertices, "
+                  << result.drawCalls << " draws, " << result.uploads << " buffer uploads (" << result.uploadKB
+                  << " KB), " << result.fenceWaits << " fence waits in " << perMode << " frames" << std::endl;
+
+        if (++comparing < ModeCount)
+        {
+            beginMode();
+            return;
+        }
+        comparing = -1;
+        finished = true;
+        ImGui_ImplOpenGL3_SetFlags(savedFlags);
+    }
+};
+
+#endif
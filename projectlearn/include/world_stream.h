@@ -0,0 +1,474 @@
+#ifndef WORLD_STREAM_H
+#define WORLD_STREAM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bundle.h"
+#include "model.h"
+#include "staging_buffer.h"
+
+// streams a neighborhood of baked houses around the camera. every chunk is one model in a
+// bundle (house_bake output) placed in the world, and chunks are bucketed in a uniform grid
+// on x/z. a chunk moves through
+//   Unloaded -> Queued -> Loading (I/O thread: map the bundle, fault its pages in)
+//            -> CpuResident -> GpuResident (GL thread: upload through the staging ring)
+// chunks within loadRadius of the camera are wanted on the GPU; chunks within loadRadius of
+// where the camera will be in prefetchSeconds (Camera::Velocity) are only read ahead into
+// memory. nothing is evicted while it fits: once a budget is exceeded, the least recently
+// wanted chunks go first, GPU chunks back to Unloaded (their pages were released on upload)
+// and CPU chunks by unmapping their bundle.
+
+struct StreamBudget
+{
+    size_t cpuBytes = 256u << 20;
+    size_t gpuBytes = 512u << 20;
+    float loadRadius = 60.0f;
+    float prefetchSeconds = 2.0f;
+    int uploadsPerFrame = 1;
+};
+
+class WorldStreamer
+{
+public:
+    enum class ChunkState { Unloaded, Queued, Loading, CpuResident, GpuResident };
+
+    struct Stats
+    {
+        int chunks = 0;
+        int queued = 0;
+        int loading = 0;
+        int cpuResident = 0;
+        int gpuResident = 0;
+        int failed = 0;
+        size_t cpuBytes = 0;
+        size_t gpuBytes = 0;
+        int loads = 0;
+        int uploads = 0;
+        int cpuEvictions = 0;
+        int gpuEvictions = 0;
+        // uploads put off because nothing could be evicted to make room
+        int budgetStalls = 0;
+        float ioMs = 0.0f;
+        float uploadMs = 0.0f;
+        float updateMs = 0.0f;
+    };
+
+    StreamBudget Budget;
+
+    WorldStreamer(float cellSize = 40.0f, int ioThreads = 2) : cellSize(cellSize), staging(8 << 20)
+    {
+        for (int i = 0; i < std::max(ioThreads, 1); i++)
+            workers.emplace_back(&WorldStreamer::workerLoop, this);
+    }
+
+    WorldStreamer(const WorldStreamer &) = delete;
+    WorldStreamer &operator=(const WorldStreamer &) = delete;
+
+    ~WorldStreamer()
+    {
+        Shutdown();
+    }
+
+    // stops the I/O threads and frees every chunk; needs the GL context
+    void Shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers) worker.join();
+        workers.clear();
+        for (Chunk &chunk : chunks)
+        {
+            if (chunk.model) chunk.model->Release();
+            chunk.model.reset();
+            chunk.bundle.reset();
+        }
+        chunks.clear();
+        onGpu.clear();
+    }
+
+    void AddChunk(const std::string &bundlePath, const std::string &modelName, const glm::mat4 &transform)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Chunk chunk;
+        chunk.bundlePath = bundlePath;
+        chunk.modelName = modelName;
+        chunk.transform = transform;
+        chunk.position = glm::vec3(transform[3]);
+        chunks.push_back(std::move(chunk));
+        cells[cellOf(chunks.back().position)].push_back((int)chunks.size() - 1);
+    }
+
+    // one chunk per line, '#' starts a comment:
+    //   chunk <bundle> <model> <x> <z> [rotation in degrees]
+    //   grid <bundle> <model> <rows> <columns> <spacing>      (centred on the origin)
+    // relative bundle paths are taken from the manifest's directory
+    bool LoadManifest(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::WORLD_STREAM::CANNOT_OPEN_MANIFEST: " << path << std::endl;
+            return false;
+        }
+        size_t slash = path.find_last_of("/\\");
+        std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            std::istringstream in(line.substr(0, line.find('#')));
+            std::string kind, bundlePath, modelName;
+            if (!(in >> kind)) continue;
+            in >> bundlePath >> modelName;
+            if (!bundlePath.empty() && bundlePath[0] != '/' && bundlePath.find(':') == std::string::npos)
+                bundlePath = directory + bundlePath;
+            if (kind == "chunk")
+            {
+                float x, z, rotation = 0.0f;
+                if (in >> x >> z)
+                {
+                    in >> rotation;
+                    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+                    AddChunk(bundlePath, modelName, glm::rotate(transform, glm::radians(rotation), glm::vec3(0.0f, 1.0f, 0.0f)));
+                    continue;
+                }
+            }
+            else if (kind == "grid")
+            {
+                int rows, columns;
+                float spacing;
+                if (in >> rows >> columns >> spacing)
+                {
+                    for (int r = 0; r < rows; r++)
+                        for (int c = 0; c < columns; c++)
+                        {
+                            glm::vec3 position((c - (columns - 1) * 0.5f) * spacing, 0.0f, (r - (rows - 1) * 0.5f) * spacing);
+                            AddChunk(bundlePath, modelName, glm::translate(glm::mat4(1.0f), position));
+                        }
+                    continue;
+                }
+            }
+            std::cout << "ERROR::WORLD_STREAM::BAD_MANIFEST_LINE: " << path << ":" << lineNumber << std::endl;
+        }
+        return true;
+    }
+
+    // once a frame on the GL thread: decides what is wanted, hands loads to the I/O threads,
+    // uploads what they finished and evicts over budget
+    void Update(const glm::vec3 &cameraPosition, const glm::vec3 &cameraVelocity)
+    {
+        auto start = std::chrono::steady_clock::now();
+        frame++;
+
+        // wanted chunks, from the grid cells around the camera and around its predicted position
+        std::vector<int> wantGpu, wantCpu;
+        gather(cameraPosition, wantGpu);
+        gather(cameraPosition + cameraVelocity * Budget.prefetchSeconds, wantCpu);
+        std::vector<int> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int index : wantGpu)
+            {
+                chunks[index].lastWanted = frame;
+                chunks[index].lastWantedOnGpu = frame;
+                chunks[index].priority = glm::length(chunks[index].position - cameraPosition);
+            }
+            for (int index : wantCpu)
+                if (chunks[index].lastWanted != frame)
+                {
+                    chunks[index].lastWanted = frame;
+                    // read ahead behind everything the camera needs now
+                    chunks[index].priority = Budget.loadRadius + glm::length(chunks[index].position - cameraPosition);
+                }
+            for (int index : wantGpu) request(index);
+            for (int index : wantCpu) request(index);
+            // drop queued loads that are no longer wanted
+            for (size_t i = 0; i < queue.size();)
+            {
+                Chunk &chunk = chunks[queue[i]];
+                if (chunk.lastWanted != frame)
+                {
+                    chunk.state = ChunkState::Unloaded;
+                    queue[i] = queue.back();
+                    queue.pop_back();
+                }
+                else
+                    i++;
+            }
+            for (int index : wantGpu)
+                if (chunks[index].state == ChunkState::CpuResident) ready.push_back(index);
+        }
+        wake.notify_all();
+
+        // nearest first, a few per frame so a burst of arrivals does not stall the frame
+        std::sort(ready.begin(), ready.end(), [&](int a, int b) { return chunks[a].priority < chunks[b].priority; });
+        int uploads = 0;
+        for (int index : ready)
+        {
+            if (uploads == Budget.uploadsPerFrame) break;
+            Chunk &chunk = chunks[index];
+            if (!makeRoomOnGpu(chunk.gpuBytes))
+            {
+                stats.budgetStalls++;
+                break;
+            }
+            auto uploadStart = std::chrono::steady_clock::now();
+            chunk.model.reset(new Model(*chunk.bundle, chunk.modelName, staging));
+            stats.uploadMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+            std::lock_guard<std::mutex> lock(mutex);
+            chunk.bundle.reset();
+            chunk.state = ChunkState::GpuResident;
+            onGpu.push_back(index);
+            stats.cpuBytes -= chunk.cpuBytes;
+            stats.gpuBytes += chunk.gpuBytes;
+            stats.uploads++;
+            uploads++;
+        }
+
+        evictCpu();
+        stats.updateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // draw(transform, model) for every chunk on the GPU
+    void Draw(const std::function<void(const glm::mat4 &, Model &)> &draw)
+    {
+        for (int index : onGpu) draw(chunks[index].transform, *chunks[index].model);
+    }
+
+    // a copy taken under the lock: the I/O workers keep updating the counters
+    Stats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.chunks = (int)chunks.size();
+        stats.queued = stats.loading = stats.cpuResident = stats.gpuResident = stats.failed = 0;
+        for (const Chunk &chunk : chunks)
+        {
+            stats.queued += chunk.state == ChunkState::Queued;
+            stats.loading += chunk.state == ChunkState::Loading;
+            stats.cpuResident += chunk.state == ChunkState::CpuResident;
+            stats.gpuResident += chunk.state == ChunkState::GpuResident;
+            stats.failed += chunk.failed;
+        }
+        return stats;
+    }
+
+    size_t ChunkCount() const { return chunks.size(); }
+
+private:
+    struct Chunk
+    {
+        std::string bundlePath;
+        std::string modelName;
+        glm::mat4 transform;
+        glm::vec3 position;
+        ChunkState state = ChunkState::Unloaded;
+        bool failed = false;
+        // nearer loads first
+        float priority = 0.0f;
+        // LRU keys: the last frame the chunk was wanted at all, and on the GPU
+        uint64_t lastWanted = 0;
+        uint64_t lastWantedOnGpu = 0;
+        // pages the bundle holds while it waits for upload, and what the upload takes on the GPU
+        size_t cpuBytes = 0;
+        size_t gpuBytes = 0;
+        std::unique_ptr<Bundle> bundle;
+        std::unique_ptr<Model> model;
+    };
+
+    float cellSize;
+    std::vector<Chunk> chunks;
+    std::map<std::pair<int, int>, std::vector<int>> cells;
+    uint64_t frame = 0;
+    // GpuResident chunks; only the GL thread moves chunks in and out of that state
+    std::vector<int> onGpu;
+    StagingRing staging;
+    Stats stats;
+
+    // guards the chunk fields the I/O threads read or write (state, priority, bundle, byte
+    // counts), the queue and the stats
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<int> queue;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    std::pair<int, int> cellOf(const glm::vec3 &position) const
+    {
+        return { (int)std::floor(position.x / cellSize), (int)std::floor(position.z / cellSize) };
+    }
+
+    void gather(const glm::vec3 &center, std::vector<int> &result) const
+    {
+        float radius = Budget.loadRadius;
+        std::pair<int, int> low = cellOf(center - glm::vec3(radius)), high = cellOf(center + glm::vec3(radius));
+        for (int x = low.first; x <= high.first; x++)
+            for (int z = low.second; z <= high.second; z++)
+            {
+                auto cell = cells.find({ x, z });
+                if (cell == cells.end()) continue;
+                for (int index : cell->second)
+                {
+                    glm::vec3 offset = chunks[index].position - center;
+                    if (offset.x * offset.x + offset.z * offset.z <= radius * radius) result.push_back(index);
+                }
+            }
+    }
+
+    // with the mutex held
+    void request(int index)
+    {
+        Chunk &chunk = chunks[index];
+        if (chunk.state != ChunkState::Unloaded || chunk.failed) return;
+        chunk.state = ChunkState::Queued;
+        queue.push_back(index);
+    }
+
+    // evicts GPU chunks that were not wanted on the GPU this frame, least recently wanted first
+    bool makeRoomOnGpu(size_t bytes)
+    {
+        while (stats.gpuBytes + bytes > Budget.gpuBytes)
+        {
+            int oldest = -1;
+            for (int i = 0; i < (int)onGpu.size(); i++)
+            {
+                const Chunk &chunk = chunks[onGpu[i]];
+                if (chunk.lastWantedOnGpu != frame && (oldest < 0 || chunk.lastWantedOnGpu < chunks[onGpu[oldest]].lastWantedOnGpu))
+                    oldest = i;
+            }
+            if (oldest < 0) return false;
+            Chunk &chunk = chunks[onGpu[oldest]];
+            onGpu[oldest] = onGpu.back();
+            onGpu.pop_back();
+            chunk.model->Release();
+            chunk.model.reset();
+            std::lock_guard<std::mutex> lock(mutex);
+            chunk.state = ChunkState::Unloaded;
+            stats.gpuBytes -= chunk.gpuBytes;
+            stats.gpuEvictions++;
+        }
+        return true;
+    }
+
+    // unmaps loaded bundles over the CPU budget: unwanted ones first, then read-ahead ones,
+    // never the ones waiting to go to the GPU this frame
+    void evictCpu()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (stats.cpuBytes > Budget.cpuBytes)
+        {
+            Chunk *oldest = nullptr;
+            for (Chunk &chunk : chunks)
+                if (chunk.state == ChunkState::CpuResident && chunk.lastWantedOnGpu != frame
+                    && (!oldest || chunk.lastWanted < oldest->lastWanted))
+                    oldest = &chunk;
+            if (!oldest) return;
+            oldest->bundle.reset();
+            oldest->state = ChunkState::Unloaded;
+            stats.cpuBytes -= oldest->cpuBytes;
+            stats.cpuEvictions++;
+        }
+    }
+
+    // faults in every entry the model uses; gpuBytes counts the ones that end up in buffers and textures
+    static bool touchModel(const Bundle &bundle, const std::string &name, size_t &cpuBytes, size_t &gpuBytes)
+    {
+        int index = bundle.Find(BundleEntryType::Model, name);
+        if (index < 0)
+        {
+            std::cout << "ERROR::WORLD_STREAM::MODEL_NOT_FOUND: " << name << std::endl;
+            return false;
+        }
+        // the records index into the rest of the file; a bad one fails the chunk instead of faulting here
+        if (!ValidateBundleModel(bundle, index)) return false;
+        cpuBytes = bundle.Touch(bundle.Entry(index));
+        gpuBytes = 0;
+        const BundleModel *header = (const BundleModel *)bundle.Data(index);
+        const BundleMesh *meshRecords = (const BundleMesh *)(bundle.Data(index) + sizeof(BundleModel));
+        std::set<uint32_t> textures;
+        for (uint32_t i = 0; i < header->meshCount; i++)
+        {
+            const BundleMesh &record = meshRecords[i];
+            for (uint32_t entry : { record.vertexEntry, record.indexEntry })
+            {
+                size_t bytes = bundle.Touch(bundle.Entry(entry));
+                cpuBytes += bytes;
+                gpuBytes += bytes;
+            }
+            if (record.meshletCount) cpuBytes += bundle.Touch(bundle.Entry(record.meshletEntry));
+            for (uint32_t t = 0; t < record.textureCount; t++)
+                if (textures.insert(record.textureEntries[t]).second)
+                {
+                    size_t bytes = bundle.Touch(bundle.Entry(record.textureEntries[t]));
+                    cpuBytes += bytes;
+                    gpuBytes += bytes;
+                }
+        }
+        return true;
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            auto next = std::min_element(queue.begin(), queue.end(), [&](int a, int b) { return chunks[a].priority < chunks[b].priority; });
+            int index = *next;
+            queue.erase(next);
+            chunks[index].state = ChunkState::Loading;
+            std::string path = chunks[index].bundlePath, name = chunks[index].modelName;
+            lock.unlock();
+
+            auto start = std::chrono::steady_clock::now();
+            std::unique_ptr<Bundle> bundle(new Bundle());
+            size_t cpuBytes = 0, gpuBytes = 0;
+            bool loaded = bundle->Open(path) && touchModel(*bundle, name, cpuBytes, gpuBytes);
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            lock.lock();
+            // AddChunk may have grown the vector meanwhile
+            Chunk &chunk = chunks[index];
+            stats.ioMs += ms;
+            stats.loads++;
+            if (loaded)
+            {
+                chunk.bundle = std::move(bundle);
+                chunk.cpuBytes = cpuBytes;
+                chunk.gpuBytes = gpuBytes;
+                chunk.state = ChunkState::CpuResident;
+                stats.cpuBytes += cpuBytes;
+            }
+            else
+            {
+                // not retried; the manifest or the bundle needs fixing
+                chunk.failed = true;
+                chunk.state = ChunkState::Unloaded;
+            }
+        }
+    }
+};
+
+#endif
@@ -1,19 +1,14 @@
 #version 330 core
+// positions and normals were already skinned this frame by skinning.vs
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 norm;
 layout(location = 2) in vec2 tex;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
-layout(location = 5) in ivec4 boneIds; 
-layout(location = 6) in vec4 weights;
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
-
-const int MAX_BONES = 100;
-const int MAX_BONE_INFLUENCE = 4;
-uniform mat4 finalBonesMatrices[MAX_BONES];
+// transpose(inverse(mat3(model))), computed once per draw on the CPU
+uniform mat3 normalMatrix;
 
 out vec2 TexCoords;
 out vec3 FragPos;
@@ -21,24 +16,9 @@ out vec3 Normal;
 
 void main()
 {
-    vec4 totalPosition = vec4(0.0f);
-    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
-    {
-        if(boneIds[i] == -1) 
-            continue;
-        if(boneIds[i] >=MAX_BONES) 
-        {
-            totalPosition = vec4(pos,1.0f);
-            break;
-        }
-        vec4 localPosition = finalBonesMatrices[boneIds[i]] * vec4(pos,1.0f);
-        totalPosition += localPosition * weights[i];
-        vec3 localNormal = mat3(finalBonesMatrices[boneIds[i]]) * norm;
-   }
-	
-    mat4 viewModel = view * model;
-    gl_Position =  projection * viewModel * totalPosition;
+    vec4 worldPosition = model * vec4(pos,1.0);
+    gl_Position =  projection * view * worldPosition;
 	TexCoords = tex;
-    FragPos = vec3(model * vec4(pos,1.0));
-    Normal = mat3(transpose(inverse(model))) * norm;
-}
\ No newline at end of file
+    FragPos = vec3(worldPosition);
+    Normal = normalMatrix * norm;
+}
@@ -10,12 +10,14 @@ out vec2 TexCoords;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// transpose(inverse(mat3(model))), computed once per draw on the CPU
+uniform mat3 normalMatrix;
 
 void main()
 {
     TexCoords = aTexCoords;
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    Normal = normalMatrix * aNormal;  
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
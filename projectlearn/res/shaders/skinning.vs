@@ -0,0 +1,44 @@
+#version 330 core
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 5) in ivec4 boneIds; 
+layout(location = 6) in vec4 weights;
+
+const int MAX_BONES = 100;
+const int MAX_BONE_INFLUENCE = 4;
+uniform mat4 finalBonesMatrices[MAX_BONES];
+
+// captured with transform feedback, one record per vertex, in model space
+out vec3 skinnedPosition;
+out vec3 skinnedNormal;
+
+void main()
+{
+    vec4 totalPosition = vec4(0.0f);
+    vec3 totalNormal = vec3(0.0f);
+    float totalWeight = 0.0f;
+    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    {
+        if(boneIds[i] == -1) 
+            continue;
+        if(boneIds[i] >=MAX_BONES) 
+        {
+            totalPosition = vec4(pos,1.0f);
+            totalNormal = norm;
+            totalWeight = 1.0f;
+            break;
+        }
+        totalPosition += finalBonesMatrices[boneIds[i]] * vec4(pos,1.0f) * weights[i];
+        totalNormal += mat3(finalBonesMatrices[boneIds[i]]) * norm * weights[i];
+        totalWeight += weights[i];
+    }
+    // vertices without influences stay in bind pose instead of collapsing to the origin
+    if(totalWeight == 0.0f)
+    {
+        totalPosition = vec4(pos,1.0f);
+        totalNormal = norm;
+    }
+
+    skinnedPosition = totalPosition.xyz;
+    skinnedNormal = totalNormal; // normalized per fragment
+}
@@ -0,0 +1,59 @@
+#version 330 core
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 5) in ivec4 boneIds; 
+layout(location = 6) in vec4 weights;
+
+const int MAX_BONES = 100;
+const int MAX_BONE_INFLUENCE = 4;
+// two vec4 per bone: real part then dual part, both (x,y,z,w)
+uniform vec4 finalBonesDQ[2 * MAX_BONES];
+// uniform skeleton scale factored out of the palette (dual quaternions are rigid)
+uniform float boneScale;
+
+// captured with transform feedback, one record per vertex, in model space
+out vec3 skinnedPosition;
+out vec3 skinnedNormal;
+
+void main()
+{
+    vec4 real = vec4(0.0f);
+    vec4 dual = vec4(0.0f);
+    vec4 pivot = vec4(0.0f);
+    bool rigid = false;
+    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    {
+        if(boneIds[i] == -1) 
+            continue;
+        if(boneIds[i] >=MAX_BONES) 
+        {
+            rigid = true;
+            break;
+        }
+        vec4 r = finalBonesDQ[2 * boneIds[i]];
+        vec4 d = finalBonesDQ[2 * boneIds[i] + 1];
+        // q and -q are the same rotation; keep every influence in the first one's hemisphere
+        if(pivot == vec4(0.0f))
+            pivot = r;
+        float w = dot(r, pivot) < 0.0f ? -weights[i] : weights[i];
+        real += r * w;
+        dual += d * w;
+    }
+
+    float len = length(real);
+    if(rigid || len == 0.0f)
+    {
+        // no usable influences: stay in bind pose
+        skinnedPosition = pos;
+        skinnedNormal = norm;
+        return;
+    }
+    real /= len;
+    dual /= len;
+
+    vec3 p = pos * boneScale;
+    vec3 rotated = p + 2.0f * cross(real.xyz, cross(real.xyz, p) + real.w * p);
+    vec3 translation = 2.0f * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+    skinnedPosition = rotated + translation;
+    skinnedNormal = norm + 2.0f * cross(real.xyz, cross(real.xyz, norm) + real.w * norm); // normalized per fragment
+}
@@ -0,0 +1,334 @@
+// house_bake: loads models and clips through the same Model/Animation code the viewer uses and
+// writes everything into one bundle (see bundle.h) that the viewer maps with --bundle.
+//
+//   house_bake <out.bundle> [model <name> <path>]... [clip <name> <path> <model name>]...
+//
+// model data is read without a GL context, textures are block compressed with a full mip
+// chain and clips are stored in their compressed form.
+
+#include <glad/glad.h>
+
+#include <model.h>
+#include <Animation.h>
+#include <bundle.h>
+#include <texture_compress.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ModelSource
+{
+    std::string name;
+    std::string path;
+    std::unique_ptr<Model> model;
+    float assimpMs = 0.0f;
+};
+
+struct ClipSource
+{
+    std::string name;
+    std::string path;
+    std::string modelName;
+    std::unique_ptr<Animation> animation;
+    float assimpMs = 0.0f;
+};
+
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void PrintUsage()
+{
+    std::cout << "usage: house_bake <out.bundle> [model <name> <path>]... [clip <name> <path> <model name>]..." << std::endl;
+}
+
+// decodes, compresses and writes one texture; returns its entry or -1 when the file cannot be read
+static int BakeTexture(BundleWriter &writer, const std::string &name, const std::string &filename, size_t &sourceBytes)
+{
+    auto start = std::chrono::steady_clock::now();
+    int width, height, components;
+    unsigned char *pixels = stbi_load(filename.c_str(), &width, &height, &components, 4);
+    if (!pixels)
+    {
+        std::cout << "ERROR::HOUSE_BAKE::TEXTURE_FAILED: " << filename << std::endl;
+        return -1;
+    }
+    float decodeMs = MillisecondsSince(start);
+    sourceBytes += (size_t)width * height * components;
+
+    // BC3 only where the alpha channel carries something, BC1 is half the size
+    TextureFormat format = TextureFormat::BC1;
+    if (components == 4)
+        for (int i = 0; i < width * height; i++)
+            if (pixels[i * 4 + 3] != 255)
+            {
+                format = TextureFormat::BC3;
+                break;
+            }
+
+    std::vector<uint8_t> rgba(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+    std::vector<CompressedMip> mips = CompressMipChain(std::move(rgba), width, height, format);
+
+    BundleTexture header = {};
+    header.format = (uint32_t)format;
+    header.mipCount = (uint32_t)mips.size();
+    header.decodeMs = decodeMs;
+    std::vector<BundleMip> records(mips.size());
+    uint64_t offset = sizeof(BundleTexture) + mips.size() * sizeof(BundleMip);
+    for (size_t i = 0; i < mips.size(); i++)
+    {
+        records[i].width = mips[i].width;
+        records[i].height = mips[i].height;
+        records[i].offset = offset;
+        records[i].size = mips[i].data.size();
+        offset += (mips[i].data.size() + 3) & ~size_t(3);
+    }
+
+    std::vector<uint8_t> blob(offset, 0);
+    std::memcpy(blob.data(), &header, sizeof(header));
+    std::memcpy(blob.data() + sizeof(header), records.data(), records.size() * sizeof(BundleMip));
+    for (size_t i = 0; i < mips.size(); i++)
+        std::memcpy(blob.data() + records[i].offset, mips[i].data.data(), mips[i].data.size());
+    return (int)writer.Add(BundleEntryType::Texture, name, blob.data(), blob.size());
+}
+
+static void BakeClip(BundleWriter &writer, const ClipSource &source)
+{
+    const Animation &animation = *source.animation;
+    const std::vector<AssimpNodeData> &nodes = animation.GetNodes();
+    const std::vector<Bone> &bones = animation.GetBones();
+    const CompressedClip &clip = animation.GetCompressedClip();
+
+    BundleClip header = {};
+    header.duration = source.animation->GetDuration();
+    header.ticksPerSecond = source.animation->GetTicksPerSecond();
+    header.nodeCount = (uint32_t)nodes.size();
+    header.boneCount = (uint32_t)bones.size();
+    header.clipBytes = clip.SerializedSize();
+    CopyBundleName(header.model, source.modelName);
+    header.assimpMs = source.assimpMs;
+
+    std::vector<uint8_t> blob(sizeof(BundleClip) + nodes.size() * sizeof(BundleNode)
+        + bones.size() * BUNDLE_NAME_LENGTH + clip.SerializedSize(), 0);
+    uint8_t *out = blob.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (const AssimpNodeData &node : nodes)
+    {
+        BundleNode record = {};
+        CopyBundleName(record.name, node.name);
+        record.parent = node.parent;
+        record.childrenCount = node.childrenCount;
+        std::memcpy(record.transformation, &node.transformation, sizeof(record.transformation));
+        std::memcpy(out, &record, sizeof(record));
+        out += sizeof(record);
+    }
+    for (const Bone &bone : bones)
+    {
+        CopyBundleName((char *)out, bone.GetBoneName());
+        out += BUNDLE_NAME_LENGTH;
+    }
+    clip.Serialize(out);
+    writer.Add(BundleEntryType::Clip, source.name, blob.data(), blob.size());
+}
+
+static void BakeModel(BundleWriter &writer, const ModelSource &source, std::map<std::string, int> &textureEntries,
+    size_t &textureSourceBytes)
+{
+    Model &model = *source.model;
+    std::vector<BundleMesh> meshes(model.meshes.size());
+    for (size_t i = 0; i < model.meshes.size(); i++)
+    {
+        const Mesh &mesh = model.meshes[i];
+        BundleMesh &record = meshes[i];
+        std::memset(&record, 0, sizeof(record));
+        CopyBundleName(record.name, mesh.name.C_Str());
+        std::string prefix = source.name + "/" + std::to_string(i);
+        record.vertexEntry = writer.Add(BundleEntryType::Vertices, prefix, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        if (IndexTypeFor(mesh.vertices.size()) == GL_UNSIGNED_SHORT)
+        {
+            std::vector<uint16_t> narrow(mesh.indices.begin(), mesh.indices.end());
+            record.indexEntry = writer.Add(BundleEntryType::Indices, prefix, narrow.data(), narrow.size() * sizeof(uint16_t));
+            record.indexSize = sizeof(uint16_t);
+        }
+        else
+        {
+            record.indexEntry = writer.Add(BundleEntryType::Indices, prefix, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            record.indexSize = sizeof(unsigned int);
+        }
+        record.vertexCount = (uint32_t)mesh.vertices.size();
+        record.indexCount = (uint32_t)mesh.indices.size();
+        record.lodCount = (uint32_t)std::min(mesh.lods.size(), (size_t)BUNDLE_MAX_MESH_LODS);
+        for (uint32_t l = 0; l < record.lodCount; l++)
+            record.lods[l] = { mesh.lods[l].firstIndex, mesh.lods[l].indexCount, mesh.lods[l].error,
+                mesh.lods[l].firstMeshlet, mesh.lods[l].meshletCount };
+        if (!mesh.meshlets.empty())
+        {
+            record.meshletEntry = writer.Add(BundleEntryType::Meshlets, prefix, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+            record.meshletCount = (uint32_t)mesh.meshlets.size();
+        }
+
+        const Material &mat = mesh.mat;
+        for (int c = 0; c < 4; c++)
+        {
+            record.material.Ka[c] = mat.Ka[c];
+            record.material.Kd[c] = mat.Kd[c];
+            record.material.Ks[c] = mat.Ks[c];
+        }
+        record.material.shininess = mat.shininess;
+        record.material.transparency = mat.transparency;
+        record.material.hasTexture = mat.hasTexture ? 1 : 0;
+
+        for (const Texture &texture : mesh.textures)
+        {
+            if (record.textureCount == BUNDLE_MAX_MESH_TEXTURES)
+            {
+                std::cout << "ERROR::HOUSE_BAKE::TOO_MANY_TEXTURES: " << mesh.name.C_Str() << std::endl;
+                break;
+            }
+            std::string filename = model.directory + '/' + texture.path;
+            auto found = textureEntries.find(filename);
+            if (found == textureEntries.end())
+                found = textureEntries.insert({ filename, BakeTexture(writer, texture.path, filename, textureSourceBytes) }).first;
+            if (found->second < 0) continue;
+            record.textureEntries[record.textureCount] = (uint32_t)found->second;
+            std::strncpy(record.textureTypes[record.textureCount], texture.type.c_str(), sizeof(record.textureTypes[0]) - 1);
+            record.textureCount++;
+        }
+    }
+
+    std::vector<BundleLight> lights;
+    for (const std::vector<Bulbs> *list : { &model.bulbs, &model.pointBulbs })
+        for (const Bulbs &bulb : *list)
+        {
+            BundleLight light = {};
+            for (int c = 0; c < 3; c++)
+            {
+                light.ambient[c] = bulb.ambient[c];
+                light.diffuse[c] = bulb.diffuse[c];
+                light.specular[c] = bulb.specular[c];
+                light.position[c] = bulb.position[c];
+                light.normal[c] = bulb.normal[c];
+            }
+            light.angle = bulb.angle;
+            light.constant = bulb.constant;
+            light.linear = bulb.linear;
+            light.exp = bulb.exp;
+            lights.push_back(light);
+        }
+
+    std::vector<BundleBone> bones;
+    for (const auto &entry : model.GetBoneInfoMap())
+    {
+        BundleBone bone = {};
+        CopyBundleName(bone.name, entry.first);
+        bone.id = entry.second.id;
+        std::memcpy(bone.offset, &entry.second.offset, sizeof(bone.offset));
+        bones.push_back(bone);
+    }
+
+    BundleModel header = {};
+    header.meshCount = (uint32_t)meshes.size();
+    header.bulbCount = (uint32_t)model.bulbs.size();
+    header.pointBulbCount = (uint32_t)model.pointBulbs.size();
+    header.boneCount = (uint32_t)bones.size();
+    header.assimpMs = source.assimpMs;
+
+    std::vector<uint8_t> blob;
+    auto append = [&blob](const void *data, size_t bytes)
+    {
+        blob.insert(blob.end(), (const uint8_t *)data, (const uint8_t *)data + bytes);
+    };
+    append(&header, sizeof(header));
+    append(meshes.data(), meshes.size() * sizeof(BundleMesh));
+    append(lights.data(), lights.size() * sizeof(BundleLight));
+    append(bones.data(), bones.size() * sizeof(BundleBone));
+    writer.Add(BundleEntryType::Model, source.name, blob.data(), blob.size());
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<ModelSource> models;
+    std::vector<ClipSource> clips;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string kind = argv[i];
+        if (kind == "model" && i + 2 < argc)
+        {
+            ModelSource source;
+            source.name = argv[i + 1];
+            source.path = argv[i + 2];
+            models.push_back(std::move(source));
+            i += 2;
+        }
+        else if (kind == "clip" && i + 3 < argc)
+        {
+            ClipSource source;
+            source.name = argv[i + 1];
+            source.path = argv[i + 2];
+            source.modelName = argv[i + 3];
+            clips.push_back(std::move(source));
+            i += 3;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    for (ModelSource &source : models)
+    {
+        auto start = std::chrono::steady_clock::now();
+        source.model.reset(new Model(source.path, false, false));
+        source.assimpMs = MillisecondsSince(start);
+        std::cout << "Loaded " << source.path << " in " << source.assimpMs << " ms" << std::endl;
+        source.model->PrintOptimizeReport(source.name, true);
+    }
+    for (ClipSource &source : clips)
+    {
+        Model *model = nullptr;
+        for (ModelSource &candidate : models)
+            if (candidate.name == source.modelName) model = candidate.model.get();
+        if (!model)
+        {
+            std::cout << "ERROR::HOUSE_BAKE::UNKNOWN_MODEL: " << source.modelName << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        source.animation.reset(new Animation(source.path, model));
+        source.assimpMs = MillisecondsSince(start);
+    }
+
+    BundleWriter writer;
+    if (!writer.Open(argv[1])) return 1;
+    // clips first: loading them registers bones the skin does not reference, which the model
+    // records must include
+    for (const ClipSource &source : clips) BakeClip(writer, source);
+    std::map<std::string, int> textureEntries;
+    size_t textureSourceBytes = 0;
+    for (const ModelSource &source : models) BakeModel(writer, source, textureEntries, textureSourceBytes);
+    uint64_t bytes = writer.BytesWritten();
+    if (!writer.Finish())
+    {
+        std::cout << "ERROR::HOUSE_BAKE::WRITE_FAILED: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << argv[1] << ": " << models.size() << " models, " << clips.size() << " clips, "
+        << textureEntries.size() << " textures (" << textureSourceBytes / 1024.0f << " KB decoded), "
+        << bytes / 1024.0f << " KB" << std::endl;
+    return 0;
+}
@@ -10,13 +10,29 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include <gl_extensions.h>
 #include <shader.h>
+#include <shader_reload.h>
 #include <camera.h>
 #include <model.h>
 #include <Animator.h>
+#include <skinning.h>
+#include <bundle.h>
+#include <world_stream.h>
+#include <ui_stress.h>
+#include <panel_cache.h>
+#include <debug_draw.h>
+#include <lazy_font.h>
+#include <frame_pacing.h>
+#include <render_thread.h>
+#include <job_system.h>
+#include <scene.h>
 
 
 #include <iostream>
+#include <fstream>
+#include <chrono>
+#include <memory>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
@@ -33,49 +49,124 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
-// timing
+// timing: the length of a simulation step (see frame_pacing.h)
 float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
-//paths
-const char *vertexShaderPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/1.model_loading.vs";
-const char *lightingShadervPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/lighting.vs";
-const char *lightingShaderfPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/lighting.fs";
-const char *fragmentShaderPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/1.model_loading.fs";
-const char *objFilePath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/models/house.obj";
-std::string skyboxFilePath =
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/models/textures/Cubemaps";
-const char *skyboxShadervPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/skybox.vs";
-const char *skyboxShaderfPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/skybox.fs";
-const char *animationFilePath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/models/Sitting.dae";
-const char *animationShadervPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/animation.vs";
-const char *animationShaderfPath = 
-"C:/Users/USER/Downloads/Telegram Desktop/gl"
-"/projectlearn/res/shaders/animation.fs";
-
-
-
-int main()
+
+// what the framebuffer resize callback saw last, drawn to by the render thread
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
+// models, instances, lights and asset directories (see scene.h); --scene picks another
+const char *defaultScenePath = "res/scenes/house.json";
+
+int main(int argc, char **argv)
 {
+    // command line
+    bool validateSkinning = false; // compare dual quaternion against linear skinning, then exit
+    bool dualQuatSkinning = false;
+    bool benchPose = false; // time pose evaluation kernels, no window needed
+    bool validateSkinningSynthetic = false; // the skinning check on a generated skeleton, no window needed
+    std::string bundlePath; // assets baked by house_bake instead of the source files
+    bool meshReport = false; // per-mesh results of the load time mesh optimization
+    bool benchMeshlets = false; // meshlet culling from fixed viewpoints, no window needed
+    std::vector<std::string> meshletBenchModels;
+    std::string neighborhoodPath; // manifest of baked houses streamed in around the camera
+    int ioThreads = 2;
+    int uiStressWidgets = 0; // extra debug widgets; with this set the UI backend modes are compared at startup
+    bool eagerFonts = false; // rasterize every glyph at startup like ImGui does, instead of on demand
+    std::string fontPath; // a TTF with the full Chinese ranges instead of ImGui's default font
+    float fontPixels = 18.0f;
+    float fpsCap = 0.0f;
+    VsyncMode vsync = VsyncMode::On;
+    float simHz = 60.0f;
+    bool variableStep = false; // simulate once per frame with the frame's own delta, no interpolation
+    bool renderThreaded = true; // GL on a thread of its own, fed frame packets (see render_thread.h)
+    std::string scenePath = defaultScenePath;
+    int jobThreads = -1; // job system workers (see job_system.h); -1 leaves one core to the main thread
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--validate-skinning") validateSkinning = true;
+        else if (arg == "--dq") dualQuatSkinning = true;
+        else if (arg == "--bench-pose") benchPose = true;
+        else if (arg == "--validate-skinning-synthetic") validateSkinningSynthetic = true;
+        else if (arg == "--bundle" && i + 1 < argc) bundlePath = argv[++i];
+        else if (arg == "--mesh-report") meshReport = true;
+        else if (arg == "--neighborhood" && i + 1 < argc) neighborhoodPath = argv[++i];
+        else if (arg == "--io-threads" && i + 1 < argc) ioThreads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--ui-stress" && i + 1 < argc) uiStressWidgets = std::max(0, atoi(argv[++i]));
+        else if (arg == "--eager-fonts") eagerFonts = true;
+        else if (arg == "--fps-cap" && i + 1 < argc) fpsCap = std::max(0.0f, (float)atof(argv[++i]));
+        else if (arg == "--sim-hz" && i + 1 < argc) simHz = std::max(1.0f, (float)atof(argv[++i]));
+        else if (arg == "--variable-step") variableStep = true;
+        else if (arg == "--no-render-thread") renderThreaded = false;
+        else if (arg == "--scene" && i + 1 < argc) scenePath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) jobThreads = std::max(0, atoi(argv[++i]));
+        else if (arg == "--vsync" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            vsync = mode == "off" ? VsyncMode::Off : mode == "adaptive" ? VsyncMode::Adaptive : VsyncMode::On;
+        }
+        else if (arg == "--font" && i + 2 < argc)
+        {
+            fontPath = argv[++i];
+            fontPixels = std::max(6.0f, (float)atof(argv[++i]));
+        }
+        else if (arg == "--bench-meshlets")
+        {
+            benchMeshlets = true;
+            // any number of model files may follow; the house by default
+            while (i + 1 < argc && argv[i + 1][0] != '-') meshletBenchModels.push_back(argv[++i]);
+        }
+        else std::cout << "Unknown argument: " << arg << std::endl;
+    }
+    // before anything loads: model loading, pose evaluation and culling all run on the job system
+    if (jobThreads >= 0) JobThreadCount() = jobThreads;
+    std::cout << "Job system: " << Jobs().ThreadCount() << " worker threads" << std::endl;
+    Jobs().RegisterThread("main");
+    Scene scene;
+    if (!scene.Load(scenePath)) return -1;
+    // this renderer draws one skinned character (animated, with at least one clip) and any number of static models
+    int characterIndex = -1;
+    std::vector<int> staticModels;
+    for (size_t i = 0; i < scene.models.size(); i++)
+    {
+        if (!scene.models[i].animated) staticModels.push_back((int)i);
+        else if (characterIndex < 0) characterIndex = (int)i;
+        else
+        {
+            std::cout << "ERROR::SCENE::SECOND_ANIMATED_MODEL: " << scene.models[i].name << " is drawn unskinned" << std::endl;
+            staticModels.push_back((int)i);
+        }
+    }
+    std::vector<const SceneAnimation *> characterClips;
+    for (const SceneAnimation &animation : scene.animations)
+        if (animation.model == characterIndex) characterClips.push_back(&animation);
+    if (characterIndex < 0 || characterClips.empty() || staticModels.empty())
+    {
+        std::cout << "ERROR::SCENE::INCOMPLETE: " << scenePath << " needs an animated model with an animation and a static model" << std::endl;
+        return -1;
+    }
+    std::cout << "Scene " << scenePath << ": " << scene.models.size() << " models, " << scene.InstanceCount() << " instances"
+              << std::endl;
+    if (benchPose)
+    {
+        RunPoseBenchmark();
+        return 0;
+    }
+    if (validateSkinningSynthetic) return RunSkinningSelfTest() ? 0 : 1;
+    if (benchMeshlets)
+    {
+        if (meshletBenchModels.empty())
+            for (int model : staticModels) meshletBenchModels.push_back(scene.models[model].path);
+        for (const std::string &path : meshletBenchModels)
+        {
+            Model benchModel(path, false, false);
+            RunMeshletBenchmark(benchModel.meshes, path);
+        }
+        return 0;
+    }
+
     // initialize glfw
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -92,6 +183,7 @@ int main()
     }
     // Making the context of our window the main context of the current thread
     glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
 
     // configure resize callback function to framebuffer_size_callback
@@ -108,6 +200,7 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
 
 
@@ -118,28 +211,219 @@ int main()
 
 
     // build and compile shaders
-    Shader lightingShader(lightingShadervPath, lightingShaderfPath);
-    Shader animationShader(animationShadervPath, animationShaderfPath);
-    Shader skyboxShader( skyboxShadervPath, skyboxShaderfPath ); // skybox shaders
+    auto shaderPath = [&scene](const char *file) { return scene.shaderDirectory + "/" + file; };
+    Shader lightingShader(shaderPath("lighting.vs").c_str(), shaderPath("lighting.fs").c_str());
+    Shader animationShader(shaderPath("animation.vs").c_str(), shaderPath("animation.fs").c_str());
+    Shader skyboxShader( shaderPath("skybox.vs").c_str(), shaderPath("skybox.fs").c_str() ); // skybox shaders
+    SkinningPass skinningPass( shaderPath("skinning.vs").c_str() ); // pre-skins the character once per frame
+    SkinningPass skinningPassDQ( shaderPath("skinning_dq.vs").c_str() );
+
+    // startup benchmark: time spent getting each program ready versus a cold compile+link
+    {
+        const char *names[] = { "lighting", "animation", "skybox", "skinning", "skinning dq" };
+        const Shader *shaders[] = { &lightingShader, &animationShader, &skyboxShader, &skinningPass.shader, &skinningPassDQ.shader };
+        float totalLoad = 0.0f, totalCompile = 0.0f;
+        for (int i = 0; i < 5; i++)
+        {
+            std::cout << "Shader " << names[i] << ": " << shaders[i]->loadMs << " ms ("
+                      << (shaders[i]->fromCache ? "binary cache" : "compiled") << ", cold compile "
+                      << shaders[i]->compileMs << " ms)" << std::endl;
+            totalLoad += shaders[i]->loadMs;
+            totalCompile += shaders[i]->compileMs;
+        }
+        std::cout << "Shader startup: " << totalLoad << " ms, saved " << (totalCompile > totalLoad ? totalCompile - totalLoad : 0.0f)
+                  << " ms of " << totalCompile << " ms compile time"
+                  << (GLExt().programBinary ? "" : " (program binaries unsupported by this driver)") << std::endl;
+    }
 
 
 
-    // load models
-    Model ourModel(objFilePath);
+    // rebuild any of the programs in the background when their sources are saved
+    ShaderReloader shaderReloader(window);
+    shaderReloader.Watch(lightingShader);
+    shaderReloader.Watch(animationShader);
+    shaderReloader.Watch(skyboxShader);
+    shaderReloader.Watch(skinningPass.shader);
+    shaderReloader.Watch(skinningPassDQ.shader);
 
-	Model animationModel( animationFilePath );
-    Animation danceAnimation(animationFilePath,&animationModel);
+    // load the scene's models, from the bundle when one was given. it is expected to hold every model
+    // and clip under its name in the scene file, e.g. for res/scenes/house.json
+    //   house_bake <file> model house <house.obj> model character <Sitting.dae> clip sitting <Sitting.dae> character
+    Bundle bundle;
+    if (!bundlePath.empty()) bundle.Open(bundlePath);
+    std::unique_ptr<StagingRing> staging(bundle.IsOpen() ? new StagingRing() : nullptr);
+    auto loadStart = std::chrono::steady_clock::now();
+    auto loadLap = [&loadStart]()
+    {
+        auto now = std::chrono::steady_clock::now();
+        float ms = std::chrono::duration<float, std::milli>(now - loadStart).count();
+        loadStart = now;
+        return ms;
+    };
+    std::vector<std::unique_ptr<Model>> models;
+    std::vector<float> modelLoadMs;
+    for (size_t i = 0; i < scene.models.size(); i++)
+    {
+        const SceneModel &entry = scene.models[i];
+        // the character keeps CPU vertices for the skinning passes
+        bool character = (int)i == characterIndex;
+        models.emplace_back(bundle.IsOpen() ? new Model(bundle, entry.bundleName, *staging, character) : new Model(entry.path));
+        modelLoadMs.push_back(loadLap());
+    }
+    std::vector<std::unique_ptr<Animation>> clips;
+    std::vector<float> clipLoadMs;
+    for (const SceneAnimation *clip : characterClips)
+    {
+        Model *target = models[characterIndex].get();
+        clips.emplace_back(bundle.IsOpen() ? new Animation(bundle, clip->name, target) : new Animation(clip->path, target));
+        clipLoadMs.push_back(loadLap());
+    }
+    // the first static model is the one the culling, bounds and light panels look at
+    Model &ourModel = *models[staticModels[0]];
+	Model &animationModel = *models[characterIndex];
+    Animation &danceAnimation = *clips[0];
+    if (bundle.IsOpen())
+    {
+        // the bake recorded what the same assets cost through assimp (without texture decode)
+        std::cout << "Bundle " << bundlePath << " load vs assimp:";
+        for (size_t i = 0; i < models.size(); i++)
+        {
+            int entry = bundle.Find(BundleEntryType::Model, scene.models[i].bundleName);
+            std::cout << " " << scene.models[i].name << " " << modelLoadMs[i] << " ms / "
+                      << (entry >= 0 ? ((const BundleModel *)bundle.Data(entry))->assimpMs : 0.0f) << " ms,";
+        }
+        for (size_t i = 0; i < clips.size(); i++)
+        {
+            int entry = bundle.Find(BundleEntryType::Clip, characterClips[i]->name);
+            std::cout << " clip " << characterClips[i]->name << " " << clipLoadMs[i] << " ms / "
+                      << (entry >= 0 ? ((const BundleClip *)bundle.Data(entry))->assimpMs : 0.0f) << " ms";
+        }
+        std::cout << std::endl;
+
+        // resident memory should peak near the largest single entry, not the bundle size
+        staging->Finish();
+        const StagingRing::Stats &stagingStats = staging->GetStats();
+        uint64_t largestEntry = 0;
+        for (uint32_t i = 0; i < bundle.EntryCount(); i++)
+            largestEntry = std::max(largestEntry, bundle.Entry(i).size);
+        std::cout << "Staging (" << (staging->IsPersistent() ? "persistent" : "unsynchronized map") << ", "
+                  << staging->Capacity() / (1024 * 1024) << " MB): " << stagingStats.bytesStaged / (1024.0f * 1024.0f)
+                  << " MB in " << stagingStats.uploads << " uploads, " << stagingStats.bytesDirect / (1024.0f * 1024.0f)
+                  << " MB direct, " << stagingStats.fenceWaits << " fence waits (" << stagingStats.waitMs << " ms)" << std::endl;
+        if (PeakResidentBytes())
+            std::cout << "Peak RSS " << PeakResidentBytes() / (1024.0f * 1024.0f) << " MB, bundle "
+                      << bundle.Size() / (1024.0f * 1024.0f) << " MB, largest entry " << largestEntry / (1024.0f * 1024.0f)
+                      << " MB" << std::endl;
+        staging.reset();
+    }
+    else
+    {
+        std::cout << "Assimp load:";
+        for (size_t i = 0; i < models.size(); i++) std::cout << " " << scene.models[i].name << " " << modelLoadMs[i] << " ms,";
+        for (size_t i = 0; i < clips.size(); i++) std::cout << " clip " << characterClips[i]->name << " " << clipLoadMs[i] << " ms";
+        std::cout << std::endl;
+        for (size_t i = 0; i < models.size(); i++)
+        {
+            const Model &model = *models[i];
+            std::cout << "  " << scene.models[i].name << ": parse " << model.parseMs << " ms, convert " << model.convertMs
+                      << " ms on " << Jobs().ThreadCount() + 1 << " threads, upload " << model.uploadMs << " ms" << std::endl;
+            model.PrintOptimizeReport(scene.models[i].name, meshReport);
+        }
+    }
 	Animator animator(&danceAnimation);
+    // the character plays through a graph so clips cross-fade instead of snapping
+    AnimationGraph characterGraph(danceAnimation);
+    StateMachine *characterStates = characterGraph.Add<StateMachine>();
+    for (size_t i = 0; i < clips.size(); i++)
+        characterStates->AddState(characterClips[i]->name, characterGraph.AddClip(clips[i].get()));
+    characterGraph.SetRoot(characterStates);
+    animator.SetGraph(&characterGraph);
+
+    // animation LOD: bounding sphere of the bind pose, padded for the animated extremes
+    AnimationLODPolicy animationLOD = AnimationLODPolicy::Default();
+    animator.SetLODPolicy(&animationLOD);
+    glm::vec3 characterLow(1e30f), characterHigh(-1e30f);
+    for (const Mesh &mesh : animationModel.meshes)
+        for (const Vertex &vertex : mesh.vertices)
+        {
+            characterLow = glm::min(characterLow, vertex.Position);
+            characterHigh = glm::max(characterHigh, vertex.Position);
+        }
+    glm::vec3 characterCenter = (characterLow + characterHigh) * 0.5f;
+    float characterRadius = glm::length(characterHigh - characterLow) * 0.5f * 1.2f;
+    // every instance of the character plays the same pose; the first one drives the animation LOD
+    const std::vector<glm::mat4> &characterInstances = scene.instances[characterIndex];
+    glm::mat4 characterModel = characterInstances.empty() ? glm::mat4(1.0f) : characterInstances[0];
+    skinningPass.Prepare(animationModel);
+
+    // model space bounding spheres of the static models, for culling whole instances
+    std::vector<glm::vec3> modelCenters(models.size(), glm::vec3(0.0f));
+    std::vector<float> modelRadii(models.size(), 0.0f);
+    for (int index : staticModels)
+    {
+        glm::vec3 low(1e30f), high(-1e30f);
+        for (const Mesh &mesh : models[index]->meshes)
+        {
+            low = glm::min(low, mesh.boundsCenter - glm::vec3(mesh.boundsRadius));
+            high = glm::max(high, mesh.boundsCenter + glm::vec3(mesh.boundsRadius));
+        }
+        if (models[index]->meshes.empty()) continue;
+        modelCenters[index] = (low + high) * 0.5f;
+        for (const Mesh &mesh : models[index]->meshes)
+            modelRadii[index] = std::max(modelRadii[index], glm::length(mesh.boundsCenter - modelCenters[index]) + mesh.boundsRadius);
+    }
+    // a uniform scale bound of an instance transform, for its bounding sphere
+    auto maxScale = [](const glm::mat4 &transform)
+    {
+        return std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    };
+
+    // mesh LOD (see mesh_simplify.h): the largest error allowed on screen, in pixels
+    bool meshLODEnabled = true;
+    float meshLODPixelError = 1.0f;
+    float meshLODHysteresis = 0.25f;
+    // meshlet culling for the house (the character is skinned, its meshlet bounds only fit the bind pose).
+    // no GL_CULL_FACE in this renderer, so walls are seen from both sides and cone culling starts off
+    bool meshletCulling = true;
+    bool coneCulling = false;
+    // one culler per static model; all the visible instances of a model are culled first, then
+    // their commands go up in one indirect buffer upload and the instances are drawn
+    std::vector<std::unique_ptr<MeshletCuller>> cullers(models.size());
+    for (int index : staticModels) cullers[index].reset(new MeshletCuller());
+    // the LOD levels picked last frame, per model one per mesh of every instance, so instances at
+    // different distances keep their own hysteresis; the main thread's
+    std::vector<std::vector<int>> lodStates(models.size());
+    for (size_t i = 0; i < models.size(); i++) lodStates[i].assign(scene.instances[i].size() * models[i]->meshes.size(), 0);
+
+    // the rest of the neighborhood, streamed around the camera (see world_stream.h)
+    std::unique_ptr<WorldStreamer> neighborhood;
+    if (!neighborhoodPath.empty())
+    {
+        neighborhood.reset(new WorldStreamer(40.0f, ioThreads));
+        if (neighborhood->LoadManifest(neighborhoodPath))
+            std::cout << "Neighborhood " << neighborhoodPath << ": " << neighborhood->ChunkCount() << " chunks, "
+                      << ioThreads << " I/O threads" << std::endl;
+    }
+    // the budget as the UI edits it; the streamer gets a copy with every frame
+    StreamBudget streamBudget;
+    animator.SetSkinningMode(dualQuatSkinning ? SkinningMode::DualQuaternion : SkinningMode::Linear);
+
+    if (validateSkinning)
+    {
+        bool pass = ValidateDualQuaternionSkinning(animationModel, danceAnimation);
+        shaderReloader.Shutdown();
+        glfwTerminate();
+        return pass ? 0 : 1;
+    }
 
 
 
-    glm::vec3 lightPos(0.0f, 200.0f, 100.0f);
-    glm::vec3 lightDir(1.0f, 1.0f, 1.0f);
+    glm::vec3 lightPos = scene.sun.position;
+    glm::vec3 lightDir = scene.sun.direction;
     // light properties
-    glm::vec3 lightColor;
-    lightColor.x = static_cast<float>(1.0f);
-    lightColor.y = static_cast<float>(1.0f);
-    lightColor.z = static_cast<float>(1.0f);
+    glm::vec3 lightColor = scene.sun.color;
+    camera.Position = scene.cameraPosition;
+    camera.BeginStep();
 
 
     stbi_set_flip_vertically_on_load(true);
@@ -152,6 +436,26 @@ int main()
     ImGui::StyleColorsDark();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    if (!fontPath.empty())
+    {
+        if (std::ifstream(fontPath).good())
+            io.Fonts->AddFontFromFileTTF(fontPath.c_str(), fontPixels, NULL, io.Fonts->GetGlyphRangesChineseFull());
+        else
+            std::cout << "ERROR::FONT::FILE_NOT_FOUND: " << fontPath << std::endl;
+    }
+    // glyphs rasterized as text first needs them (see lazy_font.h)
+    LazyFontAtlas fontAtlas;
+    fontAtlas.Setup(!eagerFonts);
+    // NewFrame would create these on first use, but the context is on the render thread by then
+    ImGui_ImplOpenGL3_CreateDeviceObjects();
+    UIBenchmark uiBench;
+    uiBench.widgets = uiStressWidgets;
+    if (uiStressWidgets > 0) uiBench.StartComparison();
+    PanelCache tuningPanel("Tuning");
+    float tuningFps = 0.0f, tuningFpsTime = 0.0f;
+    // bone, light and culling bound overlays, generated as jobs (see debug_draw.h)
+    ParallelDrawLists overlays;
+    bool showBones = false, showLights = false, showBounds = false;
 
     // skybox ------------------------------------------
     GLfloat skyboxVertices[] = {
@@ -208,6 +512,7 @@ int main()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid *)0);
     glBindVertexArray(0);
 
+    const std::string &skyboxFilePath = scene.skyboxDirectory;
     vector<std::string> faces;
     // faces.push_back(skyboxFilePath + "/right.png");
     // faces.push_back(skyboxFilePath + "/left.png");
@@ -262,38 +567,35 @@ int main()
         glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
     }
 
-    // glfwSwapInterval(8);
+    // fixed step simulation, frame cap, vsync and latency measurement
+    FramePacer pacing(window);
+    pacing.fpsCap = fpsCap;
+    pacing.vsync = vsync;
+    pacing.stepHz = simHz;
+    pacing.fixedStep = !variableStep;
     // main render loop
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     // stbi_set_flip_vertically_on_load(true);
 
-    float ambientIntensity = 0.55f;
-    float diffuseIntensity = 0.25f;
-    float specularIntensity = 0.f;
-
+    float ambientIntensity = scene.sun.ambient;
+    float diffuseIntensity = scene.sun.diffuse;
+    float specularIntensity = scene.sun.specular;
 
-    while (!glfwWindowShouldClose(window))
+    // everything GL a frame does, on the render thread. it only reads the packet and what the render
+    // thread owns: the programs, the models' GPU side, meshlet culling, the streamer and the UI backend.
+    // instances come already frustum culled with their LODs picked (see the draw items below)
+    auto drawFrame = [&](FramePacket &frame)
     {
-        // input
-        processInput(window);
-       
-
-        //-----------------------------
-
-        // imgui
-        {
-            ImGui_ImplOpenGL3_NewFrame();
-            ImGui_ImplGlfw_NewFrame();
-            ImGui::NewFrame();
-        }
-
-        // per-frame time logic
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-
-        animator.UpdateAnimation(deltaTime);
+        FrameResults &drawn = frame.results;
+        shaderReloader.Poll();
+        glViewport(0, 0, frame.framebufferWidth, frame.framebufferHeight);
+
+        // skin the character once; every pass below draws the result as static geometry
+        if (frame.skinning == SkinningMode::DualQuaternion)
+            skinningPassDQ.Run(animationModel, Span<DualQuat>(frame.boneDualQuats.data(), frame.boneDualQuats.size()),
+                               frame.paletteScale);
+        else
+            skinningPass.Run(animationModel, Span<glm::mat4>(frame.boneMatrices.data(), frame.boneMatrices.size()));
 
         // render
         glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
@@ -302,37 +604,77 @@ int main()
 
         //====================================================================================================================================
         // enable shader before setting uniforms
-        glm::vec3 diffuseColor = lightColor   * glm::vec3(ambientIntensity); // decrease the influence
-        glm::vec3 ambientColor = lightColor * glm::vec3(diffuseIntensity); // low influence
-        glm::vec3 specularColor = lightColor * glm::vec3(specularIntensity); // low influence
         lightingShader.use();
-        lightingShader.setVec3("sunLight.position", lightPos);
-        lightingShader.setVec3("viewPos", camera.Position);
-        lightingShader.setVec3("sunLight.direction",lightDir);
+        lightingShader.setVec3("sunLight.position", frame.lightPosition);
+        lightingShader.setVec3("viewPos", frame.viewPosition);
+        lightingShader.setVec3("sunLight.direction", frame.lightDirection);
 
-        lightingShader.setVec3("sunLight.base.ambient", ambientColor);
-        lightingShader.setVec3("sunLight.base.diffuse", diffuseColor);
-        lightingShader.setVec3("sunLight.base.specular", specularColor);
+        lightingShader.setVec3("sunLight.base.ambient", frame.ambient);
+        lightingShader.setVec3("sunLight.base.diffuse", frame.diffuse);
+        lightingShader.setVec3("sunLight.base.specular", frame.specular);
 
 
         // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
-
-        // render the loaded model
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 1.0f)); // translate it down so it's at the center of the scene
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));     // it's a bit too big for our scene, so scale it down
-        lightingShader.setMat4("model", model);
-
+        lightingShader.setMat4("projection", frame.projection);
+        lightingShader.setMat4("view", frame.view);
 
-        // ourModel.Draw(ourShader);
+        // the static draw items: each instance sets its LODs and culls its meshlets for its own
+        // transform, then every culler uploads its model's commands once and the instances draw
+        glm::mat4 viewProjection = frame.projection * frame.view;
         glBindVertexArray(skyboxVAO);
         // glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        ourModel.Draw( lightingShader, true, cubemapTexture );
+        // the counters add up over the instances; the packet still holds the ones of three frames ago
+        drawn.staticTriangles = drawn.staticFullTriangles = drawn.characterTriangles = drawn.characterFullTriangles = 0;
+        drawn.instances = frame.instances;
+        drawn.instancesDrawn = (int)(frame.staticItems.size() + frame.characterItems.size());
+        drawn.cull = MeshletCuller::Stats();
+        if (frame.meshletCulling)
+        {
+            for (int index : staticModels) cullers[index]->BeginFrame();
+            for (const DrawItem &item : frame.staticItems)
+            {
+                Model &model = *models[item.model];
+                MeshletCuller &culler = *cullers[item.model];
+                culler.coneCulling = frame.coneCulling;
+                model.SetLODs(frame.lods.data() + item.firstLod);
+                drawn.staticTriangles += culler.Cull(model.meshes, item.transform, viewProjection, frame.viewPosition).trianglesVisible;
+                drawn.cull.Add(culler.GetStats());
+            }
+            for (int index : staticModels) cullers[index]->Upload();
+        }
+        std::vector<size_t> culled(models.size(), 0); // per model, instances drawn so far
+        for (const DrawItem &item : frame.staticItems)
+        {
+            Model &model = *models[item.model];
+            lightingShader.setMat4("model", item.transform);
+            lightingShader.setMat3("normalMatrix", NormalMatrix(item.transform));
+            model.SetLODs(frame.lods.data() + item.firstLod);
+            if (frame.meshletCulling)
+                cullers[item.model]->Apply(culled[item.model]++, model.meshes);
+            else
+            {
+                cullers[item.model]->Disable(model.meshes);
+                drawn.staticTriangles += item.triangles;
+            }
+            drawn.staticFullTriangles += item.fullTriangles;
+            model.Draw( lightingShader, true, cubemapTexture );
+        }
+        if (neighborhood)
+        {
+            neighborhood->Budget = frame.streamBudget;
+            neighborhood->Update(frame.viewPosition, frame.cameraVelocity);
+            neighborhood->Draw([&](const glm::mat4 &transform, Model &chunk)
+            {
+                unsigned int fullTriangles;
+                chunk.SelectLODs(transform, frame.viewPosition, frame.fovY, (float)frame.framebufferHeight,
+                                 frame.lodPixelError, frame.lodHysteresis, frame.meshLOD, fullTriangles);
+                lightingShader.setMat4("model", transform);
+                lightingShader.setMat3("normalMatrix", NormalMatrix(transform));
+                chunk.Draw(lightingShader, true, cubemapTexture);
+            });
+            drawn.stream = neighborhood->GetStats();
+        }
 
 
 
@@ -340,22 +682,20 @@ int main()
         //===================================================================================================================================
         //animation part 
         animationShader.use();
-        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        view = camera.GetViewMatrix();
-        animationShader.setMat4("projection", projection);
-        animationShader.setMat4("view", view);
-        animationShader.setVec3("girlColor",lightColor);
-        auto transforms = animator.GetFinalBoneMatrices();
-		for (int i = 0; i < transforms.size(); ++i)
-		animationShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
+        animationShader.setMat4("projection", frame.projection);
+        animationShader.setMat4("view", frame.view);
+        animationShader.setVec3("girlColor", frame.lightColor);
 
-        // render the loaded model
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(11.09f, 2.105f, 10.0f)); // translate it down so it's at the center of the scene
-        model = glm::scale(model, glm::vec3(1.f,1.f,1.f));	// it's a bit too big for our scene, so scale it down
-        model = glm::rotate(model,glm::radians(90.0f),glm::vec3(0.f,1.f,0.f));
-        animationShader.setMat4("model", model);
-        animationModel.Draw(animationShader, false, cubemapTexture);
+        // render the loaded model, once per visible instance with the same pose
+        for (const DrawItem &item : frame.characterItems)
+        {
+            animationShader.setMat4("model", item.transform);
+            animationShader.setMat3("normalMatrix", NormalMatrix(item.transform));
+            animationModel.SetLODs(frame.lods.data() + item.firstLod);
+            drawn.characterTriangles += item.triangles;
+            drawn.characterFullTriangles += item.fullTriangles;
+            animationModel.Draw(animationShader, false, cubemapTexture);
+        }
 
 
 
@@ -363,11 +703,11 @@ int main()
         // Skybox part
         glDepthFunc(GL_LEQUAL); // Change depth function so depth test passes when values are equal to depth buffer's content
         skyboxShader.use();
-        skyboxShader.setVec3("skyColor",lightColor);
-        view = glm::mat4(glm::mat3(camera.GetViewMatrix())); // Remove any translation component of the view matrix
+        skyboxShader.setVec3("skyColor", frame.lightColor);
+        glm::mat4 view = glm::mat4(glm::mat3(frame.view)); // Remove any translation component of the view matrix
 
         glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(frame.projection));
 
         // Skybox cube
         glBindVertexArray(skyboxVAO);
@@ -376,30 +716,430 @@ int main()
         glBindVertexArray(0);
         glDepthFunc(GL_LESS); // Set depth function back to default
 
+        // imgui, overlays in front
+        uiBench.Render(frame.ui.Get(), frame.uiBuildMs, frame.uiWidgets);
+        drawn.ui = *ImGui_ImplOpenGL3_GetRenderStats();
+        drawn.uiFlags = ImGui_ImplOpenGL3_GetFlags();
+        drawn.uiRenderMs = uiBench.RenderMs();
+        drawn.uiGpuMs = uiBench.GpuMs();
+        drawn.uiComparing = uiBench.Comparing();
+        drawn.uiComparisonMode = uiBench.ComparisonMode();
+        drawn.uiHasResults = uiBench.HasResults();
+        std::copy(uiBench.GetResults(), uiBench.GetResults() + 3, drawn.uiResults);
+
+        // swap buffers; input is polled on the main thread
+        glfwSwapBuffers(window);
+        pacing.Fence(frame.pacing);
+    };
+    RenderThread renderThread(window, renderThreaded, drawFrame);
+    renderThread.Start();
+    std::cout << (renderThreaded ? "Rendering on its own thread" : "Rendering on the main thread") << std::endl;
+    // job system utilization, summed over half a second so the panel can be read
+    std::vector<JobSystem::ThreadStats> jobStats;
+    float jobWindowMs = 0.0f;
+    double nextJobSample = 0.0;
+
+    while (!glfwWindowShouldClose(window))
+    {
+        // input, and the camera's share of the simulation steps due this frame
+        int simSteps = pacing.BeginFrame();
+        deltaTime = pacing.StepSeconds();
+        for (int step = 0; step < simSteps; step++)
+        {
+            camera.BeginStep();
+            processInput(window);
+        }
+        if (simSteps > 0) camera.UpdateVelocity(simSteps * pacing.StepSeconds());
+        // everything below renders from the camera between its last two steps
+        Camera eye = camera.Interpolated(pacing.Alpha());
+        // the packet this frame is built into, once the render thread is no more than maxFramesAhead behind
+        FramePacket &frame = renderThread.Acquire();
+        FrameResults drawn = renderThread.Results();
+        if (glfwGetTime() >= nextJobSample)
+        {
+            jobStats = Jobs().Sample(jobWindowMs);
+            nextJobSample = glfwGetTime() + 0.5;
+        }
+       
+
+        //-----------------------------
+
+        // imgui
+        {
+            // new glyphs need the context, the render thread stops for them
+            if (fontAtlas.Pending()) renderThread.Invoke([&fontAtlas] { fontAtlas.Update(); });
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            overlays.Begin();
+        }
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+
+
+        frame.view = eye.GetViewMatrix();
+        frame.projection = glm::perspective(glm::radians(eye.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        frame.viewPosition = eye.Position;
+        frame.cameraVelocity = eye.Velocity;
+        frame.fovY = glm::radians(eye.Zoom);
+        frame.framebufferWidth = framebufferWidth;
+        frame.framebufferHeight = framebufferHeight;
+
+        // the character's pose is a job of its own: the draw items below are collected meanwhile, and
+        // the bone overlay starts once it is done. nothing else touches animator until the Wait
+        JobCounter animated;
+        {
+            glm::vec3 center = glm::vec3(characterModel * glm::vec4(characterCenter, 1.0f));
+            glm::mat4 view = frame.view, projection = frame.projection;
+            float fovY = frame.fovY, step = deltaTime, alpha = pacing.Alpha();
+            Jobs().Run([&animator, center, characterRadius, view, projection, fovY, simSteps, step, alpha]
+            {
+                animator.UpdateLOD(center, characterRadius, view, projection, fovY);
+                for (int i = 0; i < simSteps; i++)
+                {
+                    animator.BeginStep();
+                    animator.UpdateAnimation(step);
+                }
+                animator.Interpolate(alpha);
+            }, &animated);
+        }
+
+        // light properties
+        frame.lightPosition = lightPos;
+        frame.lightDirection = lightDir;
+        frame.lightColor = lightColor;
+        frame.diffuse = lightColor * glm::vec3(ambientIntensity); // decrease the influence
+        frame.ambient = lightColor * glm::vec3(diffuseIntensity); // low influence
+        frame.specular = lightColor * glm::vec3(specularIntensity); // low influence
+
+        frame.meshLOD = meshLODEnabled;
+        frame.lodPixelError = meshLODPixelError;
+        frame.lodHysteresis = meshLODHysteresis;
+        frame.meshletCulling = meshletCulling;
+        frame.coneCulling = coneCulling;
+        frame.streamBudget = streamBudget;
+
+        // the draw items: instances outside the frustum are dropped here and the rest get their LODs,
+        // so the render thread is left with state changes, meshlet culling and draws
+        {
+            glm::mat4 viewProjection = frame.projection * frame.view;
+            frame.staticItems.clear();
+            frame.characterItems.clear();
+            frame.lods.clear();
+            frame.instances = 0;
+            auto collect = [&](int index, const glm::vec3 &center, float radius, std::vector<DrawItem> &items)
+            {
+                Model &model = *models[index];
+                size_t meshCount = model.meshes.size();
+                const std::vector<glm::mat4> &instances = scene.instances[index];
+                for (size_t instance = 0; instance < instances.size(); instance++)
+                {
+                    const glm::mat4 &transform = instances[instance];
+                    int *levels = lodStates[index].data() + instance * meshCount;
+                    frame.instances++;
+                    if (!SphereInFrustum(glm::vec3(transform * glm::vec4(center, 1.0f)), radius * maxScale(transform), viewProjection))
+                        continue;
+                    DrawItem item;
+                    item.model = index;
+                    item.transform = transform;
+                    item.firstLod = frame.lods.size();
+                    item.triangles = model.SelectLODs(transform, frame.viewPosition, frame.fovY, (float)frame.framebufferHeight,
+                                                      frame.lodPixelError, frame.lodHysteresis, frame.meshLOD, item.fullTriangles,
+                                                      levels);
+                    frame.lods.insert(frame.lods.end(), levels, levels + meshCount);
+                    items.push_back(item);
+                }
+            };
+            for (int index : staticModels) collect(index, modelCenters[index], modelRadii[index], frame.staticItems);
+            collect(characterIndex, characterCenter, characterRadius, frame.characterItems);
+        }
+
+        // overlays build while the UI is; each job is one list, in this order on screen
+        {
+            ScreenProjection screen(frame.projection, frame.view, ImGui::GetIO().DisplaySize);
+            // the first instance of the first static model
+            glm::mat4 houseModel = scene.instances[staticModels[0]].empty() ? glm::mat4(1.0f) : scene.instances[staticModels[0]][0];
+            // full detail meshlets only; the coarser levels' would overlap them
+            if (showBounds)
+                for (const Mesh &mesh : ourModel.meshes)
+                {
+                    size_t begin = mesh.lods[0].firstMeshlet, end = begin + mesh.lods[0].meshletCount;
+                    for (size_t first = begin; first == begin || first < end; first += 1024)
+                        overlays.Submit([screen, houseModel, &mesh, first, begin, end](ImDrawList &list)
+                        {
+                            DrawCullingBounds(list, screen, houseModel, mesh, first, std::min(first + 1024, end), first == begin,
+                                              IM_COL32(255, 200, 0, 255), IM_COL32(0, 200, 255, 96));
+                        });
+                }
+            if (showLights)
+                overlays.Submit([screen, &ourModel](ImDrawList &list)
+                {
+                    DrawLightGizmos(list, screen, ourModel.bulbs, true);
+                    DrawLightGizmos(list, screen, ourModel.pointBulbs, false);
+                });
+            if (showBones)
+                overlays.Submit([screen, characterModel, &animator, &characterGraph](ImDrawList &list)
+                {
+                    DrawSkeleton(list, screen, characterModel, animator.GetGlobalTransforms(),
+                                 characterGraph.GetSkeleton().parents, IM_COL32(255, 64, 64, 255));
+                }, &animated);
+        }
+
+        // the pose as the skinning pass will see it
+        Jobs().Wait(animated);
+        frame.skinning = animator.GetSkinningMode();
+        if (frame.skinning == SkinningMode::DualQuaternion)
+        {
+            Span<DualQuat> bones = animator.GetFinalBoneDualQuats();
+            frame.boneDualQuats.assign(bones.begin(), bones.end());
+            frame.paletteScale = animator.GetPaletteScale();
+        }
+        else
+        {
+            Span<glm::mat4> bones = animator.GetFinalBoneMatrices();
+            frame.boneMatrices.assign(bones.begin(), bones.end());
+        }
+
+
         // imgui
         {
-            ImGui::SliderFloat3("LightPos", &lightPos.x, -400.f, 400.f);
-            ImGui::SliderFloat3("LightColor", &lightColor.x, 0.0f, 1.0f);
-            ImGui::SliderFloat("LightColor-ambientIntensity", &ambientIntensity, 0.0f, 1.0f);
-            ImGui::SliderFloat("LightColor-diffuseIntensity", &diffuseIntensity, 0.0f, 1.0f);
-            ImGui::SliderFloat("LightColor-specularIntensity", &specularIntensity, 0.0f, 1.0f);
-            ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
-                        1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+            // the light tuning panel rarely changes, so while idle it is drawn from a cached image. the
+            // frame time it shows only refreshes twice a second to leave it idle in between
+            if (tuningFps == 0.0f || currentFrame - tuningFpsTime >= 0.5f)
+            {
+                tuningFps = ImGui::GetIO().Framerate;
+                tuningFpsTime = currentFrame;
+            }
+            tuningPanel.Hash(lightPos);
+            tuningPanel.Hash(lightColor);
+            tuningPanel.Hash(ambientIntensity);
+            tuningPanel.Hash(diffuseIntensity);
+            tuningPanel.Hash(specularIntensity);
+            tuningPanel.Hash(tuningFps);
+            tuningPanel.Hash(fontAtlas.Generation());
+            if (tuningPanel.Begin())
+            {
+                ImGui::SetNextWindowPos(ImVec2(10.0f, SCR_HEIGHT - 160.0f), ImGuiCond_FirstUseEver);
+                ImGui::SetNextWindowSize(ImVec2(420.0f, 150.0f), ImGuiCond_FirstUseEver);
+                ImGui::Begin("Tuning", NULL, ImGuiWindowFlags_NoFocusOnAppearing);
+                ImGui::SliderFloat3("LightPos", &lightPos.x, -400.f, 400.f);
+                ImGui::SliderFloat3("LightColor", &lightColor.x, 0.0f, 1.0f);
+                ImGui::SliderFloat("LightColor-ambientIntensity", &ambientIntensity, 0.0f, 1.0f);
+                ImGui::SliderFloat("LightColor-diffuseIntensity", &diffuseIntensity, 0.0f, 1.0f);
+                ImGui::SliderFloat("LightColor-specularIntensity", &specularIntensity, 0.0f, 1.0f);
+                ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / tuningFps, tuningFps);
+                ImGui::End();
+            }
+            // off again when the animator fell back to linear skinning for a scaled skeleton
+            dualQuatSkinning = animator.GetSkinningMode() == SkinningMode::DualQuaternion;
+            if (ImGui::Checkbox("Dual-quaternion skinning", &dualQuatSkinning))
+                animator.SetSkinningMode(dualQuatSkinning ? SkinningMode::DualQuaternion : SkinningMode::Linear);
+            const GraphStats &graphStats = characterGraph.GetStats();
+            ImGui::Text("Character: %s, %d/%d clips, %d channels, %d blends, poses %d/%d, %.3f ms",
+                        characterStates->GetStateName(characterStates->GetCurrentState()).c_str(),
+                        graphStats.clipsSampled, graphStats.clipBudget, graphStats.channelsSampled, graphStats.blends,
+                        (int)graphStats.posesUsed, (int)graphStats.poseCapacity, graphStats.evaluateMs);
+            if (ImGui::CollapsingHeader("Animation LOD"))
+            {
+                const AnimationLODState &lod = animator.GetLODState();
+                ImGui::Text("Level %d, screen size %.3f, %s, bones evaluated %d/%d", lod.level, lod.screenSize,
+                            lod.frozen ? "frozen (off-screen)" : lod.evaluated ? "evaluated" : "interpolated",
+                            lod.bonesEvaluated, lod.bonesTotal);
+                ImGui::Checkbox("Freeze off-screen", &animationLOD.freezeOffscreen);
+                for (size_t i = 0; i < animationLOD.levels.size(); i++)
+                {
+                    AnimationLODLevel &level = animationLOD.levels[i];
+                    ImGui::PushID((int)i);
+                    ImGui::Text("Level %d", (int)i);
+                    ImGui::SliderFloat("Min screen size", &level.minScreenSize, 0.0f, 1.0f);
+                    ImGui::SliderInt("Update every N frames", &level.updateInterval, 1, 8);
+                    ImGui::SliderInt("Skip leaf levels", &level.skipLeafLevels, 0, 4);
+                    ImGui::PopID();
+                }
+            }
+            if (ImGui::CollapsingHeader("Mesh LOD"))
+            {
+                ImGui::Checkbox("Enabled", &meshLODEnabled);
+                ImGui::SliderFloat("Pixel error", &meshLODPixelError, 0.25f, 8.0f);
+                ImGui::SliderFloat("Hysteresis", &meshLODHysteresis, 0.0f, 0.9f);
+            }
+            if (ImGui::CollapsingHeader("Meshlet culling"))
+            {
+                const MeshletCuller::Stats &cull = drawn.cull;
+                ImGui::Checkbox("Cull static model meshlets", &meshletCulling);
+                ImGui::Checkbox("Cone (backface) culling", &coneCulling);
+                ImGui::Text("Meshlets %d/%d visible (%d frustum, %d backface), %d draws%s, %.3f ms %s",
+                            cull.meshletsVisible, cull.meshlets, cull.frustumCulled, cull.backfaceCulled, cull.draws,
+                            GLExt().multiDrawIndirect ? " (multi-draw indirect)" : "", cull.cullMs,
+                            cullers[staticModels[0]]->UsesSIMD() ? "SSE2" : "scalar");
+                ImGui::Text("Static triangles submitted %u, visible %u", cull.trianglesSubmitted, cull.trianglesVisible);
+            }
+            if (ImGui::CollapsingHeader("Debug overlays"))
+            {
+                const ParallelDrawLists::Stats &overlayStats = overlays.GetStats();
+                ImGui::Checkbox("Bones", &showBones);
+                ImGui::SameLine();
+                ImGui::Checkbox("Lights", &showLights);
+                ImGui::SameLine();
+                ImGui::Checkbox("Culling bounds", &showBounds);
+                ImGui::Checkbox("Build on worker threads", &overlays.parallel);
+                const char *tessellationPaths[] = { "scalar", "SSE2", "AVX2" };
+                ImGui::Combo("Line tessellation", &ImGui::GetDrawListSharedData()->TessellationSimd, tessellationPaths,
+                             ImDrawTessellationSimdSupported() + 1);
+                ImGui::Text("%d lists on %d threads, %d vertices, %.3f ms building, main thread waited %.3f ms",
+                            overlayStats.jobs, overlayStats.threads, overlayStats.vertices, overlayStats.buildMs,
+                            overlayStats.waitMs);
+            }
+            if (neighborhood && ImGui::CollapsingHeader("Streaming"))
+            {
+                StreamBudget &budget = streamBudget;
+                int cpuMB = (int)(budget.cpuBytes >> 20), gpuMB = (int)(budget.gpuBytes >> 20);
+                if (ImGui::SliderInt("CPU budget (MB)", &cpuMB, 16, 4096)) budget.cpuBytes = (size_t)cpuMB << 20;
+                if (ImGui::SliderInt("GPU budget (MB)", &gpuMB, 16, 8192)) budget.gpuBytes = (size_t)gpuMB << 20;
+                ImGui::SliderFloat("Load radius", &budget.loadRadius, 10.0f, 500.0f);
+                ImGui::SliderFloat("Prefetch (s)", &budget.prefetchSeconds, 0.0f, 10.0f);
+                ImGui::SliderInt("Uploads per frame", &budget.uploadsPerFrame, 1, 8);
+                const WorldStreamer::Stats &stream = drawn.stream;
+                ImGui::Text("Chunks %d: %d queued, %d loading, %d in memory, %d on GPU, %d failed", stream.chunks,
+                            stream.queued, stream.loading, stream.cpuResident, stream.gpuResident, stream.failed);
+                ImGui::Text("CPU %.1f/%d MB, GPU %.1f/%d MB", stream.cpuBytes / (1024.0f * 1024.0f), cpuMB,
+                            stream.gpuBytes / (1024.0f * 1024.0f), gpuMB);
+                ImGui::Text("%d loads (%.1f ms I/O), %d uploads (%.1f ms), evictions %d CPU / %d GPU, %d budget stalls",
+                            stream.loads, stream.ioMs, stream.uploads, stream.uploadMs, stream.cpuEvictions,
+                            stream.gpuEvictions, stream.budgetStalls);
+                ImGui::Text("Update %.3f ms, camera velocity %.1f %.1f %.1f", stream.updateMs, camera.Velocity.x,
+                            camera.Velocity.y, camera.Velocity.z);
+            }
+            if (ImGui::CollapsingHeader("UI"))
+            {
+                int uiFlags = drawn.uiFlags;
+                bool ring = (uiFlags & ImGui_ImplOpenGL3_Flags_RingBuffer) != 0;
+                bool minimalState = (uiFlags & ImGui_ImplOpenGL3_Flags_MinimalStateBackup) != 0;
+                ImGui::SliderInt("Stress widgets", &uiBench.widgets, 0, 20000);
+                if (ImGui::Checkbox("Ring buffer upload", &ring) | ImGui::Checkbox("Minimal state backup", &minimalState))
+                {
+                    int flags = (ring ? ImGui_ImplOpenGL3_Flags_RingBuffer : 0) |
+                                (minimalState ? ImGui_ImplOpenGL3_Flags_MinimalStateBackup : 0);
+                    frame.commands.push_back([flags] { ImGui_ImplOpenGL3_SetFlags(flags); });
+                }
+                const ImGui_ImplOpenGL3_RenderStats *uiStats = &drawn.ui;
+                ImGui::Text("%d vertices, %d indices, %d draws, %d uploads (%.1f KB), %d fence waits", uiStats->VtxCount,
+                            uiStats->IdxCount, uiStats->DrawCalls, uiStats->BufferUploads, uiStats->UploadBytes / 1024.0f,
+                            uiStats->FenceWaits);
+                if (uiStats->RingBytes)
+                    ImGui::Text("Ring %.1f KB, %s", uiStats->RingBytes / 1024.0f,
+                                uiStats->RingPersistent ? "persistently mapped" : "mapped per frame");
+                ImGui::Text("Build %.3f ms, render %.3f ms CPU / %.3f ms GPU", uiBench.BuildMs(), drawn.uiRenderMs, drawn.uiGpuMs);
+                const PanelCache::Stats &tuningCache = tuningPanel.GetStats();
+                ImGui::Checkbox("Cache idle tuning panel", &tuningPanel.enabled);
+                ImGui::Text("Tuning panel %s, %d captures, %d cached / %d live frames, %d vertices skipped per cached frame",
+                            tuningCache.cached ? "cached" : "live", tuningCache.captures, tuningCache.cachedFrames,
+                            tuningCache.liveFrames, tuningCache.vertices);
+                const LazyFontAtlas::Stats &fonts = fontAtlas.GetStats();
+                ImGui::Text("Font atlas %s, %dx%d: %.1f KB CPU, %.1f KB GPU, built in %.3f ms, uploaded in %.3f ms",
+                            fonts.lazy ? "lazy" : "eager", fonts.width, fonts.height,
+                            (fonts.alphaBytes + fonts.rgbaBytes + fonts.pageBytes) / 1024.0f, fonts.textureBytes / 1024.0f,
+                            fonts.buildMs, fonts.uploadMs);
+                if (fonts.lazy)
+                    ImGui::Text("Glyphs: %d baked, %d on demand of %d, %d absent; %d/%d pages, %d uploads (%.1f KB), "
+                                "%d placeholder frames, %d rebuilds, %.3f ms rasterizing, %.3f ms waiting",
+                                fonts.bakedGlyphs, fonts.lazyGlyphs, fonts.availableGlyphs, fonts.absentGlyphs,
+                                fonts.pagesUsed, fonts.pages, fonts.uploads, fonts.uploadBytes / 1024.0f,
+                                fonts.placeholderFrames, fonts.rebuilds, fonts.rasterMs, fonts.waitMs);
+                if (drawn.uiComparing)
+                    ImGui::Text("Comparing backend modes (%d/3)...", drawn.uiComparisonMode + 1);
+                else if (ImGui::Button("Compare backend modes"))
+                    frame.commands.push_back([&uiBench] { uiBench.StartComparison(); });
+                if (drawn.uiHasResults)
+                    for (int m = 0; m < 3; m++)
+                    {
+                        const UIBenchmark::Result &result = drawn.uiResults[m];
+                        ImGui::Text("%s: %.3f ms CPU, %.3f ms GPU, %.0f uploads", result.mode, result.renderMs,
+                                    result.gpuMs, result.uploads);
+                    }
+            }
+            if (ImGui::CollapsingHeader("Frame pacing"))
+            {
+                const FramePacer::Stats &paced = pacing.GetStats();
+                int vsyncMode = (int)pacing.vsync;
+                if (ImGui::Combo("Vsync", &vsyncMode, "Off\0On\0Adaptive\0")) pacing.vsync = (VsyncMode)vsyncMode;
+                ImGui::SliderFloat("Frame cap", &pacing.fpsCap, 0.0f, 240.0f, pacing.fpsCap > 0.0f ? "%.0f FPS" : "off");
+                ImGui::Checkbox("Fixed simulation step", &pacing.fixedStep);
+                if (pacing.fixedStep) ImGui::SliderFloat("Simulation rate", &pacing.stepHz, 10.0f, 240.0f, "%.0f Hz");
+                ImGui::Text("Frame ms: p50 %.2f, p95 %.2f, p99 %.2f, max %.2f (mean %.2f over %d frames)", paced.frame.p50,
+                            paced.frame.p95, paced.frame.p99, paced.frame.max, paced.frame.mean, paced.frame.count);
+                ImGui::Text("Input to GPU done ms: p50 %.2f, p95 %.2f, p99 %.2f, max %.2f", paced.latency.p50,
+                            paced.latency.p95, paced.latency.p99, paced.latency.max);
+                ImGui::Text("%d steps this frame, alpha %.2f, %lld steps dropped; swap interval %d%s, %d Hz display",
+                            paced.steps, pacing.Alpha(), paced.droppedSteps, paced.swapInterval,
+                            paced.tearControl ? " (tear control)" : "", paced.refreshRate);
+                if (pacing.fpsCap > 0.0f)
+                    ImGui::Text("Cap: slept %.2f ms, spun %.2f ms (margin %.2f ms), woke %.3f ms late", paced.sleepMs,
+                                paced.spinMs, paced.sleepMarginMs, paced.wakeErrorMs);
+            }
+            if (ImGui::CollapsingHeader("Render thread"))
+            {
+                RenderThread::Stats threadStats = renderThread.GetStats();
+                if (threadStats.threaded)
+                    ImGui::SliderInt("Max frames ahead", &renderThread.maxFramesAhead, 0, RenderThread::PacketCount - 1);
+                else
+                    ImGui::Text("Rendering on the main thread (--no-render-thread)");
+                ImGui::Text("%lld frames drawn, %d ahead; draw %.3f ms, render thread idle %.3f ms", threadStats.frames,
+                            threadStats.framesAhead, threadStats.drawMs, threadStats.idleMs);
+                ImGui::Text("Main thread waited %.3f ms for a packet, %.3f ms in %d invokes", threadStats.acquireWaitMs,
+                            threadStats.invokeWaitMs, threadStats.invokes);
+            }
+            if (ImGui::CollapsingHeader("Jobs"))
+            {
+                ImGui::Text("%d worker threads (--threads); busy share of the last %.0f ms", Jobs().ThreadCount(), jobWindowMs);
+                for (size_t i = 0; i < jobStats.size(); i++)
+                {
+                    const JobSystem::ThreadStats &thread = jobStats[i];
+                    float busy = jobWindowMs > 0.0f ? std::min(thread.busyMs / jobWindowMs, 1.0f) : 0.0f;
+                    char overlay[96];
+                    snprintf(overlay, sizeof(overlay), "%.1f ms, %d jobs, %d stolen", thread.busyMs, thread.jobs, thread.steals);
+                    ImGui::ProgressBar(busy, ImVec2(-120.0f, 0.0f), overlay);
+                    ImGui::SameLine();
+                    if (i >= 1 && i <= (size_t)Jobs().ThreadCount()) ImGui::Text("%s %d", thread.name, (int)i);
+                    else ImGui::Text("%s", thread.name);
+                }
+            }
+            uiBench.Build();
+            ImGui::Text("Triangles: static %u/%u, character %u/%u; %d/%d instances drawn", drawn.staticTriangles,
+                        drawn.staticFullTriangles, drawn.characterTriangles, drawn.characterFullTriangles,
+                        drawn.instancesDrawn, drawn.instances);
 
             ImGui::Render();
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            overlays.Merge(ImGui::GetDrawData());
+            // the panel cache renders into its texture with the context, the render thread stops for it
+            if (tuningPanel.Settled()) renderThread.Invoke([&tuningPanel] { tuningPanel.Capture(); });
+            frame.ui.Copy(ImGui::GetDrawData());
+            frame.uiBuildMs = uiBench.BuildMs();
+            frame.uiWidgets = uiBench.widgets;
         }
 
-        // swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        glfwSwapBuffers(window);
+        // hand the frame to the render thread and go on with the next one; poll IO events (keys
+        // pressed/released, mouse moved etc.) once the frame cap has been waited out
+        frame.pacing = pacing.FrameMark();
+        renderThread.Submit();
+        pacing.Limit();
         glfwPollEvents();
     }
 
+    // the context comes back to this thread once the last frames are drawn
+    renderThread.Stop();
     // imgui
     {
+        uiBench.Release();
+        tuningPanel.Release();
+        pacing.Release();
+        fontAtlas.Shutdown();
         ImGui_ImplOpenGL3_Shutdown();
         ImGui::DestroyContext();
     }
+    shaderReloader.Shutdown();
+    // chunk buffers and the staging ring need the context
+    neighborhood.reset();
 
     // terminate, clearing all previously allocated GLFW resources.
     glfwTerminate();
@@ -433,8 +1173,10 @@ void processInput(GLFWwindow *window)
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    // height will be significantly larger than specified on retina displays. the render
+    // thread sets it with the next frame, the context isn't current here
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -0,0 +1,163 @@
+// tessellation_bench: times ImDrawList::AddPolyline and AddConvexPolyFilled on every code path
+// this CPU supports (scalar, SSE2, AVX2) and checks that they all produce the same bytes.
+//
+//   tessellation_bench [segments]
+//
+// segments defaults to one million per case. the points are a seeded random walk, so every run
+// and every path tessellates the same input. no window or GL context is needed.
+
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+struct BenchCase
+{
+    const char *name;
+    ImDrawListFlags flags;
+    float thickness;
+    bool closed;
+    bool fill;
+};
+
+struct BenchOutput
+{
+    std::vector<ImDrawVert> vertices;
+    std::vector<ImDrawIdx> indices;
+};
+
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// polylines of 32 points wandering around a 1080p screen
+static std::vector<ImVec2> RandomWalk(int points)
+{
+    std::vector<ImVec2> walk(points);
+    unsigned int state = 12345;
+    float x = 960.0f, y = 540.0f;
+    for (int i = 0; i < points; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        x = std::min(std::max(x + (float)((state >> 8) & 0xff) / 8.0f - 16.0f, 0.0f), 1920.0f);
+        state = state * 1664525u + 1013904223u;
+        y = std::min(std::max(y + (float)((state >> 8) & 0xff) / 8.0f - 16.0f, 0.0f), 1080.0f);
+        walk[i] = ImVec2(x, y);
+    }
+    return walk;
+}
+
+// clockwise 32-gons of varying size, one after the other
+static std::vector<ImVec2> Polygons(int points)
+{
+    std::vector<ImVec2> polygons(points);
+    for (int i = 0; i < points; i++)
+    {
+        int polygon = i / 32;
+        float a = 6.2831853f * (i % 32) / 32.0f;
+        float radius = 4.0f + (float)(polygon % 61);
+        polygons[i] = ImVec2(100.0f + (polygon % 17) * 100.0f + std::cos(a) * radius,
+                             100.0f + (polygon % 9) * 100.0f + std::sin(a) * radius);
+    }
+    return polygons;
+}
+
+// tessellates the whole input into the list, 32 points per call
+static void Tessellate(ImDrawList &list, const BenchCase &bench, const std::vector<ImVec2> &points)
+{
+    list._ResetForNewFrame();
+    list.Flags = bench.flags;
+    list.PushClipRectFullScreen();
+    for (size_t first = 0; first + 32 <= points.size(); first += 32)
+    {
+        if (bench.fill)
+            list.AddConvexPolyFilled(&points[first], 32, IM_COL32(255, 200, 0, 255));
+        else
+            list.AddPolyline(&points[first], 32, IM_COL32(255, 64, 64, 255), bench.closed ? ImDrawFlags_Closed : 0,
+                             bench.thickness);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int segments = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if (segments < 32)
+    {
+        std::cout << "usage: tessellation_bench [segments >= 32]" << std::endl;
+        return 1;
+    }
+
+    // what NewFrame would set up for a context with anti-aliasing and baked line textures
+    static ImVec4 texUvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+    for (int i = 0; i <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; i++)
+        texUvLines[i] = ImVec4(0.0f, i / 64.0f, 1.0f, (i + 1) / 64.0f);
+    ImDrawListSharedData shared;
+    shared.TexUvWhitePixel = ImVec2(0.5f / 512.0f, 0.5f / 64.0f);
+    shared.TexUvLines = texUvLines;
+    shared.ClipRectFullscreen = ImVec4(-8192.0f, -8192.0f, 8192.0f, 8192.0f);
+    shared.InitialFlags = ImDrawListFlags_AllowVtxOffset;
+    ImDrawList list(&shared);
+
+    const ImDrawListFlags aa = ImDrawListFlags_AntiAliasedLines | ImDrawListFlags_AllowVtxOffset;
+    const BenchCase cases[] = {
+        { "AA 1px, textured", aa | ImDrawListFlags_AntiAliasedLinesUseTex, 1.0f, false, false },
+        { "AA 1px", aa, 1.0f, false, false },
+        { "AA 1px closed", aa, 1.0f, true, false },
+        { "AA 3.5px", aa, 3.5f, false, false },
+        { "AA 3.5px closed", aa, 3.5f, true, false },
+        { "AA convex fill", ImDrawListFlags_AntiAliasedFill | ImDrawListFlags_AllowVtxOffset, 1.0f, true, true },
+    };
+    // a 32 point call draws 31 segments when open and 32 edges when closed
+    std::vector<ImVec2> walk = RandomWalk((segments + 30) / 31 * 32);
+    std::vector<ImVec2> polygons = Polygons((segments + 31) / 32 * 32);
+
+    int best = ImDrawTessellationSimdSupported();
+    std::cout << segments << " segments per case, best path " << ImDrawTessellationSimdName(best) << std::endl;
+    bool identical = true;
+    for (const BenchCase &bench : cases)
+    {
+        const std::vector<ImVec2> &points = bench.fill ? polygons : walk;
+        BenchOutput reference;
+        float scalarMs = 0.0f;
+        for (int simd = ImDrawTessellationSimd_Scalar; simd <= best; simd++)
+        {
+            shared.TessellationSimd = simd;
+            Tessellate(list, bench, points); // warm up, and size the buffers
+            float ms = 1e30f;
+            for (int run = 0; run < 5; run++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                Tessellate(list, bench, points);
+                ms = std::min(ms, MillisecondsSince(start));
+            }
+
+            bool same = true;
+            if (simd == ImDrawTessellationSimd_Scalar)
+            {
+                reference.vertices.assign(list.VtxBuffer.Data, list.VtxBuffer.Data + list.VtxBuffer.Size);
+                reference.indices.assign(list.IdxBuffer.Data, list.IdxBuffer.Data + list.IdxBuffer.Size);
+                scalarMs = ms;
+            }
+            else
+            {
+                same = reference.vertices.size() == (size_t)list.VtxBuffer.Size &&
+                       reference.indices.size() == (size_t)list.IdxBuffer.Size &&
+                       memcmp(reference.vertices.data(), list.VtxBuffer.Data, reference.vertices.size() * sizeof(ImDrawVert)) == 0 &&
+                       memcmp(reference.indices.data(), list.IdxBuffer.Data, reference.indices.size() * sizeof(ImDrawIdx)) == 0;
+                identical = identical && same;
+            }
+            std::cout << "  " << bench.name << ", " << ImDrawTessellationSimdName(simd) << ": " << ms << " ms, "
+                      << segments / ms / 1000.0f << " M segments/s, " << scalarMs / ms << "x, " << list.VtxBuffer.Size
+                      << " vertices" << (same ? "" : ", OUTPUT DIFFERS FROM SCALAR") << std::endl;
+        }
+    }
+    std::cout << (identical ? "all paths produced identical vertices and indices" : "ERROR::TESSELLATION_BENCH::MISMATCH") << std::endl;
+    return identical ? 0 : 1;
+}